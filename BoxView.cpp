@@ -1,6 +1,7 @@
 #include "BoxView.h"
 
 BoxView::BoxView(WindowRoot* const window) : View(window) {
+  EnableDrawCache();
 }
 
 void BoxView::measure() {
@@ -9,21 +10,7 @@ void BoxView::measure() {
 }
 
 void BoxView::UpdateConstraints() {
-  constexpr int ContentConstraintPriority = 1;
-  if (!mMeasuredWidthSet) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Width,
-                            Relation::EqualTo, nullptr,
-                            BoxAttribute::NoAttribute, 0.f, mContentWidth,
-                            ContentConstraintPriority));
-    mMeasuredWidthSet = true;
-  }
-  if (!mMeasuredHeightSet) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Height,
-                            Relation::EqualTo, nullptr,
-                            BoxAttribute::NoAttribute, 0.f, mContentHeight,
-                            ContentConstraintPriority));
-    mMeasuredHeightSet = true;
-  }
+  UpdateIntrinsicSizeConstraints();
 }
 
 void BoxView::draw() {
@@ -9,8 +9,5 @@ class BoxView : public View {
     virtual void measure() override;
     virtual void UpdateConstraints() override;
     virtual void draw() override;
-  private:
-    bool mMeasuredWidthSet{false};
-    bool mMeasuredHeightSet{false};
 };
 
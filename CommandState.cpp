@@ -0,0 +1,79 @@
+#include "CommandState.h"
+
+#include <cstring>
+
+void CommandState::Reset() {
+  const CommandStats kept = stats;
+  *this = {};
+  stats = kept;
+}
+
+bool CommandState::Count(bool isSet) {
+  if (isSet) {
+    stats.elided++;
+    return false;
+  }
+  stats.issued++;
+  return true;
+}
+
+bool CommandState::BindPipeline(VkPipeline newPipeline, bool dynamicLineWidth) {
+  if (!Count(pipeline == newPipeline)) return false;
+  pipeline = newPipeline;
+  // Static line width of a pipeline overwrites the dynamic one.
+  if (!dynamicLineWidth) {
+    lineWidthIsSet = false;
+  }
+  // Descriptor set layouts differ between pipelines.
+  descriptorSet = VK_NULL_HANDLE;
+  return true;
+}
+
+bool CommandState::BindDescriptorSet(VkDescriptorSet set) {
+  if (!Count(descriptorSet == set)) return false;
+  descriptorSet = set;
+  return true;
+}
+
+bool CommandState::SetViewport(const VkViewport& newViewport) {
+  if (!Count(viewportIsSet && memcmp(&viewport, &newViewport, sizeof(VkViewport)) == 0)) {
+    return false;
+  }
+  viewportIsSet = true;
+  viewport = newViewport;
+  return true;
+}
+
+bool CommandState::SetScissor(const VkRect2D& newScissor) {
+  if (!Count(scissorIsSet &&
+             scissor.offset.x == newScissor.offset.x &&
+             scissor.offset.y == newScissor.offset.y &&
+             scissor.extent.width == newScissor.extent.width &&
+             scissor.extent.height == newScissor.extent.height)) {
+    return false;
+  }
+  scissorIsSet = true;
+  scissor = newScissor;
+  return true;
+}
+
+bool CommandState::SetLineWidth(float newLineWidth) {
+  if (!Count(lineWidthIsSet && lineWidth == newLineWidth)) return false;
+  lineWidthIsSet = true;
+  lineWidth = newLineWidth;
+  return true;
+}
+
+bool CommandState::PushFrameInfo() {
+  // Every pipeline layout has the same push constant range, so
+  // pushed values stay valid across pipeline binds.
+  if (!Count(frameInfoIsPushed)) return false;
+  frameInfoIsPushed = true;
+  return true;
+}
+
+bool CommandState::BindVertexBuffer(VkBuffer buffer) {
+  if (!Count(vertexBuffer == buffer)) return false;
+  vertexBuffer = buffer;
+  return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// Vulkan state commands (pipeline, descriptor set, viewport, scissor,
+// line width, push constant and vertex buffer binds) recorded versus
+// skipped because the Command Buffer already had that state.
+struct CommandStats {
+  uint64_t issued = 0;
+  uint64_t elided = 0;
+};
+
+// State last recorded into a Command Buffer, so commands that wouldn't
+// change it can be skipped.
+//
+// Each call returns whether its command has to be recorded, and counts
+// it in 'stats' as issued or elided. Nothing is recorded here, Graphics2D
+// does that when a call returns true. (See Graphics2D::CmdBindPipeline)
+struct CommandState {
+  // A Command Buffer starts out with no state. Keeps 'stats'.
+  void Reset();
+
+  bool BindPipeline(VkPipeline pipeline, bool dynamicLineWidth);
+  bool BindDescriptorSet(VkDescriptorSet set);
+  bool SetViewport(const VkViewport& newViewport);
+  bool SetScissor(const VkRect2D& newScissor);
+  bool SetLineWidth(float newLineWidth);
+  bool PushFrameInfo();
+  bool BindVertexBuffer(VkBuffer buffer);
+
+  VkPipeline pipeline{VK_NULL_HANDLE};
+  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+  bool viewportIsSet = false;
+  VkViewport viewport;
+  bool scissorIsSet = false;
+  VkRect2D scissor;
+  bool lineWidthIsSet = false;
+  float lineWidth;
+  bool frameInfoIsPushed = false;
+  VkBuffer vertexBuffer{VK_NULL_HANDLE};
+
+  CommandStats stats;
+
+ private:
+  // Counts the command. Returns !isSet.
+  bool Count(bool isSet);
+};
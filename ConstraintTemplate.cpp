@@ -0,0 +1,57 @@
+#include "ConstraintTemplate.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+#include "View.h"
+
+ConstraintTemplate::ConstraintTemplate(size_t boxCount) {
+  mPlaceholders.reserve(boxCount);
+  for (size_t i=0; i<boxCount; i++) {
+    mPlaceholders.push_back(std::make_unique<Box>());
+  }
+}
+
+ConstraintTemplate::~ConstraintTemplate() = default;
+
+void ConstraintTemplate::AddConstraint(const Expression<double>& e1, const Relation r,
+                                       const Expression<double>& e2, unsigned int strength) {
+  if (strength < Tableau2::REQUIRED && r == Relation::EqualTo && (e1 - e2).GetVariableCount() == 1) {
+    throw std::runtime_error("ConstraintTemplate: Edit constraints can't be templated");
+  }
+  // Derived variables are left alone here. Once remapped,
+  // the target tableau substitutes its own definitions.
+  std::unique_ptr<Expression<double>> formed(mScratch.FormTableauExpression(e1, r, e2, strength));
+  for (const auto& var : formed->GetVariables()) {
+    if (var.GetType() != VariableType::Normal) {
+      mInternalVars.push_back(var);
+    }
+  }
+  mRows.push_back({ std::move(*formed), strength });
+}
+
+void ConstraintTemplate::Instantiate(Tableau2& tableau, const std::vector<const Box*>& boxes) const {
+  if (boxes.size() != mPlaceholders.size()) {
+    throw std::runtime_error("ConstraintTemplate: Expected one box per placeholder");
+  }
+  std::unordered_map<Variable, Variable> mapping;
+  mapping.reserve(mPlaceholders.size() * 8 + mInternalVars.size());
+  for (size_t i=0; i<boxes.size(); i++) {
+    const Box& placeholder = *mPlaceholders[i];
+    const Box& box = *boxes[i];
+    mapping[placeholder.GetLeftVar()] = box.GetLeftVar();
+    mapping[placeholder.GetRightVar()] = box.GetRightVar();
+    mapping[placeholder.GetTopVar()] = box.GetTopVar();
+    mapping[placeholder.GetBottomVar()] = box.GetBottomVar();
+    mapping[placeholder.GetWidthVar()] = box.GetWidthVar();
+    mapping[placeholder.GetHeightVar()] = box.GetHeightVar();
+    mapping[placeholder.GetCenterXVar()] = box.GetCenterXVar();
+    mapping[placeholder.GetCenterYVar()] = box.GetCenterYVar();
+  }
+  for (const auto& var : mInternalVars) {
+    mapping[var] = Variable(var.GetName(), var.GetType());
+  }
+  for (const auto& row : mRows) {
+    tableau.AddFormedRow(row.expr.Remap(mapping), row.strength);
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Expression.h"
+
+class Box;
+
+// A constraint pattern over placeholder boxes, formed once and stamped out
+// for many tuples of real boxes.
+//
+// Repeated structures, like the rows of a list, add the same constraints
+// over and over with only the boxes changed. A template runs those through
+// FormTableauExpression() once, against its own placeholder boxes. Each
+// Instantiate() then clones the formed rows, remaps placeholder variables
+// to the real boxes and slack/error variables to fresh ones, and hands the
+// rows straight to Tableau2::AddFormedRow(), skipping forming and duplicate
+// detection.
+//
+//   ConstraintTemplate row(2); // 0: Row, 1: List
+//   row.AddConstraint(row.GetBox(0).GetLeftVar(), Relation::EqualTo, row.GetBox(1).GetLeftVar());
+//   ...
+//   for (auto* textBox : rows) row.Instantiate(tableau, { textBox, list });
+//
+// Variables not belonging to a placeholder are used as is. Edit
+// constraints (optional equalities on a single variable) aren't supported.
+class ConstraintTemplate {
+ public:
+  explicit ConstraintTemplate(size_t boxCount);
+  ConstraintTemplate(const ConstraintTemplate&) = delete;
+  ~ConstraintTemplate();
+
+  ConstraintTemplate& operator=(const ConstraintTemplate&) = delete;
+
+  // Placeholder to write constraints against.
+  const Box& GetBox(size_t index) const {
+    return *mPlaceholders[index];
+  }
+
+  size_t GetBoxCount() const {
+    return mPlaceholders.size();
+  }
+
+  void AddConstraint(const Expression<double>& e1, const Relation r, const Expression<double>& e2,
+                     unsigned int strength = Tableau2::REQUIRED);
+
+  // Adds the pattern with placeholder i replaced by boxes[i].
+  void Instantiate(Tableau2& tableau, const std::vector<const Box*>& boxes) const;
+
+ private:
+  struct FormedRow {
+    Expression<double> expr;
+    unsigned int strength;
+  };
+
+  std::vector<std::unique_ptr<Box>> mPlaceholders;
+  std::vector<FormedRow> mRows;
+  std::vector<Variable> mInternalVars; // Slack and error variables. Fresh per instance.
+  Tableau2 mScratch; // Only used to form rows.
+};
@@ -0,0 +1,122 @@
+#include "DamageTracker.h"
+
+#include <algorithm>
+#include <limits>
+
+// FNV-1a
+static constexpr uint64_t kHashSeed = 14695981039346656037ull;
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+template<typename T>
+static uint64_t Hash(uint64_t hash, const T& value) {
+  return HashBytes(hash, &value, sizeof(T));
+}
+
+// Field by field, DrawOp has padding.
+static uint64_t HashRect(uint64_t hash, const ClipRect& rect) {
+  hash = Hash(hash, rect.left);
+  hash = Hash(hash, rect.top);
+  hash = Hash(hash, rect.right);
+  return Hash(hash, rect.bottom);
+}
+
+void DamageTracker::Resolve(const DrawOp* ops, size_t count,
+                            std::vector<VisibleOp>& visible) {
+  constexpr int32_t kMin = std::numeric_limits<int32_t>::min();
+  constexpr int32_t kMax = std::numeric_limits<int32_t>::max();
+
+  visible.clear();
+  std::vector<ClipRect> scissors{{kMin, kMin, kMax, kMax}};
+  for (size_t i = 0; i < count; i++) {
+    const DrawOp& op = ops[i];
+    if (op.type == DrawOpType::PushScissor) {
+      scissors.push_back(scissors.back().Intersect(op.bounds));
+      continue;
+    }
+    if (op.type == DrawOpType::PopScissor) {
+      if (scissors.size() > 1) scissors.pop_back();
+      continue;
+    }
+
+    const ClipRect bounds = op.bounds.Intersect(scissors.back());
+    if (bounds.IsEmpty()) continue;
+
+    uint64_t hash = Hash(kHashSeed, op.type);
+    hash = HashRect(hash, op.bounds);
+    hash = HashRect(hash, bounds);
+    hash = HashBytes(hash, op.rgba, sizeof(op.rgba));
+    hash = Hash(hash, op.lineWidth);
+    hash = Hash(hash, op.resourceId);
+    hash = Hash(hash, op.baselineX);
+    hash = Hash(hash, op.baselineY);
+    hash = Hash(hash, op.payloadSize);
+    if (op.payload) {
+      hash = HashBytes(hash, op.payload, op.payloadSize);
+    }
+    visible.push_back({hash, bounds});
+  }
+}
+
+void DamageTracker::AddDamage(const ClipRect& rect) {
+  if (rect.IsEmpty()) return;
+  mDamage = mDamage.IsEmpty() ? rect : mDamage.Union(rect);
+}
+
+void DamageTracker::Track(const void* key, const DrawOp* ops, size_t count) {
+  Resolve(ops, count, mVisible);
+
+  auto [it, isNew] = mEntries.try_emplace(key);
+  Entry& entry = it->second;
+  entry.frame = mFrame;
+
+  // Skip the common head and tail, everything in between changed.
+  const std::vector<VisibleOp>& before = entry.ops;
+  const std::vector<VisibleOp>& after = mVisible;
+  const size_t shorter = std::min(before.size(), after.size());
+  size_t head = 0;
+  while (head < shorter && before[head].hash == after[head].hash) {
+    head++;
+  }
+  size_t tail = 0;
+  while (tail < shorter - head &&
+         before[before.size() - 1 - tail].hash == after[after.size() - 1 - tail].hash) {
+    tail++;
+  }
+
+  for (size_t i = head; i < before.size() - tail; i++) {
+    AddDamage(before[i].bounds);
+  }
+  for (size_t i = head; i < after.size() - tail; i++) {
+    AddDamage(after[i].bounds);
+  }
+  entry.ops.swap(mVisible);
+}
+
+ClipRect DamageTracker::EndFrame(const ClipRect& window) {
+  for (auto it = mEntries.begin(); it != mEntries.end();) {
+    if (it->second.frame != mFrame) {
+      for (const VisibleOp& op : it->second.ops) {
+        AddDamage(op.bounds);
+      }
+      it = mEntries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  ClipRect damage = mInvalidated ? window : mDamage.Intersect(window);
+  if (damage.IsEmpty()) {
+    damage = {0, 0, 0, 0};
+  }
+  mDamage = {0, 0, 0, 0};
+  mInvalidated = false;
+  mFrame++;
+  return damage;
+}
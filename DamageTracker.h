@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "DisplayList.h"
+
+// Finds the part of the window whose pixels changed since the previous
+// frame, so only that part has to be redrawn. (See Graphics2D::SetDamage)
+//
+// Each frame, the ops drawn for a key (eg: a top level View) are compared
+// with the ops drawn for it the frame before. The ops both frames start
+// and end with are skipped, only the ones in between are damage: a caret
+// blinking in a line of text damages the caret, not the whole text field.
+class DamageTracker {
+ public:
+  // 'ops' were drawn for 'key' this frame. Scissors are resolved the way
+  // DisplayList::Order() does, so 'ops' must pop what they push.
+  // Each key is tracked once per frame.
+  void Track(const void* key, const DrawOp* ops, size_t count);
+
+  // The next EndFrame() damages everything. (eg: the window resized)
+  void Invalidate() { mInvalidated = true; }
+
+  // Ends the frame. Returns the union of this frame's damage, inside
+  // 'window'. Keys not tracked this frame damage what they drew last.
+  ClipRect EndFrame(const ClipRect& window);
+
+ private:
+  // Op as far as the pixels are concerned.
+  struct VisibleOp {
+    uint64_t hash; // Of the op, its payload and 'bounds'.
+    ClipRect bounds; // Intersected with its scissor.
+  };
+
+  struct Entry {
+    std::vector<VisibleOp> ops;
+    uint64_t frame; // Last tracked in.
+  };
+
+  static void Resolve(const DrawOp* ops, size_t count, std::vector<VisibleOp>& visible);
+  void AddDamage(const ClipRect& rect);
+
+  std::unordered_map<const void*, Entry> mEntries;
+  std::vector<VisibleOp> mVisible; // Scratch, kept for its capacity.
+  ClipRect mDamage{0, 0, 0, 0};
+  bool mInvalidated = true; // Nothing was drawn yet.
+  uint64_t mFrame = 0;
+};
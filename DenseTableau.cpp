@@ -0,0 +1,372 @@
+#include "DenseTableau.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DENSE_TABLEAU_X86 1
+#endif
+
+namespace {
+
+// Same epsilon as ApproxEq(). Coefficients that fall below it are cleared,
+// mirroring what Expression::ClearZeros does for the sparse rows.
+constexpr double kEpsilon = 1e-6;
+
+// dst[i] = dst[i] + factor * src[i], clearing near-zero results.
+void AxpyRowScalar(double* dst, const double* src, double factor, size_t count) {
+  for (size_t i=0; i<count; i++) {
+    const double r = dst[i] + factor * src[i];
+    dst[i] = std::abs(r) < kEpsilon ? 0.0 : r;
+  }
+}
+
+#ifdef DENSE_TABLEAU_X86
+// Note: No FMA here on purpose. A separate multiply and add rounds exactly
+//       like the scalar kernel, so both paths give bit-identical rows.
+__attribute__((target("avx2")))
+void AxpyRowAVX2(double* dst, const double* src, double factor, size_t count) {
+  const __m256d f = _mm256_set1_pd(factor);
+  const __m256d eps = _mm256_set1_pd(kEpsilon);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  size_t i=0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d d = _mm256_loadu_pd(dst + i);
+    const __m256d s = _mm256_loadu_pd(src + i);
+    const __m256d r = _mm256_add_pd(d, _mm256_mul_pd(f, s));
+    const __m256d absR = _mm256_andnot_pd(signMask, r);
+    const __m256d isZero = _mm256_cmp_pd(absR, eps, _CMP_LT_OQ);
+    _mm256_storeu_pd(dst + i, _mm256_andnot_pd(isZero, r));
+  }
+  AxpyRowScalar(dst + i, src + i, factor, count - i);
+}
+#endif
+
+bool CpuSupportsAVX2() {
+#ifdef DENSE_TABLEAU_X86
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+bool sSimdEnabled = CpuSupportsAVX2();
+
+// Lexicographic a < b, levels within kEpsilon count as equal.
+// Same as Tableau2::IsRatioLess().
+bool IsRatioLess(const std::vector<double>& a, const std::vector<double>& b) {
+  for (size_t level=0; level<a.size(); level++) {
+    if (std::abs(a[level] - b[level]) < kEpsilon) continue;
+    return a[level] < b[level];
+  }
+  return false;
+}
+
+void AxpyRow(double* dst, const double* src, double factor, size_t count) {
+#ifdef DENSE_TABLEAU_X86
+  if (sSimdEnabled) {
+    AxpyRowAVX2(dst, src, factor, count);
+    return;
+  }
+#endif
+  AxpyRowScalar(dst, src, factor, count);
+}
+
+} // namespace
+
+void DenseTableau::SetSimdEnabled(bool enabled) {
+  sSimdEnabled = enabled && CpuSupportsAVX2();
+}
+
+bool DenseTableau::IsSimdEnabled() {
+  return sSimdEnabled;
+}
+
+DenseTableau::DenseTableau(const std::unordered_map<Variable, Expression<double>*>& rows,
+                           const Expression<double>& objective) : mLevels(1) {
+  const std::vector<Variable> objectiveVars = objective.GetVariables();
+  LoadRows(rows, objectiveVars);
+  for (const auto& var : objectiveVars) {
+    ObjectiveRow(0)[mColumnIndex[var]] = objective.GetCoefficient(var);
+  }
+  mObjectiveConstants[0] = objective.GetConstant();
+  SubstituteBasicIntoObjective();
+}
+
+DenseTableau::DenseTableau(const std::unordered_map<Variable, Expression<double>*>& rows,
+                           const Expression<SymbolicWeight<Tableau2::REQUIRED>>& objective)
+                           : mLevels(Tableau2::REQUIRED) {
+  const std::vector<Variable> objectiveVars = objective.GetVariables();
+  LoadRows(rows, objectiveVars);
+  for (const auto& var : objectiveVars) {
+    const int column = mColumnIndex[var];
+    const auto weight = objective.GetCoefficient(var);
+    for (size_t level=0; level<mLevels; level++) {
+      ObjectiveRow(level)[column] = weight.mCoefficients[level];
+    }
+  }
+  const auto constant = objective.GetConstant();
+  for (size_t level=0; level<mLevels; level++) {
+    mObjectiveConstants[level] = constant.mCoefficients[level];
+  }
+  SubstituteBasicIntoObjective();
+}
+
+int DenseTableau::GetOrAddColumn(const Variable& var) {
+  auto iter = mColumnIndex.find(var);
+  if (iter != mColumnIndex.end()) {
+    return iter->second;
+  }
+  const int column = static_cast<int>(mColumns.size());
+  mColumns.push_back(var);
+  mColumnIndex.insert({var, column});
+  return column;
+}
+
+void DenseTableau::LoadRows(const std::unordered_map<Variable, Expression<double>*>& rows,
+                            const std::vector<Variable>& objectiveVars) {
+  // Assign columns first so we know the row width.
+  std::vector<std::vector<Variable>> rowVars;
+  std::vector<Variable> basicVars;
+  rowVars.reserve(rows.size());
+  basicVars.reserve(rows.size());
+  for (const auto& row : rows) {
+    GetOrAddColumn(row.first);
+    basicVars.push_back(row.first);
+    mExpressions.push_back(row.second);
+    rowVars.push_back(row.second->GetVariables());
+    for (const auto& var : rowVars.back()) {
+      GetOrAddColumn(var);
+    }
+  }
+  for (const auto& var : objectiveVars) {
+    GetOrAddColumn(var);
+  }
+
+  // Hash map order isn't meaningful. Scanning columns in pivot order
+  // makes the first candidate found the one Tableau2 would pick.
+  std::sort(mColumns.begin(), mColumns.end(), PivotsBefore);
+  for (size_t c=0; c<mColumns.size(); c++) {
+    mColumnIndex[mColumns[c]] = c;
+  }
+  for (const auto& var : basicVars) {
+    mBasic.push_back(mColumnIndex[var]);
+  }
+
+  mStride = (mColumns.size() + 3) & ~size_t(3);
+  mMatrix.assign(mBasic.size() * mStride, 0.0);
+  mConstants.assign(mBasic.size(), 0.0);
+  mObjective.assign(mLevels * mStride, 0.0);
+  mObjectiveConstants.assign(mLevels, 0.0);
+
+  for (size_t i=0; i<mExpressions.size(); i++) {
+    double* row = Row(i);
+    for (const auto& var : rowVars[i]) {
+      row[mColumnIndex[var]] = mExpressions[i]->GetCoefficient(var);
+    }
+    mConstants[i] = mExpressions[i]->GetConstant();
+  }
+}
+
+void DenseTableau::SubstituteBasicIntoObjective() {
+  for (size_t i=0; i<mBasic.size(); i++) {
+    const int basic = mBasic[i];
+    for (size_t level=0; level<mLevels; level++) {
+      double* objective = ObjectiveRow(level);
+      const double coeff = objective[basic];
+      if (coeff == 0.0) continue;
+      objective[basic] = 0.0;
+      AxpyRow(objective, Row(i), coeff, mStride);
+      mObjectiveConstants[level] += coeff * mConstants[i];
+    }
+  }
+}
+
+bool DenseTableau::IsObjectiveNegative(int column) const {
+  for (size_t level=0; level<mLevels; level++) {
+    const double coeff = ObjectiveRow(level)[column];
+    if (std::abs(coeff) < kEpsilon) continue;
+    return coeff < 0.0;
+  }
+  return false;
+}
+
+void DenseTableau::Pivot(int enteringColumn, int exitingRow) {
+  // Same as Tableau2::Pivot:
+  //   Solve exiting row for the entering variable, then substitute
+  //   it into the objective and every other row.
+  double* pivotRow = Row(exitingRow);
+  const double enterCoeff = pivotRow[enteringColumn];
+  pivotRow[enteringColumn] = 0.0;
+  pivotRow[mBasic[exitingRow]] = -1.0;
+  const double scale = -1 / enterCoeff;
+  for (size_t c=0; c<mColumns.size(); c++) {
+    const double v = pivotRow[c] * scale;
+    pivotRow[c] = std::abs(v) < kEpsilon ? 0.0 : v;
+  }
+  mConstants[exitingRow] *= scale;
+
+  for (size_t level=0; level<mLevels; level++) {
+    double* objective = ObjectiveRow(level);
+    const double coeff = objective[enteringColumn];
+    if (coeff == 0.0) continue;
+    objective[enteringColumn] = 0.0;
+    AxpyRow(objective, pivotRow, coeff, mStride);
+    mObjectiveConstants[level] += coeff * mConstants[exitingRow];
+  }
+
+  for (size_t i=0; i<mBasic.size(); i++) {
+    if (i == static_cast<size_t>(exitingRow)) continue;
+    double* row = Row(i);
+    const double coeff = row[enteringColumn];
+    if (coeff == 0.0) continue;
+    row[enteringColumn] = 0.0;
+    AxpyRow(row, pivotRow, coeff, mStride);
+    mConstants[i] += coeff * mConstants[exitingRow];
+  }
+  mBasic[exitingRow] = enteringColumn;
+}
+
+void DenseTableau::LoadConstants() {
+  for (size_t i=0; i<mExpressions.size(); i++) {
+    mConstants[i] = mExpressions[i]->GetConstant();
+  }
+}
+
+size_t DenseTableau::Solve() {
+  size_t pivots = 0;
+  while (true) {
+    int enteringColumn = -1;
+    for (size_t c=0; c<mColumns.size(); c++) {
+      if (IsObjectiveNegative(c)) {
+        enteringColumn = c;
+        break;
+      }
+    }
+    if (enteringColumn == -1) {
+      break;
+    }
+
+    // Exiting row by minimum ratio test.
+    double minRatio = std::numeric_limits<double>::max();
+    int exitingRow = -1;
+    for (size_t i=0; i<mBasic.size(); i++) {
+      const double coeff = Row(i)[enteringColumn];
+      if (coeff < 0.0) {
+        const double ratio = -mConstants[i] / coeff;
+        // Ties go to the smallest basic column, same as Tableau2.
+        if (ratio < minRatio || (exitingRow != -1 && ratio == minRatio && mBasic[i] < mBasic[exitingRow])) {
+          minRatio = ratio;
+          exitingRow = i;
+        }
+      }
+    }
+
+    if (exitingRow == -1) {
+      throw std::runtime_error("Unbounded Problem");
+    }
+    Pivot(enteringColumn, exitingRow);
+    pivots++;
+  }
+  return pivots;
+}
+
+size_t DenseTableau::Resolve() {
+  size_t pivots = 0;
+  std::vector<double> minRatio(mLevels);
+  std::vector<double> ratio(mLevels);
+  while (true) {
+    int exitingRow = -1;
+    for (size_t i=0; i<mBasic.size(); i++) {
+      if (mConstants[i] < 0.0 && (exitingRow == -1 || mBasic[i] < mBasic[exitingRow])) {
+        exitingRow = i;
+      }
+    }
+    if (exitingRow == -1) {
+      break;
+    }
+
+    // Entering variable by (lexicographic) minimum ratio test.
+    std::fill(minRatio.begin(), minRatio.end(), std::numeric_limits<double>::max());
+    int enteringColumn = -1;
+    const double* row = Row(exitingRow);
+    for (size_t c=0; c<mColumns.size(); c++) {
+      if (row[c] > 0.0) {
+        const double inverse = 1 / row[c];
+        for (size_t level=0; level<mLevels; level++) {
+          ratio[level] = ObjectiveRow(level)[c] * inverse;
+        }
+        if (IsRatioLess(ratio, minRatio)) {
+          minRatio.swap(ratio);
+          enteringColumn = c;
+        }
+      }
+    }
+
+    if (enteringColumn == -1) {
+      throw std::runtime_error("Unsolvable Tableau");
+    }
+    Pivot(enteringColumn, exitingRow);
+    pivots++;
+  }
+  return pivots;
+}
+
+void DenseTableau::Store(std::unordered_map<Variable, Expression<double>*>& rows,
+                         std::unordered_set<Variable>& parametric) const {
+  rows.clear();
+  for (size_t i=0; i<mBasic.size(); i++) {
+    Expression<double>* expr = mExpressions[i];
+    expr->Reset();
+    const double* row = Row(i);
+    for (size_t c=0; c<mColumns.size(); c++) {
+      if (row[c] != 0.0) {
+        expr->AddVariable(mColumns[c], row[c]);
+      }
+    }
+    expr->AddConstant(mConstants[i]);
+    rows.insert({mColumns[mBasic[i]], expr});
+  }
+
+  for (const auto& var : mColumns) {
+    if (rows.find(var) == rows.end()) {
+      parametric.insert(var);
+    } else {
+      parametric.erase(var);
+    }
+  }
+}
+
+void DenseTableau::StoreObjective(Expression<double>& objective) const {
+  objective.Reset();
+  const double* row = ObjectiveRow(0);
+  for (size_t c=0; c<mColumns.size(); c++) {
+    if (row[c] != 0.0) {
+      objective.AddVariable(mColumns[c], row[c]);
+    }
+  }
+  objective.AddConstant(mObjectiveConstants[0]);
+}
+
+void DenseTableau::StoreObjective(Expression<SymbolicWeight<Tableau2::REQUIRED>>& objective) const {
+  objective.Reset();
+  for (size_t c=0; c<mColumns.size(); c++) {
+    SymbolicWeight<Tableau2::REQUIRED> weight;
+    bool nonZero = false;
+    for (size_t level=0; level<mLevels; level++) {
+      weight.mCoefficients[level] = ObjectiveRow(level)[c];
+      nonZero = nonZero || weight.mCoefficients[level] != 0.0;
+    }
+    if (nonZero) {
+      objective.AddVariable(mColumns[c], weight);
+    }
+  }
+  SymbolicWeight<Tableau2::REQUIRED> constant;
+  for (size_t level=0; level<mLevels; level++) {
+    constant.mCoefficients[level] = mObjectiveConstants[level];
+  }
+  objective.AddConstant(constant);
+}
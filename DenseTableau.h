@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Expression.h"
+
+// Dense, row-major copy of a Tableau2 used for small constraint systems.
+//
+// Tableau2 keeps every row as a hash-map Expression, which is great for
+// large sparse layouts but slow for the common case of a dialog with a
+// handful of boxes. DenseTableau loads the rows into a flat matrix
+// (one column per variable, constants kept separately), runs the same
+// primal/dual simplex pivot rules as Tableau2 over it, then writes the
+// result back into the Expression rows. Columns are in PivotsBefore()
+// order, so ties are broken the same way as in Tableau2.
+//
+// Row updates go through a single axpy kernel, which is vectorized with AVX2
+// when the CPU supports it. The AVX2 and scalar kernels perform the exact
+// same operations (multiply, add, clear-near-zero), so both produce
+// bit-identical tableaus.
+class DenseTableau {
+ public:
+  // Objective levels. 1 for Phase-1 (double) objectives,
+  // Tableau2::REQUIRED for the symbolic error objective.
+  DenseTableau(const std::unordered_map<Variable, Expression<double>*>& rows,
+               const Expression<double>& objective);
+  DenseTableau(const std::unordered_map<Variable, Expression<double>*>& rows,
+               const Expression<SymbolicWeight<Tableau2::REQUIRED>>& objective);
+
+  DenseTableau(const DenseTableau&) = delete;
+  DenseTableau& operator=(const DenseTableau&) = delete;
+
+  // Primal simplex. Minimizes the objective. Throws on unbounded problems.
+  // Returns the number of pivots.
+  size_t Solve();
+
+  // Dual simplex. Drives negative row constants back to feasibility
+  // while keeping the objective optimal. Throws if unsolvable.
+  // Returns the number of pivots.
+  size_t Resolve();
+
+  // Re-reads row constants from the Expressions last loaded or stored.
+  // Lets a caller that only changed constants (edits) keep this tableau.
+  void LoadConstants();
+
+  // Writes the rows back into the Tableau2 representation. Reuses the
+  // Expression allocations that were handed to the constructor.
+  void Store(std::unordered_map<Variable, Expression<double>*>& rows,
+             std::unordered_set<Variable>& parametric) const;
+  void StoreObjective(Expression<double>& objective) const;
+  void StoreObjective(Expression<SymbolicWeight<Tableau2::REQUIRED>>& objective) const;
+
+  size_t GetRowCount() const { return mBasic.size(); }
+  size_t GetColumnCount() const { return mColumns.size(); }
+
+  // Enabled by default when the CPU supports AVX2.
+  // Disabling forces the scalar kernel. (Used by tests)
+  static void SetSimdEnabled(bool enabled);
+  static bool IsSimdEnabled();
+
+ private:
+  void LoadRows(const std::unordered_map<Variable, Expression<double>*>& rows,
+                const std::vector<Variable>& objectiveVars);
+  int GetOrAddColumn(const Variable& var);
+  // Replaces basic variables of the objective with their rows.
+  void SubstituteBasicIntoObjective();
+  void Pivot(int enteringColumn, int exitingRow);
+
+  double* Row(int row) { return &mMatrix[row * mStride]; }
+  const double* Row(int row) const { return &mMatrix[row * mStride]; }
+  double* ObjectiveRow(int level) { return &mObjective[level * mStride]; }
+  const double* ObjectiveRow(int level) const { return &mObjective[level * mStride]; }
+
+  // Lexicographic sign of objective column. Near-zero levels are skipped.
+  bool IsObjectiveNegative(int column) const;
+
+  std::vector<Variable> mColumns;
+  std::unordered_map<Variable, int> mColumnIndex;
+  std::vector<int> mBasic; // Column of each row's basic variable.
+  std::vector<Expression<double>*> mExpressions;
+
+  size_t mStride = 0; // Columns, padded to a multiple of 4 doubles.
+  size_t mLevels = 1;
+  std::vector<double> mMatrix; // mBasic.size() x mStride
+  std::vector<double> mConstants;
+  std::vector<double> mObjective; // mLevels x mStride
+  std::vector<double> mObjectiveConstants;
+};
@@ -0,0 +1,220 @@
+#include "DisplayList.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+//
+// ARENA
+//
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  while (true) {
+    if (mBlockIdx < mBlocks.size()) {
+      Block& block = mBlocks[mBlockIdx];
+      uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+      size_t offset = ((base + mOffset + alignment - 1) & ~(alignment - 1)) - base;
+      if (offset + size <= block.size) {
+        mOffset = offset + size;
+        mBytesUsed += size;
+        return block.data.get() + offset;
+      }
+      if (mBlockIdx + 1 < mBlocks.size()) { // Move on to a kept block.
+        mBlockIdx++;
+        mOffset = 0;
+        continue;
+      }
+    }
+    // Oversized allocations get a block of their own.
+    const size_t blockSize = std::max(mBlockSize, size + alignment);
+    mBlocks.push_back({std::make_unique<uint8_t[]>(blockSize), blockSize});
+    mBlockIdx = mBlocks.size() - 1;
+    mOffset = 0;
+  }
+}
+
+void Arena::Reset() {
+  mBlockIdx = 0;
+  mOffset = 0;
+  mBytesUsed = 0;
+}
+
+//
+// CLIP RECT
+//
+
+ClipRect ClipRect::Intersect(const ClipRect& other) const {
+  return {std::max(left, other.left), std::max(top, other.top),
+          std::min(right, other.right), std::min(bottom, other.bottom)};
+}
+
+ClipRect ClipRect::Union(const ClipRect& other) const {
+  return {std::min(left, other.left), std::min(top, other.top),
+          std::max(right, other.right), std::max(bottom, other.bottom)};
+}
+
+//
+// DISPLAY LIST
+//
+
+bool DisplayList::CanBatch(const DrawOp& a, const DrawOp& b) {
+  if (a.type != b.type) return false;
+  switch (a.type) {
+    case DrawOpType::Rect:
+    // Textures are indexed per instance. (See Graphics2D::mDescriptors)
+    case DrawOpType::TexturedRect:
+    case DrawOpType::Text:
+      return true;
+    case DrawOpType::Outline:
+      return a.lineWidth == b.lineWidth;
+    default:
+      return false;
+  }
+}
+
+void DisplayList::Clear() {
+  mOps.clear();
+  mArena.Reset();
+}
+
+DrawOp& DisplayList::AddOp(DrawOpType type, const ClipRect& bounds, const float rgba[4]) {
+  DrawOp op{};
+  op.type = type;
+  op.bounds = bounds;
+  if (rgba) {
+    memcpy(op.rgba, rgba, sizeof(op.rgba));
+  }
+  mOps.push_back(op);
+  return mOps.back();
+}
+
+const void* DisplayList::CopyPayload(const void* data, uint32_t size) {
+  if (size == 0) return nullptr;
+  void* copy = mArena.Allocate(size, alignof(float));
+  memcpy(copy, data, size);
+  return copy;
+}
+
+void DisplayList::AddRect(const ClipRect& rect, const float rgba[4]) {
+  AddOp(DrawOpType::Rect, rect, rgba);
+}
+
+void DisplayList::AddOutline(const ClipRect& rect, const float rgba[4], float lineWidth) {
+  // The strip runs along the edges themselves, right and bottom
+  // included, and is as wide as the line.
+  const int32_t pad = static_cast<int32_t>(std::ceil(lineWidth / 2.0f)) + 1;
+  DrawOp& op = AddOp(DrawOpType::Outline,
+                     {rect.left - pad, rect.top - pad,
+                      rect.right + pad, rect.bottom + pad}, rgba);
+  op.lineWidth = lineWidth;
+  // Keep the rect itself, the padded bounds are only for culling.
+  op.payload = CopyPayload(&rect, sizeof(ClipRect));
+  op.payloadSize = sizeof(ClipRect);
+}
+
+void DisplayList::AddTexturedRect(int32_t imageId, const ClipRect& rect,
+                                  const float rgba[4], const float textureCoords[8]) {
+  DrawOp& op = AddOp(DrawOpType::TexturedRect, rect, rgba);
+  op.resourceId = imageId;
+  op.payload = CopyPayload(textureCoords, 8 * sizeof(float));
+  op.payloadSize = 8 * sizeof(float);
+}
+
+void DisplayList::AddText(int32_t fontId, const char* str, uint32_t length,
+                          int32_t baselineX, int32_t baselineY,
+                          const ClipRect& bounds, const float rgba[4]) {
+  if (length == 0) return;
+  DrawOp& op = AddOp(DrawOpType::Text, bounds, rgba);
+  op.resourceId = fontId;
+  op.baselineX = baselineX;
+  op.baselineY = baselineY;
+  op.payload = CopyPayload(str, length);
+  op.payloadSize = length;
+}
+
+void DisplayList::PushScissor(const ClipRect& scissor) {
+  AddOp(DrawOpType::PushScissor, scissor, nullptr);
+}
+
+void DisplayList::PopScissor() {
+  AddOp(DrawOpType::PopScissor, {0, 0, 0, 0}, nullptr);
+}
+
+void DisplayList::Append(const DisplayList& other) {
+  mOps.reserve(mOps.size() + other.mOps.size());
+  for (const DrawOp& op : other.mOps) {
+    mOps.push_back(op);
+    mOps.back().payload = CopyPayload(op.payload, op.payloadSize);
+  }
+}
+
+void DisplayList::AppendShared(const DisplayList& other) {
+  mOps.insert(mOps.end(), other.mOps.begin(), other.mOps.end());
+}
+
+void DisplayList::Order(const ClipRect& root, std::vector<Item>& ordered,
+                        size_t lookback) const {
+  constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+  // Items of a batch are chained through 'next', in issue order.
+  struct Batch {
+    uint32_t first, last; // Items
+    ClipRect bounds; // Union of the visible bounds of its items.
+  };
+  std::vector<Item> items;
+  std::vector<uint32_t> next;
+  std::vector<Batch> batches;
+  std::vector<ClipRect> scissors{root};
+  items.reserve(mOps.size());
+  next.reserve(mOps.size());
+
+  for (uint32_t opIdx = 0; opIdx < mOps.size(); opIdx++) {
+    const DrawOp& op = mOps[opIdx];
+    if (op.type == DrawOpType::PushScissor) {
+      scissors.push_back(scissors.back().Intersect(op.bounds));
+      continue;
+    }
+    if (op.type == DrawOpType::PopScissor) {
+      if (scissors.size() > 1) scissors.pop_back(); // Never pops 'root'.
+      continue;
+    }
+
+    const ClipRect& scissor = scissors.back();
+    const ClipRect visible = op.bounds.Intersect(scissor);
+    if (visible.IsEmpty()) continue; // Culled.
+
+    const uint32_t itemIdx = items.size();
+    items.push_back({opIdx, scissor});
+    next.push_back(kNone);
+
+    // Walk back over the batches this op could still be drawn before.
+    size_t target = batches.size();
+    for (size_t b = batches.size(), n = 0; b-- > 0 && n < lookback; n++) {
+      const Batch& batch = batches[b];
+      const Item& head = items[batch.first];
+      if (head.scissor == scissor && CanBatch(mOps[head.opIdx], op)) {
+        target = b;
+        break;
+      }
+      if (batch.bounds.Overlaps(visible)) break; // Must stay after this one.
+    }
+
+    if (target == batches.size()) {
+      batches.push_back({itemIdx, itemIdx, visible});
+    } else {
+      Batch& batch = batches[target];
+      next[batch.last] = itemIdx;
+      batch.last = itemIdx;
+      batch.bounds = batch.bounds.Union(visible);
+    }
+  }
+
+  ordered.clear();
+  ordered.reserve(items.size());
+  for (const Batch& batch : batches) {
+    for (uint32_t idx = batch.first; idx != kNone; idx = next[idx]) {
+      ordered.push_back(items[idx]);
+    }
+  }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for the variable-sized data of a DisplayList.
+// Reset() keeps the blocks, so a list rebuilt every frame stops
+// allocating once it has seen its largest frame.
+class Arena {
+ public:
+  explicit Arena(size_t blockSize = 64 * 1024) : mBlockSize(blockSize) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  Arena(Arena&&) = default;
+  Arena& operator=(Arena&&) = default;
+
+  // Never returns nullptr. Valid until Reset().
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  void Reset();
+
+  size_t GetBytesUsed() const { return mBytesUsed; }
+
+ private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+  };
+
+  size_t mBlockSize;
+  std::vector<Block> mBlocks;
+  size_t mBlockIdx = 0; // Block currently allocated from.
+  size_t mOffset = 0; // Into mBlocks[mBlockIdx].
+  size_t mBytesUsed = 0;
+};
+
+enum class DrawOpType : uint8_t {
+  Rect,
+  Outline,
+  TexturedRect,
+  Text,
+  PushScissor, // Intersects the current scissor with 'bounds'.
+  PopScissor,
+};
+
+// Edges of an axis-aligned rect in FrameBuffer Coordinates.
+// right and bottom are exclusive.
+struct ClipRect {
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+
+  bool IsEmpty() const { return right <= left || bottom <= top; }
+  bool Overlaps(const ClipRect& other) const {
+    return left < other.right && other.left < right &&
+           top < other.bottom && other.top < bottom;
+  }
+  ClipRect Intersect(const ClipRect& other) const;
+  ClipRect Union(const ClipRect& other) const;
+  bool operator==(const ClipRect& other) const {
+    return left == other.left && top == other.top &&
+           right == other.right && bottom == other.bottom;
+  }
+};
+
+// One recorded Graphics2D call. Plain data, so lists can be copied with
+// memcpy and cached. Strings and texture coordinates live in the
+// owning DisplayList's Arena.
+struct DrawOp {
+  DrawOpType type;
+  ClipRect bounds; // Pixels the op may touch. The scissor for PushScissor.
+  float rgba[4];
+  float lineWidth; // Outline only.
+  int32_t resourceId; // ImageId_t of a TexturedRect, FontId_t of a Text run.
+  int32_t baselineX, baselineY; // Text only.
+  // TexturedRect: 8 floats, Top Left, Top Right, Bottom Right, Bottom Left.
+  // Text: 'payloadSize' characters.
+  const void* payload;
+  uint32_t payloadSize;
+};
+static_assert(std::is_trivially_copyable<DrawOp>::value, "DrawOp must stay POD");
+
+// Draw ops of a frame (or of part of one), in the order they were issued.
+//
+// Nothing here knows about Vulkan. Graphics2D appends to a DisplayList
+// while Views draw, calls Order() once the frame is complete, and only
+// then records Vulkan commands from the result.
+class DisplayList {
+ public:
+  // An op of the ordered list, along with the scissor it is drawn with.
+  struct Item {
+    uint32_t opIdx;
+    ClipRect scissor;
+  };
+
+  // State that must match for ops to share an instanced draw.
+  // (See Graphics2D::AddInstance)
+  static bool CanBatch(const DrawOp& a, const DrawOp& b);
+
+  void Clear();
+
+  void AddRect(const ClipRect& rect, const float rgba[4]);
+  void AddOutline(const ClipRect& rect, const float rgba[4], float lineWidth);
+  void AddTexturedRect(int32_t imageId, const ClipRect& rect,
+                       const float rgba[4], const float textureCoords[8]);
+  // 'bounds' covers every glyph of the run, which only the caller
+  // can compute as it depends on the font.
+  void AddText(int32_t fontId, const char* str, uint32_t length,
+               int32_t baselineX, int32_t baselineY,
+               const ClipRect& bounds, const float rgba[4]);
+  void PushScissor(const ClipRect& scissor);
+  void PopScissor();
+
+  // Appends all of 'other's ops, copying their payloads.
+  void Append(const DisplayList& other);
+
+  // Like Append(), but payloads are referenced instead of copied.
+  // 'other' must stay unchanged for as long as this list is used.
+  void AppendShared(const DisplayList& other);
+
+  const std::vector<DrawOp>& GetOps() const { return mOps; }
+  size_t GetSize() const { return mOps.size(); }
+  bool IsEmpty() const { return mOps.empty(); }
+
+  // Resolves scissor pushes and pops against 'root', drops ops that end
+  // up invisible, and reorders the rest so that ops which can share a
+  // batch become adjacent. An op only moves ahead of ops it does not
+  // overlap, so the rendered result is unchanged.
+  // 'lookback' bounds how many batches back an op is tried against,
+  // keeping this linear in the number of ops.
+  void Order(const ClipRect& root, std::vector<Item>& ordered,
+             size_t lookback = 32) const;
+
+ private:
+  DrawOp& AddOp(DrawOpType type, const ClipRect& bounds, const float rgba[4]);
+  const void* CopyPayload(const void* data, uint32_t size);
+
+  std::vector<DrawOp> mOps;
+  Arena mArena;
+};
@@ -0,0 +1,47 @@
+#include "DrawBatcher.h"
+
+#include <algorithm>
+
+size_t GetRecordingChunkCount(size_t opCount, size_t threadCount) {
+  const size_t chunkCount = std::min({threadCount, kMaxRecordingContexts,
+                                      opCount / kMinOpsPerRecordingChunk});
+  return std::max<size_t>(chunkCount, 1);
+}
+
+size_t GetRecordingChunkBegin(size_t opCount, size_t chunk, size_t chunkCount) {
+  return opCount * chunk / chunkCount;
+}
+
+void DrawBatcher::Clear() {
+  mBatches.clear();
+  mSize = 0;
+}
+
+VkDeviceSize DrawBatcher::Add(size_t pipelineIdx, VkDescriptorSet descriptorSet,
+                              const VkRect2D& scissor, float lineWidth, bool dynamicLineWidth,
+                              VkDeviceSize instanceSize, uint32_t count) {
+  bool extendsBatch = false;
+  if (!mBatches.empty()) {
+    const DrawBatch& last = mBatches.back();
+    extendsBatch = last.pipelineIdx == pipelineIdx &&
+                   last.descriptorSet == descriptorSet &&
+                   last.scissor.offset.x == scissor.offset.x &&
+                   last.scissor.offset.y == scissor.offset.y &&
+                   last.scissor.extent.width == scissor.extent.width &&
+                   last.scissor.extent.height == scissor.extent.height &&
+                   (!dynamicLineWidth || last.lineWidth == lineWidth);
+  }
+  // Pipelines differ in instance size. Each batch starts at a multiple of
+  // its own, so all batches draw from one binding using firstInstance.
+  const VkDeviceSize offset = extendsBatch ? mSize :
+      (mSize + instanceSize - 1) / instanceSize * instanceSize;
+
+  if (extendsBatch) {
+    mBatches.back().instanceCount += count;
+  } else {
+    mBatches.push_back({pipelineIdx, descriptorSet, scissor, lineWidth,
+                        static_cast<uint32_t>(offset / instanceSize), count});
+  }
+  mSize = offset + instanceSize * count;
+  return offset;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Frames with fewer ordered ops than this are recorded on one thread.
+static constexpr size_t kMinOpsPerRecordingChunk = 2048;
+static constexpr size_t kMaxRecordingContexts = 8;
+
+// Number of contiguous chunks 'opCount' ordered ops are split into,
+// to be recorded in parallel by up to 'threadCount' threads.
+size_t GetRecordingChunkCount(size_t opCount, size_t threadCount);
+// First ordered op of 'chunk'. A chunk ends where the next one begins.
+size_t GetRecordingChunkBegin(size_t opCount, size_t chunk, size_t chunkCount);
+
+// Run of consecutive instances drawn with the same state.
+struct DrawBatch {
+  size_t pipelineIdx;
+  VkDescriptorSet descriptorSet; // VK_NULL_HANDLE if untextured.
+  VkRect2D scissor;
+  float lineWidth;
+  uint32_t firstInstance; // Counted in instances of this pipeline's size.
+  uint32_t instanceCount;
+};
+
+// Lays out the instances of one chunk of ordered ops in an instance
+// buffer, grouped into batches in draw order. Batches never span chunks,
+// so a chunk boundary costs at most one more draw.
+// (See Graphics2D::RecordDisplayList())
+class DrawBatcher {
+ public:
+  // Forgets the batches and the layout. Done when a chunk is recorded.
+  void Clear();
+
+  // Places 'count' instances of 'instanceSize' bytes after the last ones,
+  // extending the last batch if it has the same state. The line width
+  // only matters to pipelines with a 'dynamicLineWidth'.
+  // Returns their offset in bytes.
+  VkDeviceSize Add(size_t pipelineIdx, VkDescriptorSet descriptorSet,
+                   const VkRect2D& scissor, float lineWidth, bool dynamicLineWidth,
+                   VkDeviceSize instanceSize, uint32_t count);
+
+  const std::vector<DrawBatch>& GetBatches() const { return mBatches; }
+  // Bytes of instances laid out.
+  VkDeviceSize GetSize() const { return mSize; }
+
+ private:
+  std::vector<DrawBatch> mBatches; // In draw order.
+  VkDeviceSize mSize = 0;
+};
@@ -131,12 +131,8 @@ void EditTextView::layout(int l, int t, int r, int b) {
 }
 
 void EditTextView::draw() {
-  GetGraphics()->UnsetScissor();
   // Draw Background.
-  Rect originalScissor; // TODO: Reset this
-  GetGraphics()->SetScissor(GetLeft(), GetTop(), 
-                            GetWidth(), GetHeight(), 
-                            originalScissor);
+  GetGraphics()->PushScissor(GetLeft(), GetTop(), GetWidth(), GetHeight());
   GetGraphics()->SetColor(mRGB[0], mRGB[1], mRGB[2], 1.f);
   GetGraphics()->DrawRect(mLeft, mTop, 
                                   mRight, mBottom);
@@ -201,7 +197,7 @@ void EditTextView::draw() {
     }
   }
 
-  GetGraphics()->UnsetScissor();
+  GetGraphics()->PopScissor();
   GetGraphics()->SetColor(mOutlineRGB[0], mOutlineRGB[1], mOutlineRGB[2], 1.f);
   GetGraphics()->DrawOutline(mLeft, mTop, mRight, mBottom);
 }
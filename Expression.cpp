@@ -1,7 +1,9 @@
 #include "Expression.h"
+#include "DenseTableau.h"
 #include "View.h"
 #include <array>
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -39,10 +41,25 @@ Variable Constraint::GetVar(const Box* const b, BoxAttribute attribute) {
       return b->GetWidthVar();
     case BoxAttribute::Height:
       return b->GetHeightVar();
+    case BoxAttribute::CenterX:
+      return b->GetCenterXVar();
+    case BoxAttribute::CenterY:
+      return b->GetCenterYVar();
+    default:
+      break;
   }
   return Variable();
 }
 
+Tableau2::Tableau2() = default;
+
+Tableau2::~Tableau2() {
+  for (auto& p : mRows) {
+    delete p.second;
+  }
+  mRows.clear();
+}
+
 std::string Tableau2::GetRep() const { 
   std::stringstream stream;
   stream << "Objective: " << mErrorObjectiveFunc << '\n';
@@ -61,11 +78,152 @@ std::string Tableau2::GetRep() const {
   return stream.str();
 }
 
+Expression<double> Tableau2::CanonicalExpression(const Expression<double>& e1, const Relation rel, const Expression<double>& e2) const {
+  Expression<double> e = e1 - e2;
+  if (rel == Relation::LessThanOrEqualTo) {
+    e *= -1;
+  }
+  for (const auto& var : e.GetVariables()) {
+    auto iter = mDerivedVars.find(var);
+    if (iter != mDerivedVars.end()) {
+      e.Substitute(var, iter->second);
+    }
+  }
+  return e;
+}
+
+bool Tableau2::MakeConstraintKey(const Expression<double>& canonical, const Relation rel, ConstraintKey& key) const {
+  // Coefficients are compared at ApproxEq() precision.
+  static constexpr double quantize = 1e6;
+  // llround() is undefined past the range of long long.
+  static constexpr double maxQuantized = 9e18;
+
+  key.relation = rel == Relation::EqualTo ? Relation::EqualTo : Relation::GreaterThanOrEqualTo;
+  key.terms.clear();
+  std::vector<Variable> vars = canonical.GetVariables();
+  std::sort(vars.begin(), vars.end(), [](const Variable& a, const Variable& b) {
+      return a.GetCode() < b.GetCode();
+  });
+
+  // Scale so the first coefficient is 1. (or -1 for inequalities,
+  // since they can only be scaled by positive numbers)
+  double scale = 1.0;
+  if (!vars.empty()) {
+    const double leading = canonical.GetCoefficient(vars[0]);
+    scale = key.relation == Relation::EqualTo ? 1 / leading : 1 / std::abs(leading);
+  }
+  auto quantized = [&](double value, int64_t& result) {
+    const double q = value * scale * quantize;
+    if (!(std::abs(q) < maxQuantized)) { // Also catches NaN.
+      return false;
+    }
+    result = std::llround(q);
+    return true;
+  };
+  for (const auto& var : vars) {
+    int64_t coefficient;
+    if (!quantized(canonical.GetCoefficient(var), coefficient)) {
+      return false;
+    }
+    key.terms.push_back({var.GetCode(), coefficient});
+  }
+  return quantized(canonical.GetConstant(), key.constant);
+}
+
+bool Tableau2::IsImpliedByRows(const Expression<double>& canonical, const Relation rel) const {
+  Expression<double> e(canonical);
+  for (const auto& var : canonical.GetVariables()) {
+    auto iter = mRows.find(var);
+    if (iter != mRows.end()) {
+      e.Substitute(var, *iter->second);
+    }
+  }
+  if (e.GetVariableCount() != 0) {
+    return false;
+  }
+  // The constraint reduced to a constant, for every solution of the tableau.
+  if (rel == Relation::EqualTo) {
+    return ApproxEq(e.GetConstant(), 0.0);
+  }
+  return e.GetConstant() >= 0.0 || ApproxEq(e.GetConstant(), 0.0);
+}
+
 void Tableau2::AddConstraint(const Expression<double>& e1, const Relation rel, const Expression<double>& e2, unsigned int strength) {
-  mSolved = false;
   assert(strength > 0 && strength <= Tableau2::REQUIRED && "AddConstraint: strength not in range E [0,1000]");
+
+  ConstraintGroup* group = GetActiveGroup(strength);
+
+  // Drop required constraints we already have. Optional ones are kept, each
+  // copy adds to the weight of the constraint. (Groups only hold optional
+  // constraints, so they're never deduplicated either)
+  ConstraintKey key;
+  bool hasKey = false;
+  if (strength == Tableau2::REQUIRED) {
+    const Expression<double> canonical = CanonicalExpression(e1, rel, e2);
+    hasKey = MakeConstraintKey(canonical, rel, key);
+    if (hasKey && mConstraintKeys.find(key) != mConstraintKeys.end()) {
+      mStats.duplicateConstraints++;
+      return;
+    }
+    if (IsImpliedByRows(canonical, rel)) {
+      mStats.redundantConstraints++;
+      if (hasKey) {
+        mConstraintKeys.insert(std::move(key));
+      }
+      return;
+    }
+  }
+  mStats.addedConstraints++;
+
+  FinishEdits();
+  mSolved = false;
+  mOptimal = false;
+  mVersion++;
   Expression<double>* expr = FormTableauExpression(e1, rel, e2, strength);
   std::cout << "Formed-Expr: " << *expr << std::endl;
+  InsertRow(expr, strength, group);
+  // Only once it's part of the tableau. An unsatisfiable constraint
+  // throws above, and adding it again has to throw again.
+  if (hasKey) {
+    mConstraintKeys.insert(std::move(key));
+  }
+}
+
+void Tableau2::AddFormedRow(const Expression<double>& formed, unsigned int strength) {
+  assert(strength > 0 && strength <= Tableau2::REQUIRED && "AddFormedRow: strength not in range E [0,1000]");
+  ConstraintGroup* group = GetActiveGroup(strength);
+  mStats.addedConstraints++;
+
+  FinishEdits();
+  mSolved = false;
+  mOptimal = false;
+  mVersion++;
+  Expression<double>* expr = new Expression<double>(formed);
+  SubstituteDerivedVariables(*expr);
+  InsertRow(expr, strength, group);
+}
+
+Tableau2::ConstraintGroup* Tableau2::GetActiveGroup(unsigned int strength) {
+  if (mActiveGroup.empty()) {
+    return nullptr;
+  }
+  if (strength == Tableau2::REQUIRED) {
+    throw std::runtime_error("Constraint groups can only contain non-required constraints");
+  }
+  return &mGroups[mActiveGroup];
+}
+
+void Tableau2::SubstituteDerivedVariables(Expression<double>& e) const {
+  for (const auto& var : e.GetVariables()) {
+    auto iter = mDerivedVars.find(var);
+    if (iter != mDerivedVars.end()) {
+      e.Substitute(var, iter->second);
+    }
+  }
+}
+
+void Tableau2::InsertRow(Expression<double>* expr, unsigned int strength, ConstraintGroup* group) {
+  InvalidateDense();
   std::vector<Variable> exprVars = expr->GetVariables();
   // Now its either Expression = 0 or Expression >= 0
 
@@ -77,7 +235,14 @@ void Tableau2::AddConstraint(const Expression<double>& e1, const Relation rel, c
         std::array<double, decltype(mErrorObjectiveFunc)::coefficient_type::num_coefficients> buff{};
         buff.fill(0.0);
         buff[buff.size() - strength]=1.0;
-        mErrorObjectiveFunc.AddVariable(var, buff);
+        mErrorWeights[var] = buff;
+        if (group) {
+          group->errorVars.push_back(var);
+        }
+        // Error vars of a disabled group are free, they join the objective once enabled.
+        if (!group || group->enabled) {
+          mErrorObjectiveFunc.AddVariable(var, buff);
+        }
       } 
     }
   }
@@ -168,6 +333,11 @@ void Tableau2::AddConstraint(const Expression<double>& e1, const Relation rel, c
 
 void Tableau2::Solve() {
   if (mSolved) return;
+  if (mOptimal) {
+    // Only edits moved row constants since the last Solve().
+    Resolve();
+    return;
+  }
   // This is Phase 2 of Two-Phase Simplex. 
   // We're already at a feasible solution. 
   // The only concern we have at this point
@@ -183,6 +353,145 @@ void Tableau2::Solve() {
   }
   Solve(mErrorObjectiveFunc);
   mSolved = true;
+  mOptimal = true;
+}
+
+void Tableau2::FinishEdits() {
+  if (mOptimal) {
+    Resolve();
+  }
+}
+
+void Tableau2::BeginGroup(const std::string& name) {
+  assert(mActiveGroup.empty() && "Tableau: Constraint groups don't nest");
+  assert(!name.empty() && "Tableau: Constraint group needs a name");
+  mActiveGroup = name;
+  mGroups[name];
+}
+
+void Tableau2::EndGroup() {
+  assert(!mActiveGroup.empty() && "Tableau: EndGroup without BeginGroup");
+  mActiveGroup.clear();
+}
+
+void Tableau2::SetGroupEnabled(const std::string& name, bool enabled) {
+  auto iter = mGroups.find(name);
+  if (iter == mGroups.end()) {
+    throw std::runtime_error("Unknown constraint group: " + name);
+  }
+  ConstraintGroup& group = iter->second;
+  if (group.enabled == enabled) return;
+  FinishEdits();
+  group.enabled = enabled;
+  InvalidateDense();
+
+  // A disabled constraint keeps its row, only its error variables stop
+  // costing anything. The rows therefore stay feasible and the next Solve()
+  // re-optimizes from the current basis, pivoting only as much as the
+  // changed objective needs. Basic error variables are substituted there.
+  const double sign = enabled ? 1.0 : -1.0;
+  for (const auto& var : group.errorVars) {
+    SymbolicWeight<REQUIRED> weight = mErrorWeights[var];
+    weight *= sign;
+    mErrorObjectiveFunc.AddVariable(var, weight);
+  }
+  mSolved = false;
+  mOptimal = false;
+  mVersion++;
+}
+
+bool Tableau2::IsGroupEnabled(const std::string& name) const {
+  auto iter = mGroups.find(name);
+  if (iter == mGroups.end()) {
+    throw std::runtime_error("Unknown constraint group: " + name);
+  }
+  return iter->second.enabled;
+}
+
+AffineSolution Tableau2::GetAffineSolution(const std::vector<std::vector<Variable>>& inputs,
+                                           const std::vector<Variable>& outputs) {
+  if (!mSolved) {
+    Solve();
+  }
+  const size_t stride = inputs.size() + 1;
+  AffineSolution solution;
+  solution.inputCount = inputs.size();
+
+  // Row constants move exactly as UpdateConstraint() would move them.
+  std::unordered_map<Variable, std::vector<double>> gradients;
+  auto gradient = [&](const Variable& basic) -> std::vector<double>& {
+    std::vector<double>& g = gradients[basic];
+    if (g.empty()) {
+      g.assign(inputs.size(), 0.0);
+    }
+    return g;
+  };
+  for (size_t i=0; i<inputs.size(); i++) {
+    for (const auto& editVar : inputs[i]) {
+      auto iter = mEditVarInfoMap.find(editVar);
+      if (iter == mEditVarInfoMap.end()) {
+        throw std::runtime_error("Affine solution input must be an edit var");
+      }
+      const EditVarInfo& editInfo = iter->second;
+      if (mRows.find(editInfo.plusErrorVar) != mRows.end()) {
+        gradient(editInfo.plusErrorVar)[i] -= 1.0;
+      } else if (mRows.find(editInfo.minusErrorVar) != mRows.end()) {
+        gradient(editInfo.minusErrorVar)[i] += 1.0;
+      } else {
+        for (const auto& row : mRows) {
+          const double coeff = row.second->GetCoefficient(editInfo.plusErrorVar);
+          if (coeff != 0.0) {
+            gradient(row.first)[i] += coeff;
+          }
+        }
+      }
+    }
+  }
+
+  // Parametric variables stay at 0, unknown ones match GetResult().
+  auto addTerms = [&](const Variable& var, double scale, double* out) {
+    auto rowIter = mRows.find(var);
+    if (rowIter == mRows.end()) {
+      if (mParametric.find(var) == mParametric.end()) {
+        out[0] += scale * -1.0;
+      }
+      return;
+    }
+    out[0] += scale * rowIter->second->GetConstant();
+    auto gradIter = gradients.find(var);
+    if (gradIter != gradients.end()) {
+      for (size_t i=0; i<inputs.size(); i++) {
+        out[i + 1] += scale * gradIter->second[i];
+      }
+    }
+  };
+
+  solution.outputs.assign(outputs.size() * stride, 0.0);
+  for (size_t o=0; o<outputs.size(); o++) {
+    double* out = &solution.outputs[o * stride];
+    auto derivedIter = mDerivedVars.find(outputs[o]);
+    if (derivedIter == mDerivedVars.end()) {
+      addTerms(outputs[o], 1.0, out);
+      continue;
+    }
+    const Expression<double>& definition = derivedIter->second;
+    out[0] += definition.GetConstant();
+    for (const auto& var : definition.GetVariables()) {
+      addTerms(var, definition.GetCoefficient(var), out);
+    }
+  }
+
+  // Rows which don't move with the inputs can't leave the region.
+  for (const auto& entry : gradients) {
+    bool moves = false;
+    for (double g : entry.second) {
+      moves = moves || !ApproxEq(g, 0.0);
+    }
+    if (!moves) continue;
+    solution.bounds.push_back(mRows[entry.first]->GetConstant());
+    solution.bounds.insert(solution.bounds.end(), entry.second.begin(), entry.second.end());
+  }
+  return solution;
 }
 
 Expression<double>* Tableau2::FormTableauExpression(const Expression<double>& e1, const Relation rel, const Expression<double>& e2, unsigned int strength) {
@@ -248,6 +557,11 @@ Expression<double>* Tableau2::FormTableauExpression(const Expression<double>& e1
       e->AddVariable(merror, 1);
     }
   }
+
+  // Replace derived variables with their definitions.
+  // Note: Done last, so a single derived variable (eg: Right = 100) is
+  //       still registered as an edit variable above.
+  SubstituteDerivedVariables(*e);
   return e;
 }
 
@@ -255,16 +569,26 @@ void Tableau2::Resolve() {
   if (mSolved) {
     return;
   }
+  if (!mOptimal) {
+    // The dual simplex needs an optimal basis. Rows only change while
+    // no edits are pending, (See UpdateConstraint()) so they're feasible.
+    Solve();
+    return;
+  }
   // Dual-Simplex Algorithm. Work from Unfeasible but optimal solution
   // to feasible and optimal.
-  std::cout << "Resolve:" << mErrorObjectiveFunc << std::endl;
+  if (UseDenseBackend()) {
+    ResolveDense();
+    mSolved = true;
+    return;
+  }
   while (true) {
     // Find exiting basic variable
     Variable exitingVar;
     for (const auto& row : mRows) {
-      if (row.second->GetConstant() < 0.0) {
+      if (row.second->GetConstant() < 0.0 &&
+          (exitingVar.GetCode() == Variable::Invalid || PivotsBefore(row.first, exitingVar))) {
         exitingVar = row.first;
-        break;
       }
     }
 
@@ -282,14 +606,12 @@ void Tableau2::Resolve() {
     
     const Expression<double>* row = mRows[exitingVar];
     for (const auto& var : row->GetVariables()) { 
-      std::cout << "Row Var" << var << std::endl;
       if (row->GetCoefficient(var) > 0.0) {
         // Min-Ratio Test 
         auto symbolicCoeff = mErrorObjectiveFunc.GetCoefficient(var); 
         symbolicCoeff *= (1/row->GetCoefficient(var));
-        std::cout << "" << var << " = " << symbolicCoeff << std::endl;
-        std::cout << "minRatio for " << var << " = " << symbolicCoeff << std::endl;
-        if (symbolicCoeff < minRatio) {
+        if (IsRatioLess(symbolicCoeff, minRatio) ||
+            (!IsRatioLess(minRatio, symbolicCoeff) && PivotsBefore(var, enteringVar))) {
           minRatio = symbolicCoeff;
           enteringVar = var;
         }
@@ -301,10 +623,66 @@ void Tableau2::Resolve() {
       throw std::runtime_error("Unsolvable Tableau");
     }
     
-    std::cout << "Entering Var: " << enteringVar << std::endl;
-    std::cout << "Exiting Var: " << exitingVar << std::endl;
     Pivot(enteringVar, exitingVar, mErrorObjectiveFunc);
   }
   mSolved = true;
 }
 
+
+bool Tableau2::UseDenseBackend() const {
+  switch (mBackend) {
+    case TableauBackend::Dense:
+      return true;
+    case TableauBackend::Sparse:
+      return false;
+    default:
+      // Parametric set may still hold a few stale entries. Close enough
+      // for picking a backend.
+      return mRows.size() + mParametric.size() <= kDenseMaxVariables;
+  }
+}
+
+void Tableau2::SolveDense(Expression<double>& objective) {
+  // Phase-1 objectives are one-off, only the error objective is kept.
+  InvalidateDense();
+  DenseTableau dense(mRows, objective);
+  dense.Solve();
+  dense.Store(mRows, mParametric);
+  dense.StoreObjective(objective);
+}
+
+void Tableau2::SolveDense(Expression<SymbolicWeight<REQUIRED>>& objective) {
+  if (&objective != &mErrorObjectiveFunc) {
+    InvalidateDense();
+    DenseTableau dense(mRows, objective);
+    dense.Solve();
+    dense.Store(mRows, mParametric);
+    dense.StoreObjective(objective);
+    return;
+  }
+  if (mDense) {
+    mDense->LoadConstants(); // Edits only move row constants.
+  } else {
+    mDense = std::make_unique<DenseTableau>(mRows, mErrorObjectiveFunc);
+  }
+  if (mDense->Solve() > 0) {
+    mDense->Store(mRows, mParametric);
+    mDense->StoreObjective(mErrorObjectiveFunc);
+  }
+}
+
+void Tableau2::ResolveDense() {
+  if (mDense) {
+    mDense->LoadConstants();
+  } else {
+    mDense = std::make_unique<DenseTableau>(mRows, mErrorObjectiveFunc);
+  }
+  if (mDense->Resolve() > 0) {
+    mDense->Store(mRows, mParametric);
+    mDense->StoreObjective(mErrorObjectiveFunc);
+  }
+}
+
+void Tableau2::InvalidateDense() {
+  mDense.reset();
+}
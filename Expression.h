@@ -1,8 +1,11 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <initializer_list>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <unordered_map>
@@ -12,6 +15,8 @@
 #include <limits>
 #include <algorithm>
 
+#include "WorkerPool.h"
+
 // Future TODOs
 //  2. Change Variable::name type to std::string_view.
 //      - And make class-static map to manage lifetime of string allocation.
@@ -22,6 +27,7 @@
 static bool ApproxEq(const double a, const double b);
 
 class Box;
+class DenseTableau;
 
 enum class BoxAttribute {
   Left,
@@ -30,7 +36,8 @@ enum class BoxAttribute {
   Bottom,
   Width,
   Height,
-  // Add CenterX, Add CenterY Attributes
+  CenterX, // Left + Width/2
+  CenterY, // Top + Height/2
   NoAttribute
 };
 
@@ -47,6 +54,13 @@ enum class VariableType {
   Artificial, 
 };
 
+// Row storage used by Tableau2 while solving.
+enum class TableauBackend {
+  Automatic, // Dense for small tableaus, Sparse otherwise.
+  Sparse,    // Hash-map Expression rows.
+  Dense,     // Row-major matrix. See DenseTableau.h
+};
+
 enum ConstraintStrength {
   REQUIRED=5,
   STRONG=3,
@@ -58,6 +72,41 @@ class Expression;
 template<size_t N>
 class SymbolicWeight;
 
+// Makes Variable codes generated on the constructing thread come from a
+// private counter while the scope is alive. Building the same tableau
+// inside a fresh scope then yields the same codes, hash order and pivots
+// on every run, no matter what other threads are doing.
+// Scoped codes start far above the global counter, so variables from
+// outside the scope (eg: the window's) can share its tableau. Variables
+// from two different scopes must not.
+class VariableCodeScope {
+ public:
+  static constexpr int kFirstCode = 1 << 30;
+
+  VariableCodeScope() : mNextCode(kFirstCode), mPrevious(sCurrent) {
+    sCurrent = this;
+  }
+  VariableCodeScope(const VariableCodeScope&) = delete;
+  ~VariableCodeScope() {
+    sCurrent = mPrevious;
+  }
+
+  VariableCodeScope& operator=(const VariableCodeScope&) = delete;
+
+  static VariableCodeScope* GetCurrent() {
+    return sCurrent;
+  }
+
+  int Next() {
+    return mNextCode++;
+  }
+
+ private:
+  int mNextCode;
+  VariableCodeScope* mPrevious;
+  inline static thread_local VariableCodeScope* sCurrent = nullptr;
+};
+
 // Variable.
 // Two Variables are the same by Value-Equality. 
 // Hence, we don't maintain a single variable object. there 
@@ -80,10 +129,13 @@ class Variable {
   // Assignment Operator
   Variable& operator=(const Variable& v) = default;
 
+  // Thread-safe. See VariableCodeScope for deterministic codes.
   static int GenerateCode() {
-    static int globalcode = 0;
-    globalcode++;
-    return globalcode;
+    if (VariableCodeScope* scope = VariableCodeScope::GetCurrent()) {
+      return scope->Next();
+    }
+    static std::atomic<int> globalcode{0};
+    return ++globalcode;
   }
 
   bool operator==(const Variable& v) const {
@@ -122,6 +174,14 @@ struct hash<Variable> {
 };
 }
 
+// Order pivot rules use to break ties, so the sparse and dense
+// Tableau2 backends pick the same variables and reach the same vertex.
+inline bool PivotsBefore(const Variable& a, const Variable& b) {
+  if (a.GetCode() != b.GetCode()) return a.GetCode() < b.GetCode();
+  if (a.GetType() != b.GetType()) return a.GetType() < b.GetType();
+  return a.GetName() < b.GetName();
+}
+
 template<size_t Coefficients=5>
 struct SymbolicWeight {
  static constexpr size_t num_coefficients = Coefficients;
@@ -249,8 +309,7 @@ class Expression {
     mTerms[v] += CoefficientType(1.0);
   }
 
-  Expression(Expression&& e) {
-    mTerms = std::move(e.mTerms);
+  Expression(Expression&& e) : mTerms(std::move(e.mTerms)), mConstant(e.mConstant) {
   }
   
   // = default should work yea?
@@ -354,7 +413,7 @@ class Expression {
   }
   
   Expression operator-(const Variable& v) const {
-    return *this + (v*1.0);
+    return *this + (v*-1.0);
   }
 
   Expression operator-(const Expression& e) const {
@@ -429,6 +488,18 @@ class Expression {
     return *this;
   }
 
+  // Renames variables found in 'mapping'. Others are kept as they are.
+  Expression Remap(const std::unordered_map<Variable, Variable>& mapping) const {
+    Expression result;
+    result.mConstant = mConstant;
+    result.mTerms.reserve(mTerms.size());
+    for (const auto& term : mTerms) {
+      auto iter = mapping.find(term.first);
+      result.mTerms[iter == mapping.end() ? term.first : iter->second] += term.second;
+    }
+    return result;
+  }
+
   bool ContainsVar(const Variable& v) const {
     return mTerms.count(v) > 0;
   }
@@ -532,6 +603,22 @@ static Expression<double> operator-(const Variable& v1, const Variable& v2) {
   return e;
 }
 
+static Expression<double> operator+(const Variable& v, const Expression<double>& e) {
+  return e + v;
+}
+
+static Expression<double> operator-(const Variable& v, const Expression<double>& e) {
+  return Expression<double>(v) - e;
+}
+
+static Expression<double> operator+(const Variable& v, double c) {
+  return Expression<double>(v) + c;
+}
+
+static Expression<double> operator-(const Variable& v, double c) {
+  return Expression<double>(v) + (-c);
+}
+
 // XXX: 
 // - We're essentially limiting ourselves to two variables, since we're specifying
 // Box and its' attribute --> Which gives a single variable.
@@ -585,6 +672,39 @@ class Constraint {
   int mStrength;
 };
 
+// General linear constraint: lhs <Relation> rhs.
+// Either side can hold any number of terms, eg:
+//   a.CenterX = 0.5*b.Left + 0.5*c.Right
+//   a.Width + b.Width <= window.Width - 20
+// Box attributes are used through Box::Get*Var().
+class LinearConstraint {
+ public:
+  LinearConstraint(const Expression<double>& lhs, Relation r, const Expression<double>& rhs, int strength = REQUIRED) : 
+      mLeft(lhs), mRight(rhs), mRelation(r), mStrength(strength) {}
+
+  const Expression<double>& GetLeftExpression() const {
+    return mLeft;
+  }
+
+  const Expression<double>& GetRightExpression() const {
+    return mRight;
+  }
+
+  Relation GetRelation() const {
+    return mRelation;
+  }
+
+  int GetStrength() const {
+    return mStrength;
+  }
+
+ private:
+  Expression<double> mLeft;
+  Expression<double> mRight;
+  Relation mRelation;
+  int mStrength;
+};
+
 // How do I choose Basic Variable?
 // That's part of Phase 1, yea?
 
@@ -599,6 +719,26 @@ class Constraint {
 // Pivoting is easy with a tableau.
 // Iterate through all rows
 
+// Counters reported by Tableau2::GetStats()
+struct TableauStats {
+  size_t rows = 0;
+  size_t parametricVariables = 0;
+  size_t addedConstraints = 0;     // Constraints that were added to the tableau.
+  size_t duplicateConstraints = 0; // Exact duplicates of an earlier required constraint. Dropped.
+  size_t redundantConstraints = 0; // Required constraints already implied by the tableau. Dropped.
+};
+
+// Solution of a Tableau2 as an affine function of a few inputs.
+// See Tableau2::GetAffineSolution().
+struct AffineSolution {
+  size_t inputCount = 0;
+  // Per output: value, then d(value)/d(input) for every input.
+  std::vector<double> outputs;
+  // Per row, same layout. The basis stays optimal (and the
+  // outputs exact) while every row's value stays >= 0.
+  std::vector<double> bounds;
+};
+
 // Ok, so how do I represent constraints?
 // How do I represent Variables?
 class Tableau2 {
@@ -609,6 +749,30 @@ class Tableau2 {
      double originalValue;
    }; 
 
+   // Canonical form of a required constraint. Two constraints with equal
+   // keys are the same constraint. eg: A = B and 2B = 2A.
+   struct ConstraintKey {
+     Relation relation; // EqualTo or GreaterThanOrEqualTo
+     std::vector<std::pair<int, int64_t>> terms; // Sorted by variable code. Quantized coefficients.
+     int64_t constant;
+
+     bool operator==(const ConstraintKey& k) const {
+       return relation == k.relation && constant == k.constant && terms == k.terms;
+     }
+   };
+
+   struct ConstraintKeyHash {
+     size_t operator()(const ConstraintKey& k) const {
+       size_t h = std::hash<int>{}(static_cast<int>(k.relation));
+       h = h * 31 + std::hash<int64_t>{}(k.constant);
+       for (const auto& term : k.terms) {
+         h = h * 31 + std::hash<int>{}(term.first);
+         h = h * 31 + std::hash<int64_t>{}(term.second);
+       }
+       return h;
+     }
+   };
+
   public:
    void AddConstraint(Constraint* const c) {
       assert(c && "Tableau: Can't Add nullptr Constraint");
@@ -623,15 +787,81 @@ class Tableau2 {
       AddConstraint(eOne, c->GetRelation(), eTwo, c->GetStrength());
    }
 
+   void AddConstraint(const LinearConstraint& c) {
+      AddConstraint(c.GetLeftExpression(), c.GetRelation(), c.GetRightExpression(), c.GetStrength());
+   }
+
    void AddConstraint(const Expression<double>& e1, const Relation r, const Expression<double>& e2, unsigned int strength=REQUIRED);
    Expression<double>* FormTableauExpression(const Expression<double>& e1, const Relation r, const Expression<double>& e2, unsigned int strength=REQUIRED);
 
+   // Adds a row already in tableau form, as returned by
+   // FormTableauExpression(). Skips duplicate detection, and its slack and
+   // error variables must be new to this tableau. (See ConstraintTemplate)
+   // Edit variables can't be added this way.
+   void AddFormedRow(const Expression<double>& formed, unsigned int strength=REQUIRED);
+
    bool ContainsVar(const Variable& var) {
-     return (mParametric.find(var) != mParametric.end()) || (mRows.find(var) != mRows.end());
+     return (mParametric.find(var) != mParametric.end()) || (mRows.find(var) != mRows.end()) ||
+            (mDerivedVars.find(var) != mDerivedVars.end());
+   }
+
+   // A derived variable never gets a row or column of its own. It is
+   // replaced by its definition whenever a constraint is formed, and
+   // evaluated from it in GetResult().
+   // eg: Box Right = Left + Width.
+   void AddDerivedVariable(const Variable& var, const Expression<double>& definition) {
+     for (const auto& v : definition.GetVariables()) {
+       assert(mDerivedVars.find(v) == mDerivedVars.end() && "Derived variable defined in terms of another derived variable");
+     }
+     mDerivedVars[var] = definition;
+     mVersion++;
+   }
+
+   // Edits of an input variable don't change GetVersion(). (eg: window size)
+   void AddInputVariable(const Variable& editVar) {
+     mInputVars.insert(editVar);
+   }
+
+   // Bumped by every change to the constraint set, other than edits of
+   // input variables. Results cached for a version stay valid until then.
+   uint64_t GetVersion() const {
+     return mVersion;
+   }
+
+   // Closed form of the current optimal basis. Each input moves all of
+   // its edit variables by the same amount, and every term is relative to
+   // the edit values the tableau is currently solved at.
+   // Outputs may be derived variables.
+   AffineSolution GetAffineSolution(const std::vector<std::vector<Variable>>& inputs,
+                                    const std::vector<Variable>& outputs);
+
+   bool IsDerivedVariable(const Variable& var) const {
+     return mDerivedVars.find(var) != mDerivedVars.end();
+   }
+
+   // Constraints added between BeginGroup() and EndGroup() belong to a
+   // named group, which can be switched on and off as a unit.
+   // eg: One group per breakpoint of a responsive layout.
+   // Only non-required constraints can be grouped. Switching a group
+   // changes their error weights and re-solves on the next Solve().
+   void BeginGroup(const std::string& name);
+   void EndGroup();
+   void EnableGroup(const std::string& name) {
+     SetGroupEnabled(name, true);
+   }
+   void DisableGroup(const std::string& name) {
+     SetGroupEnabled(name, false);
    }
+   bool IsGroupEnabled(const std::string& name) const;
     
    // EditVar's are of the form, editVar 
    void UpdateConstraint(const Variable& editVar, const double newValue) {
+     // Edits are repaired by the dual simplex, (See Resolve()) which needs
+     // an optimal basis. Rows and objective changes since the last Solve()
+     // are optimized first, while the rows are still feasible.
+     if (!mOptimal) {
+       Solve();
+     }
      mSolved = false;
     // XXX: Note, We do NOT update constant term in error objective function.
     //      It seems to be easily do-able though:
@@ -647,6 +877,9 @@ class Tableau2 {
     if (iter == mEditVarInfoMap.end()) {
       throw std::runtime_error("Can't modify non-edit var");
     }
+    if (mInputVars.find(editVar) == mInputVars.end()) {
+      mVersion++;
+    }
     EditVarInfo& editInfo = iter->second;
     const double difference = newValue - editInfo.originalValue;
 
@@ -711,9 +944,19 @@ class Tableau2 {
      mObjectiveFunction.Reset();
      mErrorObjectiveFunc.Reset();
      mEditVarInfoMap.clear();
+     mDerivedVars.clear();
+     mConstraintKeys.clear();
+     mErrorWeights.clear();
+     mGroups.clear();
+     mActiveGroup.clear();
+     mInputVars.clear();
+     mVersion++;
+     mStats = TableauStats();
      mAddedArtificialVarCount = 0;
      mAddedExpressions = 0;
      mSolved = true;
+     mOptimal = true;
+     InvalidateDense();
    }
    
    template<typename T>
@@ -722,6 +965,22 @@ class Tableau2 {
    void Solve();
    void Resolve();
 
+   void SetBackend(TableauBackend backend) {
+     mBackend = backend;
+     InvalidateDense();
+   }
+
+   TableauBackend GetBackend() const {
+     return mBackend;
+   }
+
+   // Pivots which touch at least 'minRows' rows substitute them
+   // in parallel on 'pool'. nullptr uses WorkerPool::GetShared().
+   void SetParallelPivot(WorkerPool* pool, size_t minRows = kParallelPivotMinRows) {
+     mWorkerPool = pool;
+     mParallelPivotMinRows = minRows;
+   }
+
 
    void ProduceSolverConstraints();
    std::string GetRep() const;
@@ -730,6 +989,16 @@ class Tableau2 {
       if (!mSolved) {
         Solve();
       }
+      auto derivedIter = mDerivedVars.find(v);
+      if (derivedIter != mDerivedVars.end()) {
+        const Expression<double>& definition = derivedIter->second;
+        double result = definition.GetConstant();
+        for (const auto& var : definition.GetVariables()) {
+          result += definition.GetCoefficient(var) * GetResultOrDefault(var, 0.0);
+        }
+        return result;
+      }
+
       auto iter = mRows.find(v);
       if (iter != mRows.end()) {
         return iter->second->GetConstant();
@@ -746,22 +1015,76 @@ class Tableau2 {
    double GetResult(const Variable& v) {
     return GetResultOrDefault(v, -1.0);
    }
+
+   TableauStats GetStats() const {
+     TableauStats stats = mStats;
+     stats.rows = mRows.size();
+     stats.parametricVariables = mParametric.size();
+     return stats;
+   }
    
    static constexpr int REQUIRED=5;
    static constexpr int STRONG=4; 
    static constexpr int WEAK=2;
 
-   ~Tableau2() {
-     for (auto& p : mRows) {
-       delete p.second;
-     }
-     mRows.clear();
-   }
+   // Automatic backend switches to the dense tableau
+   // at or below this many variables.
+   static constexpr size_t kDenseMaxVariables = 64;
+
+   // Row count above which Pivot() fans out to the worker pool, and
+   // how many rows each job gets.
+   static constexpr size_t kParallelPivotMinRows = 2048;
+   static constexpr size_t kParallelPivotChunkRows = 256;
+
+   Tableau2();
+   ~Tableau2();
  
  private:
     template<typename T>
     void Pivot(const Variable& enteringVar, const Variable& exitingVar, Expression<T>& mObjectiveFunction);
-   
+
+    // e1 - e2 as '= 0' or '>= 0', with derived variables substituted.
+    Expression<double> CanonicalExpression(const Expression<double>& e1, const Relation r, const Expression<double>& e2) const;
+    // False if a coefficient is too large to quantize. Such constraints
+    // skip duplicate detection.
+    bool MakeConstraintKey(const Expression<double>& canonical, const Relation r, ConstraintKey& key) const;
+    // True iff required constraint 'canonical' always holds given current rows.
+    bool IsImpliedByRows(const Expression<double>& canonical, const Relation r) const;
+
+    void SetGroupEnabled(const std::string& name, bool enabled);
+
+    // Same test as DenseTableau::IsObjectiveNegative(). Levels that are
+    // ApproxEq() to 0 are rounding left over from earlier pivots.
+    static bool IsObjectiveNegative(double coeff) {
+      return !ApproxEq(coeff, 0.0) && coeff < 0.0;
+    }
+    static bool IsObjectiveNegative(const SymbolicWeight<REQUIRED>& coeff) {
+      for (size_t level=0; level<coeff.num_coefficients; level++) {
+        if (ApproxEq(coeff.mCoefficients[level], 0.0)) continue;
+        return coeff.mCoefficients[level] < 0.0;
+      }
+      return false;
+    }
+    // Lexicographic a < b, with the same tolerance.
+    static bool IsRatioLess(const SymbolicWeight<REQUIRED>& a, const SymbolicWeight<REQUIRED>& b) {
+      for (size_t level=0; level<a.num_coefficients; level++) {
+        if (ApproxEq(a.mCoefficients[level], b.mCoefficients[level])) continue;
+        return a.mCoefficients[level] < b.mCoefficients[level];
+      }
+      return false;
+    }
+
+    bool UseDenseBackend() const;
+    void SolveDense(Expression<double>& objective);
+    void SolveDense(Expression<SymbolicWeight<REQUIRED>>& objective);
+    void ResolveDense();
+    // Drops the dense tableau kept between calls. Needed whenever rows or
+    // the error objective change other than through edit constants.
+    void InvalidateDense();
+    // Repairs pending edits before rows or the objective change, so the
+    // primal simplex gets feasible rows.
+    void FinishEdits();
+
      // Constraints added by the User
      std::vector<Constraint*> mExternalConstraints;
 
@@ -777,28 +1100,59 @@ class Tableau2 {
      std::unordered_map<Variable, EditVarInfo> mEditVarInfoMap; // An EditVarInfo 
                                                              // is created for each constraint
                                                              // which is eligible to be one.
+
+     std::unordered_map<Variable, Expression<double>> mDerivedVars;
+
+     std::unordered_set<ConstraintKey, ConstraintKeyHash> mConstraintKeys;
+
+     struct ConstraintGroup {
+       std::vector<Variable> errorVars;
+       bool enabled = true;
+     };
+     // Group constraints are currently added to, if any. Throws for required constraints.
+     ConstraintGroup* GetActiveGroup(unsigned int strength);
+     void SubstituteDerivedVariables(Expression<double>& e) const;
+     // Makes formed row 'expr' part of the tableau, taking ownership.
+     void InsertRow(Expression<double>* expr, unsigned int strength, ConstraintGroup* group);
+
+     // Symbolic weight each error variable was added to the objective with.
+     std::unordered_map<Variable, SymbolicWeight<REQUIRED>> mErrorWeights;
+     std::unordered_map<std::string, ConstraintGroup> mGroups;
+     std::string mActiveGroup;
+     std::unordered_set<Variable> mInputVars;
+     uint64_t mVersion = 0;
+     TableauStats mStats;
      
      int mAddedArtificialVarCount = 0;
      int mAddedExpressions = 0;
      bool mSolved = true;
+     // Whether mErrorObjectiveFunc is minimal for mRows, apart from edits
+     // to their constants. False after rows are added or groups switched.
+     bool mOptimal = true;
+     TableauBackend mBackend = TableauBackend::Automatic;
+     WorkerPool* mWorkerPool = nullptr;
+     size_t mParallelPivotMinRows = kParallelPivotMinRows;
+     // Dense copy of mRows and mErrorObjectiveFunc, kept while only edit
+     // constants change, so a Resolve() per edit doesn't reload the matrix.
+     std::unique_ptr<DenseTableau> mDense;
 }; 
 
 template<typename T>
 void Tableau2::Solve(Expression<T>& objectiveFunction) {
-  std::cout << "Solve: " << objectiveFunction << std::endl;
-  std::cout << GetRep() << std::endl;
+  if (UseDenseBackend()) {
+    SolveDense(objectiveFunction);
+    return;
+  }
   while (true) {
     // Find an entry variable.
     Variable enteringVar;
     std::vector<Variable> objVars = objectiveFunction.GetVariables();
     // I really should add a Expression::TermIterator of some sort.  
     for (auto& var : objVars) {
-      if (objectiveFunction.GetCoefficient(var) != 0.0 && objectiveFunction.GetCoefficient(var) < 0.0) { 
-        // XXX: Make sure coefficient is not ApproxEq(i,0.0)
-        //      Since it could happen...
-       
-        enteringVar = var;
-        break;
+      if (IsObjectiveNegative(objectiveFunction.GetCoefficient(var))) { 
+        if (enteringVar.GetCode() == Variable::Invalid || PivotsBefore(var, enteringVar)) {
+          enteringVar = var;
+        }
       }
     }  
     
@@ -814,7 +1168,7 @@ void Tableau2::Solve(Expression<T>& objectiveFunction) {
       // TODO:What was rule for those rows with zero?
       if (expr->GetCoefficient(enteringVar) < 0.0) {
         double ratio = -expr->GetConstant() / expr->GetCoefficient(enteringVar);
-        if (ratio < minRatio) {
+        if (ratio < minRatio || (ratio == minRatio && PivotsBefore(pair.first, exitingVar))) {
           minRatio = ratio;
           exitingVar = pair.first;
         }
@@ -826,11 +1180,7 @@ void Tableau2::Solve(Expression<T>& objectiveFunction) {
       throw std::runtime_error("Unbounded Problem"); 
     }
     
-    std::cout << "Pivot" << "EnteringVar: " << enteringVar.GetName() << std::endl;
-    std::cout << "Pivot" << "ExitingVar: " << exitingVar.GetName() << std::endl;
     Pivot(enteringVar, exitingVar, objectiveFunction);
-    std::cout << "Pivot Complete" << std::endl;
-    std::cout << GetRep() << std::endl;
   }  
 }
 
@@ -846,9 +1196,32 @@ void Tableau2::Pivot(const Variable& enteringVar, const Variable& exitingVar, Ex
   row->AddVariable(exitingVar, -1);
   *row *= (-1/enterCoeff);
   
-  objective.Substitute(enteringVar, *row);
+  // Only rows that contain the entering variable change.
+  std::vector<Expression<double>*> hits;
   for (auto& pair : mRows) {
-    pair.second->Substitute(enteringVar, *row);
+    if (pair.second->ContainsVar(enteringVar)) {
+      hits.push_back(pair.second);
+    }
+  }
+
+  if (hits.size() < mParallelPivotMinRows) {
+    objective.Substitute(enteringVar, *row);
+    for (auto* expr : hits) {
+      expr->Substitute(enteringVar, *row);
+    }
+  } else {
+    // Every row is substituted independently of the others, so the
+    // result doesn't depend on how rows are split between threads.
+    WorkerPool& pool = mWorkerPool ? *mWorkerPool : WorkerPool::GetShared();
+    const size_t jobCount = (hits.size() + kParallelPivotChunkRows - 1) / kParallelPivotChunkRows;
+    pool.Dispatch(jobCount, [&](size_t job) {
+      const size_t end = std::min(hits.size(), (job + 1) * kParallelPivotChunkRows);
+      for (size_t i=job*kParallelPivotChunkRows; i<end; i++) {
+        hits[i]->Substitute(enteringVar, *row);
+      }
+    });
+    objective.Substitute(enteringVar, *row); // Overlaps with the row updates.
+    pool.Wait();
   }
   
   mParametric.erase(enteringVar);
@@ -1,5 +1,6 @@
 #include "Font.h"
 
+#include <atomic>
 #include <cstdio>
 #include <cstdint>
 #include <fstream>
@@ -40,7 +41,7 @@ Text::Text(VkDevice device, VkPhysicalDevice phyDev) : Text() {
 }
 
 FontId_t Text::AddFont(const std::string& typefaceFile, const uint32_t pointSize, VkQueue queue, VkCommandBuffer commandBuffer) {
-  static int fontIds = 1;
+  static std::atomic<FontId_t> fontIds{1}; // Only id allocation is thread-safe.
   if (mFontIdMap.find({typefaceFile, pointSize}) != mFontIdMap.end()) {
     return mFontIdMap[{typefaceFile, pointSize}];
   }
@@ -110,6 +111,21 @@ FontId_t Text::AddFont(const std::string& typefaceFile, const uint32_t pointSize
     }
 
     fontInfo.glyphMap[charcode] = glyph;
+
+    // Only the glyph's bitmap is sampled, even if the quad is wider.
+    auto normalize = [](uint64_t coord, uint64_t size) {
+      return static_cast<uint16_t>((coord * 0xFFFF + size / 2) / size);
+    };
+    GlyphQuad& quad = fontInfo.glyphTable[charcode];
+    quad.present = true;
+    quad.width = glyph.width;
+    quad.height = glyph.height;
+    quad.baselineYOffset = glyph.baselineYOffset;
+    quad.horizontalAdvance = glyph.horizontalAdvance;
+    quad.atlasRect[0] = normalize(glyphOffset, atlasWidth);
+    quad.atlasRect[1] = 0;
+    quad.atlasRect[2] = normalize(glyphOffset + ftFace->glyph->bitmap.width, atlasWidth);
+    quad.atlasRect[3] = normalize(ftFace->glyph->bitmap.rows, atlasHeight);
     glyphOffset += ftFace->glyph->bitmap.width + xOffset; 
   } 
   fontInfo.atlasWidth = atlasWidth;
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
+#include "Glyph.h"
 #include "Image.h"
 
 // Vulkan
@@ -35,6 +38,7 @@ struct FontInfo {
   int atlasHeight;
   Image fontAtlas; // Font Atlas
   GlyphMap2 glyphMap;
+  GlyphTable glyphTable; // Same glyphs as glyphMap.
 };
 
 using FontId_t = int;
@@ -64,6 +68,9 @@ class Text {
    Text& operator=(const Text&) = delete;
    Text& operator=(Text&&) = default;
 
+   // Font ids are unique across all Text instances and threads. The font
+   // maps and the upload through 'queue' aren't synchronized though, so
+   // call it from the thread which renders with this Text.
    FontId_t AddFont(const std::string& typefaceFile, 
                     const uint32_t pointSize, 
                     VkQueue queue, VkCommandBuffer);
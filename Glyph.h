@@ -0,0 +1,18 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Glyph2 (See Font.h) as needed to draw it. Looked up by character code
+// instead of hashing on every character. (See Graphics2D::DrawText)
+struct GlyphQuad {
+  bool present = false; // False if the font has no glyph for the character.
+  int16_t width = 0; // Size of the quad drawn
+  int16_t height = 0;
+  int16_t baselineYOffset = 0;
+  int16_t horizontalAdvance = 0;
+  uint16_t atlasRect[4] = {}; // left, top, right, bottom in the font atlas,
+                              // Normalized to [0, 0xFFFF]
+};
+
+using GlyphTable = std::array<GlyphQuad, 128>; // ASCII
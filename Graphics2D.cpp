@@ -2,11 +2,16 @@
 
 #include "Image.h"
 #include "Font.h"
+#include "Profiler.h"
+#include "WorkerPool.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <exception>
+#include <memory>
 #include <fstream>
 #include <vector>
 #include <unordered_set>
@@ -22,6 +27,7 @@
 #include "shaderLineFS.h"
 #include "shaderTexturedVS.h"
 #include "shaderTexturedFS.h"
+#include "shaderTextVS.h"
 #include "shaderTextFS.h"
 
 #define VULKAN_CALL_CHECK(res)                                                 \
@@ -35,30 +41,107 @@ static const std::vector<const char *> enabledInstanceLayers = {
 static const std::vector<const char *> enabledInstanceExtensions = {
     "VK_KHR_surface", "VK_KHR_xlib_surface"};
 const std::vector<const char *> enabledDeviceExtensions = {"VK_KHR_swapchain"};
+// Needed for the texture array, on devices where it isn't core (< 1.2).
+static const char* kDescriptorIndexingExtension = "VK_EXT_descriptor_indexing";
 
-// TODO: Switch to using Vertex Buffers!
-
-
-// Used to Populate Push Constant
+// Used to Populate Push Constant. Per-quad data lives
+// in the instance buffer. (See Graphics2D::QuadInstance)
 // Packed to match std430 layout
-struct __attribute__((packed)) PushConstantQuadInfo {
-  int32_t QuadCoords[4]; // In FrameBuffer Coordinates.
+struct __attribute__((packed)) PushConstantFrameInfo {
   uint32_t frameBufferSize[2];
-  float rgb[4];
-  vec2 textureCoords[4]; // Normalized Coordinates [0, 1]
-                         // Top Left, Top Right, Bottom Right, BottomLeft
 };
 
+// Length of the texture array, shared by all Images and Fonts.
+// Must match the array in shaderTexturedQuad.frag and shaderText.frag.
+static constexpr uint32_t kMaxTextures = 1024;
+
+// Images up to this size, in both dimensions, go into atlas pages.
+static constexpr int kMaxAtlasedImageSize = 256;
+static constexpr int kAtlasPageSize = 1024;
+// Left free right and below each atlased image, so sampling at its edge 
+// never reads its neighbour.
+static constexpr int kAtlasPadding = 1;
+
+// Only id allocation is thread-safe. (See AddImage())
+static std::atomic<ImageId_t> nextImageId{1};
+
+// Instance buffer capacity of a new frame, in bytes. Grows on demand.
+static constexpr VkDeviceSize kInitialInstanceBufferSize = 4096 * 64;
+
+// Vertex input of the quad pipelines: one QuadInstance per instance,
+// vertices are generated from gl_VertexIndex.
+struct QuadVertexInput {
+  VkVertexInputBindingDescription binding;
+  std::array<VkVertexInputAttributeDescription, 7> attributes;
+  VkPipelineVertexInputStateCreateInfo info;
+
+  explicit QuadVertexInput(uint32_t stride) {
+    binding.binding = 0;
+    binding.stride = stride;
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    attributes[0] = {0, 0, VK_FORMAT_R32G32B32A32_SINT, 0};    // quadCoords
+    attributes[1] = {1, 0, VK_FORMAT_R8G8B8A8_UNORM, 16};      // rgba
+    for (uint32_t i=0; i<4; i++) {                             // textureCoords
+      attributes[2 + i] = {2 + i, 0, VK_FORMAT_R32G32_SFLOAT, 32 + (i * 8)};
+    }
+    attributes[6] = {6, 0, VK_FORMAT_R32_UINT, 20};            // textureIdx
+
+    info = {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    info.pNext = nullptr;
+    info.flags = 0;
+    info.vertexBindingDescriptionCount = 1;
+    info.pVertexBindingDescriptions = &binding;
+    info.vertexAttributeDescriptionCount = attributes.size();
+    info.pVertexAttributeDescriptions = attributes.data();
+  }
+
+  QuadVertexInput(const QuadVertexInput&) = delete;
+};
+
+// Vertex input of the text pipeline: one GlyphInstance per instance.
+struct GlyphVertexInput {
+  VkVertexInputBindingDescription binding;
+  std::array<VkVertexInputAttributeDescription, 5> attributes;
+  VkPipelineVertexInputStateCreateInfo info;
+
+  explicit GlyphVertexInput(uint32_t stride) {
+    binding.binding = 0;
+    binding.stride = stride;
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    attributes[0] = {0, 0, VK_FORMAT_R32G32_SINT, 0};           // position
+    attributes[1] = {1, 0, VK_FORMAT_R16G16_SINT, 8};           // size
+    attributes[2] = {2, 0, VK_FORMAT_R16G16B16A16_UNORM, 12};   // atlasRect
+    attributes[3] = {3, 0, VK_FORMAT_R8G8B8A8_UNORM, 20};       // rgba
+    attributes[4] = {4, 0, VK_FORMAT_R32_UINT, 24};             // textureIdx
+
+    info = {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    info.pNext = nullptr;
+    info.flags = 0;
+    info.vertexBindingDescriptionCount = 1;
+    info.pVertexBindingDescriptions = &binding;
+    info.vertexAttributeDescriptionCount = attributes.size();
+    info.pVertexAttributeDescriptions = attributes.data();
+  }
+
+  GlyphVertexInput(const GlyphVertexInput&) = delete;
+};
+
+// Instances carry colors as unorm8.
+static void PackRGBA(const float rgba[4], uint8_t packed[4]) {
+  for (int i=0; i<4; i++) {
+    packed[i] = static_cast<uint8_t>(std::clamp(rgba[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+}
+
 // 
 // INITIALIZATION
 //
 
 bool Graphics2D::Init(const char **enabledExtensions, const uint32_t extensionCount) {
-  VkApplicationInfo appInfo{};
-  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-  appInfo.apiVersion =
-      VK_MAKE_API_VERSION(0, 1, 3, 0);
-
   std::unordered_set<std::string> extensionSet(enabledInstanceExtensions.begin(), 
                                                      enabledInstanceExtensions.end());
   for (int i=0; i<extensionCount; i++) {
@@ -69,15 +152,51 @@ bool Graphics2D::Init(const char **enabledExtensions, const uint32_t extensionCo
   std::for_each(extensionSet.begin(), extensionSet.end(), [&](const std::string& s) {
       instanceExtensions.push_back(s.c_str());
   });
+  return CreateInstance(instanceExtensions);
+}
+
+bool Graphics2D::InitOffscreen(uint32_t width, uint32_t height) {
+  if (width == 0 || height == 0) {
+    return false;
+  }
+  if (!CreateInstance({})) {
+    return false;
+  }
+  mOffscreen.enabled = true;
+  mSwapchain.format = VK_FORMAT_B8G8R8A8_SRGB; // As the Render Pass.
+  SetExtent({width, height});
+  return CreateResources();
+}
+
+bool Graphics2D::CreateInstance(const std::vector<const char*>& extensions) {
+  VkApplicationInfo appInfo{};
+  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  appInfo.apiVersion =
+      VK_MAKE_API_VERSION(0, 1, 3, 0);
+
+  // Build machines and servers often lack the validation layers.
+  uint32_t layerCount = 0;
+  VULKAN_CALL_CHECK(vkEnumerateInstanceLayerProperties(&layerCount, nullptr));
+  std::vector<VkLayerProperties> availableLayers(layerCount);
+  VULKAN_CALL_CHECK(vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data()));
+  std::vector<const char*> instanceLayers;
+  for (const char* layer : enabledInstanceLayers) {
+    for (const VkLayerProperties& available : availableLayers) {
+      if (strcmp(layer, available.layerName) == 0) {
+        instanceLayers.push_back(layer);
+        break;
+      }
+    }
+  }
 
   VkInstanceCreateInfo ci{};
   ci.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   ci.pNext = nullptr;
   ci.pApplicationInfo = &appInfo;
-  ci.enabledLayerCount = enabledInstanceLayers.size();
-  ci.ppEnabledLayerNames = enabledInstanceLayers.data();
-  ci.enabledExtensionCount = instanceExtensions.size();
-  ci.ppEnabledExtensionNames = instanceExtensions.data();
+  ci.enabledLayerCount = instanceLayers.size();
+  ci.ppEnabledLayerNames = instanceLayers.data();
+  ci.enabledExtensionCount = extensions.size();
+  ci.ppEnabledExtensionNames = extensions.data();
   if (vkCreateInstance(&ci, nullptr, &mVulkanInstance) != VK_SUCCESS) {
     throw std::runtime_error("Failed Vulkan Call: vkCreateInstance");
   }
@@ -95,15 +214,27 @@ bool Graphics2D::Resize() {
                                             // thus far to be completed.
   DestroySwapchain();
   CreateSwapchain();
-  CreateFramebuffers();
+  CreateBackbuffer();
   return true;
 }
 
+bool Graphics2D::ResizeOffscreen(uint32_t width, uint32_t height) {
+  if (width == 0 || height == 0) {
+    return false;
+  }
+  vkDeviceWaitIdle(mDevice.logicalDevice);
+  DestroyReadbackBuffers();
+  DestroyBackbuffer();
+  SetExtent({width, height});
+  return CreateBackbuffer() && CreateReadbackBuffers();
+}
+
 Graphics2D::~Graphics2D() {
   vkDeviceWaitIdle(mDevice.logicalDevice);
 
   // Destroy Swapchain Resources
   DestroySwapchain();
+  DestroyReadbackBuffers();
 
   for (VkSemaphore sem : mSync.renderCompleteSemaphores) {
     vkDestroySemaphore(mDevice.logicalDevice, sem, nullptr);
@@ -117,7 +248,12 @@ Graphics2D::~Graphics2D() {
     vkDestroyFence(mDevice.logicalDevice, fence, nullptr);
   }
 
+  DestroyRecordingContexts();
+
+  vkDestroyQueryPool(mDevice.logicalDevice, mTimestamps.queryPool, nullptr);
+
   vkDestroyDescriptorPool(mDevice.logicalDevice, mDescriptors.descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(mDevice.logicalDevice, mDescriptors.textureLayout, nullptr);
   
   vkDestroyPipeline(mDevice.logicalDevice, mPipelines[LinePipelineIdx].pipeline, nullptr);
   vkDestroyPipeline(mDevice.logicalDevice, mPipelines[FlatPipelineIdx].pipeline, nullptr);
@@ -135,6 +271,7 @@ Graphics2D::~Graphics2D() {
   vkDestroyDescriptorSetLayout(mDevice.logicalDevice, mPipelines[TextPipelineIdx].descriptorLayouts, nullptr);
 
   vkDestroyRenderPass(mDevice.logicalDevice, mRendering.renderPass, nullptr);
+  vkDestroyRenderPass(mDevice.logicalDevice, mRendering.loadRenderPass, nullptr);
   
   vkDestroyCommandPool(mDevice.logicalDevice, mCommand.commandPool, nullptr);
   
@@ -143,22 +280,19 @@ Graphics2D::~Graphics2D() {
   mText.Destroy();
 
   vkDestroyDevice(mDevice.logicalDevice, nullptr);
-  vkDestroySurfaceKHR(mVulkanInstance, mSurface.surface, nullptr);
+  if (mSurface.surface != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(mVulkanInstance, mSurface.surface, nullptr);
+  }
   vkDestroyInstance(mVulkanInstance, nullptr); 
 }
 
 void Graphics2D::DestroySwapchain() {
-  for (VkFramebuffer fb : mSwapchain.framebuffers) {
-    vkDestroyFramebuffer(mDevice.logicalDevice, fb, nullptr);
-  }
-  mSwapchain.framebuffers.clear();
-
-  for (VkImageView iv : mSwapchain.imageViews) {
-    vkDestroyImageView(mDevice.logicalDevice, iv, nullptr);
-  }
-  mSwapchain.imageViews.clear(); 
+  DestroyBackbuffer();
   
-  vkDestroySwapchainKHR(mDevice.logicalDevice, mSwapchain.swapchain, nullptr);
+  if (mSwapchain.swapchain != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(mDevice.logicalDevice, mSwapchain.swapchain, nullptr);
+    mSwapchain.swapchain = VK_NULL_HANDLE;
+  }
   mSwapchain.images.clear();
 }
  
@@ -171,26 +305,35 @@ void Graphics2D::DestroySwapchain() {
 // 3. Present
 
 void Graphics2D::BeginRecording() {
+  PROFILE_ZONE("BeginRecording");
   // Block until command buffer has finished executing.
-  vkWaitForFences(mDevice.logicalDevice, 1, &mSync.commandBufferFences[GetCommandBufferIdx()],
-                  VK_TRUE, UINT64_MAX);
+  {
+    PROFILE_ZONE("Wait for Fence");
+    vkWaitForFences(mDevice.logicalDevice, 1, &mSync.commandBufferFences[GetCommandBufferIdx()],
+                    VK_TRUE, UINT64_MAX);
+  }
+  ReadTimestamps();
   vkResetFences(mDevice.logicalDevice, 1, &mSync.commandBufferFences[GetCommandBufferIdx()]);
   
-  uint32_t swapIdx;
-  VkResult result = vkAcquireNextImageKHR(mDevice.logicalDevice,
-                                          mSwapchain.swapchain, UINT64_MAX,
-                                          mSync.imageAvailableSemaphores[GetCommandBufferIdx()],
-                                          VK_NULL_HANDLE, &swapIdx);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    Resize();
-    return;
-  }
+  // Offscreen, frames are drawn into the Backbuffer only.
+  if (!mOffscreen.enabled) {
+    PROFILE_ZONE("Acquire");
+    uint32_t swapIdx;
+    VkResult result = vkAcquireNextImageKHR(mDevice.logicalDevice,
+                                            mSwapchain.swapchain, UINT64_MAX,
+                                            mSync.imageAvailableSemaphores[GetCommandBufferIdx()],
+                                            VK_NULL_HANDLE, &swapIdx);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      Resize();
+      return;
+    }
 
-  if ((result != VK_SUCCESS) && (result != VK_SUBOPTIMAL_KHR)) {
-    throw std::runtime_error("Failed to acquire image");
-  }
+    if ((result != VK_SUCCESS) && (result != VK_SUBOPTIMAL_KHR)) {
+      throw std::runtime_error("Failed to acquire image");
+    }
 
-  SetCurrentSwapchainIdx(swapIdx);
+    SetCurrentSwapchainIdx(swapIdx);
+  }
 
   vkResetCommandBuffer(mCommand.commandBuffers[GetCommandBufferIdx()], 0);
   VkCommandBufferBeginInfo beginInfo{};
@@ -198,35 +341,33 @@ void Graphics2D::BeginRecording() {
   beginInfo.pNext = nullptr;
   beginInfo.flags = 0;
   vkBeginCommandBuffer(mCommand.commandBuffers[GetCommandBufferIdx()], &beginInfo);
-
-  // Start RenderPass too.
-  VkRenderPassBeginInfo beginRP{};
-  beginRP.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  beginRP.pNext = nullptr;
-  beginRP.renderPass = mRendering.renderPass;
-  beginRP.framebuffer = mSwapchain.framebuffers[GetCurrentSwapchainIdx()];
-  beginRP.renderArea.offset = {0, 0};
-  beginRP.renderArea.extent = mSwapchain.extent;
-
-  VkClearValue clearColor = {{{0.f, 0.f, 0.f, 1.f}}};
-  beginRP.clearValueCount = 1;
-  beginRP.pClearValues = &clearColor;
-  vkCmdBeginRenderPass(mCommand.commandBuffers[GetCommandBufferIdx()], &beginRP,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  if (mTimestamps.queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(mCommand.commandBuffers[GetCommandBufferIdx()], mTimestamps.queryPool,
+                        GetCommandBufferIdx() * kQueriesPerFrame, kQueriesPerFrame);
+    mTimestamps.batchCount[GetCommandBufferIdx()].store(0, std::memory_order_relaxed);
+  }
+  // The RenderPass is begun in EndRecording(), once it is known whether
+  // its contents are recorded inline or in Secondary Command Buffers.
   
-  mFontDescriptorsUpdated.clear();
-  mImageDescriptorsUpdated.clear();
+  mDisplayList.Clear();
+  mDamageIsSet = false;
 }
 
 void Graphics2D::EndRecording() {
-  // End Render Pass and Command Buffer Recording
-  vkCmdEndRenderPass(mCommand.commandBuffers[GetCommandBufferIdx()]); 
+  PROFILE_ZONE("EndRecording");
+  // Records the Render Pass.
+  RecordDisplayList();
+  if (mOffscreen.enabled) {
+    RecordReadback();
+  } else {
+    RecordBackbufferCopy();
+  }
   vkEndCommandBuffer(mCommand.commandBuffers[GetCommandBufferIdx()]);
 }
 
 void Graphics2D::Present() {
-  VkPipelineStageFlags waitStages =
-      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  // The Swapchain Image is first written by the Backbuffer copy.
+  VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
 
   VkSubmitInfo subInfo{};
   subInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -238,7 +379,24 @@ void Graphics2D::Present() {
   subInfo.pCommandBuffers = &mCommand.commandBuffers[GetCommandBufferIdx()];
   subInfo.signalSemaphoreCount = 1;
   subInfo.pSignalSemaphores = &mSync.renderCompleteSemaphores[GetCommandBufferIdx()];
-  vkQueueSubmit(mDevice.queue, 1, &subInfo, mSync.commandBufferFences[GetCommandBufferIdx()]);
+  if (mOffscreen.enabled) {
+    // Nothing to wait for or to signal, ReadPixels() waits on the fence.
+    subInfo.waitSemaphoreCount = 0;
+    subInfo.signalSemaphoreCount = 0;
+  }
+  mTimestamps.isSubmitted[GetCommandBufferIdx()] = true;
+  mTimestamps.submitTime[GetCommandBufferIdx()] = Profiler::Now();
+  mTimestamps.frame[GetCommandBufferIdx()] = mTimestamps.submittedFrames++;
+  {
+    PROFILE_ZONE("Queue Submit");
+    vkQueueSubmit(mDevice.queue, 1, &subInfo, mSync.commandBufferFences[GetCommandBufferIdx()]);
+  }
+
+  if (mOffscreen.enabled) {
+    mOffscreen.presentedIdx = GetCommandBufferIdx();
+    SetCurrentCommandBufferIdx((GetCommandBufferIdx() + 1) % kFRAMES_IN_FLIGHT);
+    return;
+  }
 
   // Present!
   const uint32_t swapIdx = GetCurrentSwapchainIdx();
@@ -251,7 +409,11 @@ void Graphics2D::Present() {
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = &mSwapchain.swapchain;
   presentInfo.pImageIndices = &swapIdx;
-  VkResult res = vkQueuePresentKHR(mDevice.queue, &presentInfo);
+  VkResult res;
+  {
+    PROFILE_ZONE("Present");
+    res = vkQueuePresentKHR(mDevice.queue, &presentInfo);
+  }
 
   if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
     Resize();
@@ -261,7 +423,7 @@ void Graphics2D::Present() {
   }
   
   uint32_t nextCommandBufferIdx = (GetCommandBufferIdx() + 1) % kFRAMES_IN_FLIGHT;
-  SetCurrentSwapchainIdx(nextCommandBufferIdx);
+  SetCurrentCommandBufferIdx(nextCommandBufferIdx);
 }
 
 // 
@@ -269,258 +431,611 @@ void Graphics2D::Present() {
 //
 
 void Graphics2D::DrawRect(int32_t l, int32_t t, int32_t r, int32_t b) {
-  // Bind the Flat-Colored Pipeline. 
-  vkCmdBindPipeline(mCommand.commandBuffers[GetCommandBufferIdx()], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines[FlatPipelineIdx].pipeline);
-  
-  // Set Viewport Transform
-  vkCmdSetViewport(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultViewport); 
-  
-  // Set Scissor
-  if (mScissorIsSet) {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mSetScissor);
-  } else {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultScissor);
+  mRecordingList->AddRect({l, t, r, b}, mRGB.data());
+}
+
+void Graphics2D::DrawOutline(int32_t l, int32_t t, int32_t r, int32_t b) {
+  const float lineWidth = mLineWidthIsSet ? mCurrentLineWidth : mDefaultLineWidth;
+  mRecordingList->AddOutline({l, t, r, b}, mRGB.data(), lineWidth);
+}
+
+void Graphics2D::DrawTexturedRect(ImageId_t imgId, int32_t l, int32_t t, 
+                                  int32_t r, int32_t b) {
+  DrawTexturedRect(imgId, l, t, r, b, 
+                   {{0.0f, 0.0f}, {1.f, 0.0f}, {1.f, 1.f}, {0.0f, 1.f}});
+}
+
+void Graphics2D::DrawTexturedRect(ImageId_t imageId, int32_t l, int32_t t, 
+                                  int32_t r, int32_t b, const std::vector<vec2>& textureCoords) {
+  if (textureCoords.size() < 4) return;
+
+  float coords[8] = {
+      textureCoords[0].x, textureCoords[0].y, textureCoords[1].x, textureCoords[1].y,
+      textureCoords[2].x, textureCoords[2].y, textureCoords[3].x, textureCoords[3].y};
+
+  // Atlased images are drawn from their page, with coordinates 
+  // mapped into their rect of it.
+  ImageId_t textureId = imageId;
+  auto atlased = mAtlasedImages.find(imageId);
+  if (atlased != mAtlasedImages.end()) {
+    const float* uvRect = atlased->second.uvRect;
+    for (int i=0; i<4; i++) {
+      float& u = coords[2 * i];
+      float& v = coords[2 * i + 1];
+      u = uvRect[0] + std::clamp(u, 0.f, 1.f) * (uvRect[2] - uvRect[0]);
+      v = uvRect[1] + std::clamp(v, 0.f, 1.f) * (uvRect[3] - uvRect[1]);
+    }
+    textureId = atlased->second.pageId;
+  } else if (!GetImage(imageId)) {
+    return;
   }
+  mRecordingList->AddTexturedRect(textureId, {l, t, r, b}, mRGB.data(), coords);
+}
 
-  PushConstantQuadInfo quadInfo{
-      {l, t, r, b},
-      {mSwapchain.extent.width,
-       mSwapchain.extent.height}, // Framebuffer Size.
-      {mRGB[0], mRGB[1], mRGB[2], mRGB[3]}};
-  
-  vkCmdPushConstants(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                     mPipelines[FlatPipelineIdx].layout,
-                     VK_SHADER_STAGE_VERTEX_BIT, 
-                     0, sizeof(quadInfo),
-                     &quadInfo);
-  vkCmdDraw(mCommand.commandBuffers[GetCommandBufferIdx()], 6, 1, 0, 0);
+void Graphics2D::DrawText(FontId_t fontId, const std::string& str, 
+                          int32_t baselineX, int32_t baselineY) {
+  const FontInfo* fontInfo = mText.GetFontInfo(fontId);
+  if (!fontInfo || str.empty()) return;
+
+  // Bounds of the whole run, so it can be reordered and culled.
+  const GlyphTable& glyphs = fontInfo->glyphTable;
+  ClipRect bounds{baselineX, baselineY, baselineX, baselineY};
+  int32_t l = baselineX;
+  for (char c : str) {
+    if (static_cast<unsigned char>(c) >= glyphs.size() || !glyphs[c].present) {
+      continue;
+    }
+    const GlyphQuad& glyph = glyphs[c];
+    const int32_t top = baselineY - glyph.baselineYOffset;
+    bounds = bounds.Union({l, top, l + glyph.width, top + glyph.height});
+    l += glyph.horizontalAdvance;
+  }
+  mRecordingList->AddText(fontId, str.data(), str.size(), baselineX, baselineY,
+                       bounds, mRGB.data());
 }
 
-void Graphics2D::DrawOutline(int32_t l, int32_t t, int32_t r, int32_t b) {
-  // Bind the Line Pipeline
-  vkCmdBindPipeline(mCommand.commandBuffers[GetCommandBufferIdx()], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines[LinePipelineIdx].pipeline);
-  
-  // Set Viewport Transform
-  vkCmdSetViewport(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultViewport); 
-  
-  // Set Scissor
-  if (mScissorIsSet) {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mSetScissor);
-  } else {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultScissor);
+//
+// BATCHING
+//
+
+void Graphics2D::RecordDisplayList() {
+  ClipRect root{
+      mDefaultScissor.offset.x, mDefaultScissor.offset.y,
+      static_cast<int32_t>(mDefaultScissor.offset.x + mDefaultScissor.extent.width),
+      static_cast<int32_t>(mDefaultScissor.offset.y + mDefaultScissor.extent.height)};
+  // Ops outside the damage are culled, the rest clipped to it.
+  const bool isPartial = mBackbuffer.isValid && mDamageIsSet;
+  if (isPartial) {
+    root = root.Intersect(mDamage);
+    if (root.IsEmpty()) return; // Nothing changed, the Backbuffer is the frame.
+  }
+  mBackbuffer.isValid = true;
+
+  {
+    PROFILE_ZONE("Order");
+    mDisplayList.Order(root, mOrderedOps);
   }
 
-  // Set Line Width
-  if (mLineWidthIsSet) {
-    vkCmdSetLineWidth(mCommand.commandBuffers[GetCommandBufferIdx()], mDefaultLineWidth); 
+  // Split the ordered ops into contiguous chunks, recorded in parallel.
+  // Batches only span a chunk boundary at the cost of one more draw.
+  WorkerPool& workers = WorkerPool::GetShared();
+  size_t chunkCount = GetRecordingChunkCount(mOrderedOps.size(), 
+                                             workers.GetWorkerCount() + 1);
+  if (!CreateRecordingContexts(chunkCount)) {
+    chunkCount = 1;
+  }
+
+  VkCommandBuffer primary = mCommand.commandBuffers[GetCommandBufferIdx()];
+  CmdWriteTimestamp(primary, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+  if (chunkCount == 1) {
+    // Not worth the fan-out, record right into the primary Command Buffer.
+    BeginRenderPass(VK_SUBPASS_CONTENTS_INLINE, root);
+    RecordingContext& context = *mRecordingContexts[0];
+    context.commandBuffer = primary;
+    RecordChunk(context, 0, mOrderedOps.size());
   } else {
-    vkCmdSetLineWidth(mCommand.commandBuffers[GetCommandBufferIdx()], mCurrentLineWidth); 
+    BeginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, root);
+    std::vector<std::exception_ptr> errors(chunkCount);
+    workers.Dispatch(chunkCount, [&](size_t chunk) {
+      try {
+        RecordingContext& context = *mRecordingContexts[chunk];
+        context.commandBuffer = context.secondaryCommandBuffers[GetCommandBufferIdx()];
+        BeginSecondaryCommandBuffer(context.commandBuffer);
+        RecordChunk(context, 
+                    GetRecordingChunkBegin(mOrderedOps.size(), chunk, chunkCount),
+                    GetRecordingChunkBegin(mOrderedOps.size(), chunk + 1, chunkCount));
+        vkEndCommandBuffer(context.commandBuffer);
+      } catch (...) {
+        errors[chunk] = std::current_exception();
+      }
+    });
+    workers.Wait();
+    for (const std::exception_ptr& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+
+    // Executed in chunk order, so in draw order.
+    std::vector<VkCommandBuffer> secondaries(chunkCount);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+      secondaries[chunk] = mRecordingContexts[chunk]->commandBuffer;
+    }
+    vkCmdExecuteCommands(primary, secondaries.size(), secondaries.data());
+  }
+  vkCmdEndRenderPass(primary);
+  CmdWriteTimestamp(primary, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
+
+  for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+    CommandStats& stats = mRecordingContexts[chunk]->state.stats;
+    mCommandStats.issued += stats.issued;
+    mCommandStats.elided += stats.elided;
+    stats = {};
   }
+}
 
-  PushConstantQuadInfo quadInfo{
-      {l, t, r, b},
-      {mSwapchain.extent.width,
-       mSwapchain.extent.height}, // Framebuffer Size.
-      {mRGB[0], mRGB[1], mRGB[2], mRGB[3]}};
-  
-  vkCmdPushConstants(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                     mPipelines[LinePipelineIdx].layout,
-                     VK_SHADER_STAGE_VERTEX_BIT, 
-                     0, sizeof(quadInfo),
-                     &quadInfo);
-  vkCmdDraw(mCommand.commandBuffers[GetCommandBufferIdx()], 5, 1, 0, 0);
+void Graphics2D::RecordChunk(RecordingContext& context, size_t first, size_t last) {
+  PROFILE_ZONE("Record Chunk");
+  // The GPU is done with this frame's instances. (See BeginRecording())
+  context.instanceBuffers[GetCommandBufferIdx()].size = 0;
+  context.batcher.Clear();
+  context.state.Reset();
+
+  const std::vector<DrawOp>& ops = mDisplayList.GetOps();
+  for (size_t i = first; i < last; i++) {
+    const DisplayList::Item& item = mOrderedOps[i];
+    VkRect2D scissor;
+    scissor.offset = {item.scissor.left, item.scissor.top};
+    scissor.extent = {static_cast<uint32_t>(item.scissor.right - item.scissor.left),
+                      static_cast<uint32_t>(item.scissor.bottom - item.scissor.top)};
+    RecordOp(context, ops[item.opIdx], scissor);
+  }
+  RecordBatches(context);
 }
 
-void Graphics2D::DrawTexturedRect(ImageId_t imgId, int32_t l, int32_t t, 
-                                  int32_t r, int32_t b) {
-  const Image* image = GetImage(imgId);
-  std::array<VkDescriptorSet, 2> imageDescriptors = GetImageDescriptors(imgId);
-  if (!image || imageDescriptors[0] == VK_NULL_HANDLE) {
-    return;
+void Graphics2D::BeginRenderPass(VkSubpassContents contents, const ClipRect& renderArea) {
+  VkRenderPassBeginInfo beginRP{};
+  beginRP.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  beginRP.pNext = nullptr;
+  // Clear whatever the Backbuffer held before its first frame, keep
+  // the pixels outside 'renderArea' afterwards.
+  const bool isFullFrame = renderArea.left == 0 && renderArea.top == 0 &&
+                           renderArea.right == static_cast<int32_t>(mSwapchain.extent.width) &&
+                           renderArea.bottom == static_cast<int32_t>(mSwapchain.extent.height);
+  beginRP.renderPass = isFullFrame ? mRendering.renderPass : mRendering.loadRenderPass;
+  beginRP.framebuffer = mBackbuffer.framebuffer;
+  beginRP.renderArea.offset = {renderArea.left, renderArea.top};
+  beginRP.renderArea.extent = {static_cast<uint32_t>(renderArea.right - renderArea.left),
+                               static_cast<uint32_t>(renderArea.bottom - renderArea.top)};
+
+  VkClearValue clearColor = {{{0.f, 0.f, 0.f, 1.f}}};
+  beginRP.clearValueCount = 1;
+  beginRP.pClearValues = &clearColor;
+  vkCmdBeginRenderPass(mCommand.commandBuffers[GetCommandBufferIdx()], &beginRP,
+                       contents);
+}
+
+void Graphics2D::BeginSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.pNext = nullptr;
+  inheritanceInfo.renderPass = mRendering.renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = mBackbuffer.framebuffer;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.pNext = nullptr;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  // Implicitly resets it. (See CreateRecordingContexts())
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+}
+
+void Graphics2D::RecordBackbufferCopy() {
+  VkCommandBuffer commandBuffer = mCommand.commandBuffers[GetCommandBufferIdx()];
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = mSwapchain.images[GetCurrentSwapchainIdx()];
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  // Previous contents are overwritten whole.
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                       1, &barrier);
+
+  // The Render Pass left the Backbuffer in TRANSFER_SRC_OPTIMAL.
+  VkImageCopy region{};
+  region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.srcOffset = {0, 0, 0};
+  region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.dstOffset = {0, 0, 0};
+  region.extent = {mSwapchain.extent.width, mSwapchain.extent.height, 1};
+  vkCmdCopyImage(commandBuffer, 
+                 mBackbuffer.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 mSwapchain.images[GetCurrentSwapchainIdx()], 
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                       1, &barrier);
+}
+
+void Graphics2D::RecordReadback() {
+  VkCommandBuffer commandBuffer = mCommand.commandBuffers[GetCommandBufferIdx()];
+  const ReadbackBuffer& readback = mOffscreen.readbackBuffers[GetCommandBufferIdx()];
+
+  // The Render Pass left the Backbuffer in TRANSFER_SRC_OPTIMAL.
+  // Rows are tightly packed.
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {mSwapchain.extent.width, mSwapchain.extent.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, 
+                         mBackbuffer.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readback.buffer, 1, &region);
+
+  // Visible to the host once the fence is signaled.
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = readback.buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier,
+                       0, nullptr);
+}
+
+bool Graphics2D::ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) {
+  if (!mOffscreen.enabled || mOffscreen.presentedIdx < 0) {
+    return false;
+  }
+  VULKAN_CALL_CHECK(vkWaitForFences(mDevice.logicalDevice, 1, 
+                                    &mSync.commandBufferFences[mOffscreen.presentedIdx],
+                                    VK_TRUE, UINT64_MAX));
+
+  width = mSwapchain.extent.width;
+  height = mSwapchain.extent.height;
+  const size_t pixelCount = static_cast<size_t>(width) * height;
+  rgba.resize(pixelCount * 4);
+
+  // The Backbuffer is BGRA.
+  const uint8_t* bgra = mOffscreen.readbackBuffers[mOffscreen.presentedIdx].mapped;
+  for (size_t i = 0; i < pixelCount; i++) {
+    rgba[i * 4 + 0] = bgra[i * 4 + 2];
+    rgba[i * 4 + 1] = bgra[i * 4 + 1];
+    rgba[i * 4 + 2] = bgra[i * 4 + 0];
+    rgba[i * 4 + 3] = bgra[i * 4 + 3];
   }
+  return true;
+}
 
-  // Bind the Textured-Quad Pipeline. 
-  vkCmdBindPipeline(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                    VK_PIPELINE_BIND_POINT_GRAPHICS, 
-                    mPipelines[TexturedPipelineIdx].pipeline);
-  
-  // Set Viewport Transform
-  vkCmdSetViewport(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultViewport); 
-  
-  // Set Scissor
-  if (mScissorIsSet) {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mSetScissor);
-  } else {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultScissor);
+void Graphics2D::RecordOp(RecordingContext& context, const DrawOp& op, 
+                          const VkRect2D& scissor) {
+  switch (op.type) {
+    case DrawOpType::Rect: {
+      QuadInstance quad{
+          {op.bounds.left, op.bounds.top, op.bounds.right, op.bounds.bottom}};
+      PackRGBA(op.rgba, quad.rgba);
+      AddQuad(context, FlatPipelineIdx, VK_NULL_HANDLE, scissor, op.lineWidth, quad);
+      break;
+    }
+    case DrawOpType::Outline: {
+      ClipRect rect; // Unpadded. (See DisplayList::AddOutline)
+      memcpy(&rect, op.payload, sizeof(ClipRect));
+      QuadInstance quad{{rect.left, rect.top, rect.right, rect.bottom}};
+      PackRGBA(op.rgba, quad.rgba);
+      AddQuad(context, LinePipelineIdx, VK_NULL_HANDLE, scissor, op.lineWidth, quad);
+      break;
+    }
+    case DrawOpType::TexturedRect: {
+      auto texture = mImageTextureIdx.find(op.resourceId);
+      if (texture == mImageTextureIdx.end()) return;
+
+      QuadInstance quad{
+          {op.bounds.left, op.bounds.top, op.bounds.right, op.bounds.bottom}};
+      PackRGBA(op.rgba, quad.rgba);
+      quad.textureIdx = texture->second;
+      memcpy(quad.textureCoords, op.payload, sizeof(quad.textureCoords));
+      AddQuad(context, TexturedPipelineIdx, mDescriptors.textureSet, 
+              scissor, op.lineWidth, quad);
+      break;
+    }
+    case DrawOpType::Text: {
+      const FontId_t fontId = op.resourceId;
+      auto texture = mFontTextureIdx.find(fontId);
+      if (texture == mFontTextureIdx.end()) return;
+
+      const char* str = static_cast<const char*>(op.payload);
+      const GlyphTable& glyphs = mText.GetFontInfo(fontId)->glyphTable;
+      uint32_t glyphCount = 0;
+      for (uint32_t i=0; i<op.payloadSize; i++) {
+        const unsigned char c = str[i];
+        if (c < glyphs.size() && glyphs[c].present) {
+          glyphCount++;
+        }
+      }
+      if (glyphCount == 0) return;
+
+      // The whole string is one run of instances.
+      GlyphInstance* instance = reinterpret_cast<GlyphInstance*>(
+          AddInstance(context, TextPipelineIdx, mDescriptors.textureSet,
+                      scissor, op.lineWidth, sizeof(GlyphInstance), glyphCount));
+      uint8_t rgba[4];
+      PackRGBA(op.rgba, rgba);
+
+      int32_t l = op.baselineX;
+      for (uint32_t i=0; i<op.payloadSize; i++) {
+        const unsigned char c = str[i];
+        if (c >= glyphs.size() || !glyphs[c].present) {
+          continue;
+        }
+        const GlyphQuad& glyph = glyphs[c];
+        GlyphInstance data;
+        data.position[0] = l;
+        data.position[1] = op.baselineY - glyph.baselineYOffset;
+        data.size[0] = glyph.width;
+        data.size[1] = glyph.height;
+        memcpy(data.atlasRect, glyph.atlasRect, sizeof(data.atlasRect));
+        memcpy(data.rgba, rgba, sizeof(data.rgba));
+        data.textureIdx = texture->second;
+        memcpy(instance++, &data, sizeof(GlyphInstance)); // Write-combined memory
+        l += glyph.horizontalAdvance; // Increase l by horizontal advance glyph metric.
+      }
+      break;
+    }
+    default:
+      break; // Scissors are resolved by DisplayList::Order()
   }
-  
+}
 
-  if (mImageDescriptorsUpdated.find(imgId) == mImageDescriptorsUpdated.end()) {  
-    // Update Descriptor Set with Image
-    UpdateDescriptorSet(imageDescriptors[GetCommandBufferIdx()],
-                        image->GetSampler(), 
-                        image->GetImageView(), 
-                        image->GetImageLayout());
-    mImageDescriptorsUpdated.insert(imgId);
-  }
-
-  vkCmdBindDescriptorSets(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          mPipelines[TexturedPipelineIdx].layout, 
-                          0, 1, &imageDescriptors[GetCommandBufferIdx()], 
-                          0, nullptr);
-
-  PushConstantQuadInfo quadInfo{
-      {l, t, r, b},
-      {mSwapchain.extent.width,
-       mSwapchain.extent.height}, // Framebuffer Size.
-      {mRGB[0], mRGB[1], mRGB[2], mRGB[3]},
-      {{0.0f, 0.0f}, {1.f, 0.0f}, {1.f, 1.f}, {0.0f, 1.f}}};
-  
-  vkCmdPushConstants(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                     mPipelines[TexturedPipelineIdx].layout,
-                     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(quadInfo),
-                     &quadInfo);
-  vkCmdDraw(mCommand.commandBuffers[GetCommandBufferIdx()], 6, 1, 0, 0);
+uint8_t* Graphics2D::AddInstance(RecordingContext& context, 
+                                 size_t pipelineIdx, VkDescriptorSet descriptorSet,
+                                 const VkRect2D& scissor, float lineWidth,
+                                 VkDeviceSize instanceSize, uint32_t count) {
+  InstanceBuffer& instances = context.instanceBuffers[GetCommandBufferIdx()];
+  const VkDeviceSize offset = 
+      context.batcher.Add(pipelineIdx, descriptorSet, scissor, lineWidth, 
+                          mPipelines[pipelineIdx].dynamicLineWidth, instanceSize, count);
+  if (context.batcher.GetSize() > instances.capacity) {
+    // Nothing has been recorded from this buffer yet, (See RecordBatches())
+    // so it can be swapped for a larger one mid-frame.
+    if (!ResizeInstanceBuffer(instances, std::max(instances.capacity * 2, 
+                                                  context.batcher.GetSize()))) {
+      throw std::runtime_error("Failed to grow instance buffer");
+    }
+  }
+  instances.size = context.batcher.GetSize();
+  return instances.mapped + offset;
 }
 
-void Graphics2D::DrawTexturedRect(ImageId_t imageId, int32_t l, int32_t t, 
-                                  int32_t r, int32_t b, const std::vector<vec2>& textureCoords) {
-  const Image* image = GetImage(imageId);
-  std::array<VkDescriptorSet, 2> imageDescriptors = GetImageDescriptors(imageId);
-  if (!image || imageDescriptors[0] == VK_NULL_HANDLE) return;
-  if (textureCoords.size() < 4) return;
-  
-  // Bind the Textured-Colored Pipeline. 
-  vkCmdBindPipeline(mCommand.commandBuffers[GetCommandBufferIdx()], VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines[TexturedPipelineIdx].pipeline);
+void Graphics2D::AddQuad(RecordingContext& context, 
+                         size_t pipelineIdx, VkDescriptorSet descriptorSet,
+                         const VkRect2D& scissor, float lineWidth,
+                         const QuadInstance& quad) {
+  uint8_t* data = AddInstance(context, pipelineIdx, descriptorSet, scissor, lineWidth,
+                              sizeof(QuadInstance));
+  memcpy(data, &quad, sizeof(QuadInstance));
+}
+
+void Graphics2D::RecordBatches(RecordingContext& context) {
+  VkCommandBuffer commandBuffer = context.commandBuffer;
+  const InstanceBuffer& instances = context.instanceBuffers[GetCommandBufferIdx()];
 
   // Set Viewport Transform
-  vkCmdSetViewport(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultViewport); 
-  
-  // Set Scissor
-  if (mScissorIsSet) {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mSetScissor);
-  } else {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultScissor);
+  CmdSetViewport(context, mDefaultViewport);
+  const std::vector<DrawBatch>& batches = context.batcher.GetBatches();
+  if (!batches.empty()) {
+    CmdBindVertexBuffer(context, instances.buffer);
   }
 
-  if (mImageDescriptorsUpdated.find(imageId) == mImageDescriptorsUpdated.end()) {  
-    UpdateDescriptorSet(imageDescriptors[GetCommandBufferIdx()],
-                        image->GetSampler(), 
-                        image->GetImageView(), 
-                        image->GetImageLayout());
-    mImageDescriptorsUpdated.insert(imageId);
+  std::atomic<uint32_t>& batchCount = mTimestamps.batchCount[GetCommandBufferIdx()];
+  for (const DrawBatch& batch : batches) {
+    // Chunks take query pairs as they come, each batch notes its pipeline.
+    uint32_t timedBatchIdx = kMaxTimedBatches;
+    if (mTimestamps.queryPool != VK_NULL_HANDLE) {
+      timedBatchIdx = batchCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (timedBatchIdx < kMaxTimedBatches) {
+      mTimestamps.batchPipelines[GetCommandBufferIdx()][timedBatchIdx] = batch.pipelineIdx;
+      CmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 2 + 2 * timedBatchIdx);
+    }
+
+    CmdBindPipeline(context, batch.pipelineIdx);
+    CmdSetScissor(context, batch.scissor);
+    if (mPipelines[batch.pipelineIdx].dynamicLineWidth) {
+      CmdSetLineWidth(context, batch.lineWidth);
+    }
+    if (batch.descriptorSet != VK_NULL_HANDLE) {
+      CmdBindDescriptorSet(context, batch.pipelineIdx, batch.descriptorSet);
+    }
+    CmdPushFrameInfo(context, batch.pipelineIdx);
+    vkCmdDraw(commandBuffer, mPipelines[batch.pipelineIdx].vertexCount, 
+              batch.instanceCount, 0, batch.firstInstance);
+
+    if (timedBatchIdx < kMaxTimedBatches) {
+      CmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 3 + 2 * timedBatchIdx);
+    }
   }
+  context.batcher.Clear();
+}
 
- vkCmdBindDescriptorSets(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          mPipelines[TexturedPipelineIdx].layout, 0/*First Set*/, 
-                          1 /*NumDescriptorSets*/, 
-                          &imageDescriptors[GetCommandBufferIdx()], 
-                          0, nullptr);
+//
+// GPU TIMESTAMPS
+//
 
-  PushConstantQuadInfo quadInfo{
-      {l, t, r, b},
-      {mSwapchain.extent.width,
-       mSwapchain.extent.height}, // Framebuffer Size.
-      {mRGB[0], mRGB[1], mRGB[2], mRGB[3]},
-      {textureCoords[0], textureCoords[1], textureCoords[2], textureCoords[3]}};
-  vkCmdPushConstants(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                     mPipelines[TexturedPipelineIdx].layout,
-                     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(quadInfo),
-                     &quadInfo);
-  vkCmdDraw(mCommand.commandBuffers[GetCommandBufferIdx()], 6, 1, 0, 0);
+void Graphics2D::CmdWriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage,
+                                   uint32_t query) {
+  if (mTimestamps.queryPool == VK_NULL_HANDLE) return;
+  vkCmdWriteTimestamp(commandBuffer, stage, mTimestamps.queryPool,
+                      GetCommandBufferIdx() * kQueriesPerFrame + query);
 }
 
-void Graphics2D::DrawText(FontId_t fontId, const std::string& str, 
-                          int32_t baselineX, int32_t baselineY) {
-  std::array<VkDescriptorSet, 2> fontDescriptors = GetFontDescriptors(fontId);
-  // Bind the Text Pipeline. 
-  vkCmdBindPipeline(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                    VK_PIPELINE_BIND_POINT_GRAPHICS, 
-                    mPipelines[TextPipelineIdx].pipeline);
+void Graphics2D::ReadTimestamps() {
+  const uint32_t idx = GetCommandBufferIdx();
+  if (mTimestamps.queryPool == VK_NULL_HANDLE || !mTimestamps.isSubmitted[idx]) return;
+  mTimestamps.isSubmitted[idx] = false;
+
+  const uint32_t batchCount = std::min(
+      mTimestamps.batchCount[idx].load(std::memory_order_relaxed), kMaxTimedBatches);
+  const uint32_t queryCount = 2 + 2 * batchCount;
+  // No VK_QUERY_RESULT_WAIT_BIT: the fence was signaled, every query written
+  // is available. The Render Pass ones aren't written if nothing was redrawn.
+  std::vector<uint64_t>& results = mTimestamps.results;
+  results.resize(2 * queryCount);
+  const VkResult res = vkGetQueryPoolResults(
+      mDevice.logicalDevice, mTimestamps.queryPool, idx * kQueriesPerFrame, queryCount,
+      results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  if (res != VK_SUCCESS && res != VK_NOT_READY) return;
+
+  // In ns, false if 'query' wasn't written.
+  auto getTime = [&](uint32_t query, uint64_t& time) {
+    if (results[2 * query + 1] == 0) return false;
+    time = static_cast<uint64_t>((results[2 * query] & mTimestamps.validMask) *
+                                 mTimestamps.nsPerTick);
+    return true;
+  };
+  auto toMs = [](uint64_t begin, uint64_t end) {
+    return end > begin ? (end - begin) / 1e6 : 0.0;
+  };
 
-  // Set Viewport Transform
-  vkCmdSetViewport(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultViewport); 
-  
-  // Set Scissor
-  if (mScissorIsSet) {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mSetScissor);
-  } else {
-    vkCmdSetScissor(mCommand.commandBuffers[GetCommandBufferIdx()], 0, 1, &mDefaultScissor);
+  GpuFrameStats stats;
+  stats.frame = mTimestamps.frame[idx];
+  uint64_t frameBegin, frameEnd;
+  const bool isDrawn = getTime(0, frameBegin) && getTime(1, frameEnd);
+  if (isDrawn) {
+    stats.renderPassMs = toMs(frameBegin, frameEnd);
   }
-  
-  if (mFontDescriptorsUpdated.find(fontId) == mFontDescriptorsUpdated.end()) {
-    // Write Text Atlas to Descriptor Set
-    UpdateDescriptorSet(fontDescriptors[GetCommandBufferIdx()],
-                      mText.GetFontInfo(fontId)->fontAtlas.GetSampler(), 
-                      mText.GetFontInfo(fontId)->fontAtlas.GetImageView(), 
-                      mText.GetFontInfo(fontId)->fontAtlas.GetImageLayout());
-    mFontDescriptorsUpdated.insert(fontId);
- }
-
-  // Bind Descriptor Set to Text Pipeline
-  vkCmdBindDescriptorSets(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          mPipelines[TextPipelineIdx].layout, 
-                          0, 1, &fontDescriptors[GetCommandBufferIdx()], 
-                          0, nullptr);
-
-  int l = baselineX;
-  const GlyphMap2& glyphData = mText.GetFontInfo(fontId)->glyphMap;
-  int atlasWidth = mText.GetFontInfo(fontId)->atlasWidth;
-  int atlasHeight = mText.GetFontInfo(fontId)->atlasHeight;
-  for (int i=0; i<str.length(); i++) {
-    char c = str[i];
-    PushConstantQuadInfo quadInfo{};
-    quadInfo.frameBufferSize[0] = mSwapchain.extent.width;
-    quadInfo.frameBufferSize[1] = mSwapchain.extent.height;
-    quadInfo.rgb[0] = mRGB[0], quadInfo.rgb[1] = mRGB[1];
-    quadInfo.rgb[2] = mRGB[2], quadInfo.rgb[3] = mRGB[3];
-    GlyphMap2::const_iterator data = glyphData.find(c); 
-    if (data != glyphData.end()) {
-      int width = data->second.width;
-      int height = data->second.height;
-      int x = data->second.startX;
-      int y = data->second.startY;
-      int glyphBaselineOffset = data->second.baselineYOffset;
-      int horizontalAdvance = data->second.horizontalAdvance;
-      
-      quadInfo.QuadCoords[0] = l; // Increases on each iteration.
-      quadInfo.QuadCoords[1] = baselineY - glyphBaselineOffset; // top. Unique per glyph
-      quadInfo.QuadCoords[2] = l + width; // right. Unique per glyph. Not from parameter of method.
-      quadInfo.QuadCoords[3] = quadInfo.QuadCoords[1] + height;
-
-      // Top Left
-      quadInfo.textureCoords[0].x = static_cast<float>(x) / atlasWidth;
-      quadInfo.textureCoords[0].y = static_cast<float>(y) / atlasWidth;
-      // Top Right
-      quadInfo.textureCoords[1].x = static_cast<float>(x + width) / atlasWidth;
-      quadInfo.textureCoords[1].y = static_cast<float>(y) / atlasHeight;
-      // Bottom Right
-      quadInfo.textureCoords[2].x = static_cast<float>(x + width) / atlasWidth;
-      quadInfo.textureCoords[2].y = static_cast<float>(y + height) / atlasHeight;
-      // Bottom Left
-      quadInfo.textureCoords[3].x = static_cast<float>(x) / atlasWidth;
-      quadInfo.textureCoords[3].y = static_cast<float>(y + height) / atlasHeight;
-
-      vkCmdPushConstants(mCommand.commandBuffers[GetCommandBufferIdx()], 
-                         mPipelines[TextPipelineIdx].layout,
-                     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(quadInfo),
-                     &quadInfo);
-      vkCmdDraw(mCommand.commandBuffers[GetCommandBufferIdx()], 6, 1, 0, 0);
-      l += horizontalAdvance; // Increase l by horizontal advance glyph metric.
+  for (uint32_t i = 0; i < batchCount; i++) {
+    uint64_t begin, end;
+    if (getTime(2 + 2 * i, begin) && getTime(3 + 2 * i, end)) {
+      stats.pipelineMs[mTimestamps.batchPipelines[idx][i]] += toMs(begin, end);
+      stats.batchCount++;
     }
-  } 
+  }
+  mTimestamps.stats = stats;
+
+#ifdef ENABLE_PROFILER
+  if (!isDrawn || mTimestamps.track == nullptr) return;
+  // The GPU clock has an epoch of its own. A frame can't begin before it
+  // is submitted, so each bounds the offset to Profiler::Now() from below.
+  // The largest bound is exact for frames the GPU began right away, as it
+  // does when it's idle.
+  const int64_t minOffset = static_cast<int64_t>(mTimestamps.submitTime[idx]) -
+                            static_cast<int64_t>(frameBegin);
+  if (!mTimestamps.hasClockOffset || minOffset > mTimestamps.clockOffset) {
+    mTimestamps.clockOffset = minOffset;
+    mTimestamps.hasClockOffset = true;
+  }
+  auto toProfilerTime = [&](uint64_t time) {
+    return static_cast<uint64_t>(static_cast<int64_t>(time) + mTimestamps.clockOffset);
+  };
+  static const char* const kPipelineNames[] = {"Line Batch", "Flat Batch",
+                                               "Textured Batch", "Text Batch"};
+  Profiler::Record(mTimestamps.track, "GPU Frame", toProfilerTime(frameBegin),
+                   toProfilerTime(frameEnd), static_cast<int64_t>(stats.frame));
+  for (uint32_t i = 0; i < batchCount; i++) {
+    uint64_t begin, end;
+    if (getTime(2 + 2 * i, begin) && getTime(3 + 2 * i, end)) {
+      Profiler::Record(mTimestamps.track, kPipelineNames[mTimestamps.batchPipelines[idx][i]],
+                       toProfilerTime(begin), toProfilerTime(end), i);
+    }
+  }
+#endif
+}
+
+//
+// COMMAND STATE
+//
+
+void Graphics2D::CmdBindPipeline(RecordingContext& context, size_t pipelineIdx) {
+  const Pipeline& pipeline = mPipelines[pipelineIdx];
+  if (context.state.BindPipeline(pipeline.pipeline, pipeline.dynamicLineWidth)) {
+    vkCmdBindPipeline(context.commandBuffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+  }
+}
+
+void Graphics2D::CmdBindDescriptorSet(RecordingContext& context, size_t pipelineIdx, 
+                                      VkDescriptorSet descriptorSet) {
+  if (context.state.BindDescriptorSet(descriptorSet)) {
+    vkCmdBindDescriptorSets(context.commandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            mPipelines[pipelineIdx].layout, 0, 1, &descriptorSet,
+                            0, nullptr);
+  }
+}
+
+void Graphics2D::CmdSetViewport(RecordingContext& context, const VkViewport& viewport) {
+  if (context.state.SetViewport(viewport)) {
+    vkCmdSetViewport(context.commandBuffer, 0, 1, &viewport);
+  }
+}
+
+void Graphics2D::CmdSetScissor(RecordingContext& context, const VkRect2D& scissor) {
+  if (context.state.SetScissor(scissor)) {
+    vkCmdSetScissor(context.commandBuffer, 0, 1, &scissor);
+  }
+}
+
+void Graphics2D::CmdSetLineWidth(RecordingContext& context, float lineWidth) {
+  if (context.state.SetLineWidth(lineWidth)) {
+    vkCmdSetLineWidth(context.commandBuffer, lineWidth);
+  }
 }
 
-void Graphics2D::UpdateDescriptorSet(VkDescriptorSet descriptorSet, VkSampler sampler, 
-                         VkImageView imageView, VkImageLayout imageLayout) {
+void Graphics2D::CmdPushFrameInfo(RecordingContext& context, size_t pipelineIdx) {
+  if (context.state.PushFrameInfo()) {
+    PushConstantFrameInfo frameInfo{
+        {mSwapchain.extent.width,
+         mSwapchain.extent.height}}; // Framebuffer Size.
+    vkCmdPushConstants(context.commandBuffer, 
+                       mPipelines[pipelineIdx].layout, VK_SHADER_STAGE_VERTEX_BIT, 
+                       0, sizeof(frameInfo), &frameInfo);
+  }
+}
+
+void Graphics2D::CmdBindVertexBuffer(RecordingContext& context, VkBuffer buffer) {
+  if (context.state.BindVertexBuffer(buffer)) {
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(context.commandBuffer, 
+                           0, 1, &buffer, &offset);
+  }
+}
+
+uint32_t Graphics2D::AddTexture(VkSampler sampler, VkImageView imageView, 
+                                VkImageLayout imageLayout) {
+  if (mDescriptors.textureCount == kMaxTextures) {
+    throw std::runtime_error("Texture array is full");
+  }
+  const uint32_t textureIdx = mDescriptors.textureCount++;
+
+  // Update-after-bind: frames in flight never index this element yet.
   VkWriteDescriptorSet writeDescriptors{};
   writeDescriptors.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writeDescriptors.dstSet = descriptorSet;
+  writeDescriptors.dstSet = mDescriptors.textureSet;
   writeDescriptors.dstBinding = 0;
-  writeDescriptors.dstArrayElement = 0;
+  writeDescriptors.dstArrayElement = textureIdx;
   writeDescriptors.descriptorCount = 1;
   writeDescriptors.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
@@ -531,6 +1046,7 @@ void Graphics2D::UpdateDescriptorSet(VkDescriptorSet descriptorSet, VkSampler sa
   writeDescriptors.pImageInfo = &desImageSamplerInfo;
 
   vkUpdateDescriptorSets(mDevice.logicalDevice, 1, &writeDescriptors, 0, nullptr);
+  return textureIdx;
 }
 
 //
@@ -553,66 +1069,39 @@ void Graphics2D::UnsetLineWidth() {
   mLineWidthIsSet = false;
 }
 
-static bool Intersects(const Rect& rect1, const Rect& rect2) {
-  // Calculate the right and bottom edges of the rectangles
-  int rect1Right = rect1.offsetX + rect1.sizeX;
-  int rect1Bottom = rect1.offsetY + rect1.sizeY;
-  
-  int rect2Right = rect2.offsetX + rect2.sizeX;
-  int rect2Bottom = rect2.offsetY + rect2.sizeY;
+void Graphics2D::PushScissor(const Rect& scissor) {
+  PushScissor(scissor.offsetX, scissor.offsetY, scissor.sizeX, scissor.sizeY);
+}
+ 
+void Graphics2D::PushScissor(int offsetX, int offsetY, int sizeX, int sizeY) {
+  // Intersected with the enclosing Scissor and the FrameBuffer
+  // by DisplayList::Order()
+  sizeX = std::max(sizeX, 0);
+  sizeY = std::max(sizeY, 0);
+  mRecordingList->PushScissor({offsetX, offsetY, offsetX + sizeX, offsetY + sizeY});
+}
 
-  bool xOverlap = (rect1.offsetX < rect2Right) && (rect1Right > rect2.offsetX);
-  bool yOverlap = (rect1.offsetY < rect2Bottom) && (rect1Bottom > rect2.offsetY);
+void Graphics2D::PopScissor() {
+  mRecordingList->PopScissor();
+}
 
-  // The rectangles overlap if both the X and Y axes overlap
-  return xOverlap && yOverlap;
+void Graphics2D::SetDamage(const ClipRect& damage) {
+  mDamage = damage;
+  mDamageIsSet = true;
 }
 
-void Graphics2D::SetScissor(const Rect& scissor, Rect& originalScissor) {
-  SetScissor(scissor.offsetX, scissor.offsetY, 
-             scissor.sizeX, scissor.sizeY, originalScissor);
+void Graphics2D::BeginDisplayList(DisplayList* list) {
+  assert(mRecordingList == &mDisplayList && "Display Lists don't nest");
+  list->Clear();
+  mRecordingList = list;
 }
- 
-void Graphics2D::SetScissor(int offsetX, int offsetY, 
-                int sizeX, int sizeY, Rect& originalScissor) {
-  offsetX = std::clamp<int>(offsetX, 0, mSwapchain.extent.width);
-  offsetY = std::clamp<int>(offsetY, 0, mSwapchain.extent.height);
-  sizeX = std::clamp<int>(sizeX, 0, mSwapchain.extent.width);
-  sizeY = std::clamp<int>(sizeY, 0, mSwapchain.extent.height);
-
-  if (mScissorIsSet) {
-    Rect rect;
-    rect.offsetX = offsetX, rect.offsetY = offsetY;
-    rect.sizeX = sizeX, rect.sizeY = sizeY;
-
-    Rect setRect;
-    setRect.offsetX = mSetScissor.offset.x, setRect.offsetY = mSetScissor.offset.y;
-    setRect.sizeX = mSetScissor.extent.width, setRect.sizeY = mSetScissor.extent.height;
-
-    if (Intersects(rect, setRect)) {
-      originalScissor = setRect;
-      mSetScissor.offset.x = std::max<int>(rect.offsetX, setRect.offsetX);
-      mSetScissor.offset.y = std::max<int>(rect.offsetY, setRect.offsetY);
-      int right = std::min<int>(rect.offsetX + rect.sizeX, setRect.offsetX + setRect.sizeX);
-      int bottom = std::min<int>(rect.offsetY + rect.sizeY, setRect.offsetY + setRect.sizeY);
-      mSetScissor.extent.width = right - mSetScissor.offset.x; 
-      mSetScissor.extent.height = bottom - mSetScissor.offset.y;
-    }
-  } else {
-    originalScissor.offsetX = mDefaultScissor.offset.x;
-    originalScissor.offsetY = mDefaultScissor.offset.y;
-    originalScissor.sizeX = mDefaultScissor.extent.width;
-    originalScissor.sizeY = mDefaultScissor.extent.height;
-    mSetScissor.offset.x = offsetX; 
-    mSetScissor.offset.y = offsetY;
-    mSetScissor.extent.width = sizeX;
-    mSetScissor.extent.height = sizeY;
-  }
-  mScissorIsSet = true;
+
+void Graphics2D::EndDisplayList() {
+  mRecordingList = &mDisplayList;
 }
 
-void Graphics2D::UnsetScissor() {
-  mScissorIsSet = false;
+void Graphics2D::DrawDisplayList(const DisplayList& list) {
+  mRecordingList->AppendShared(list);
 }
 
 //
@@ -620,23 +1109,79 @@ void Graphics2D::UnsetScissor() {
 //
 
 ImageId_t Graphics2D::AddImage(const std::string& imageFile) {
-  static int imageIds = 1;
   if (mImageMap.find(imageFile) != mImageMap.end()) {
     return mImageMap[imageFile]; // Return Existing Image Resource
   }
+  std::vector<uint8_t> pixels;
+  ImageInfo info;
+  if (!LoadImageFile(imageFile, pixels, info)) {
+    throw std::runtime_error("Failed to load Image: " + imageFile);
+  }
+
   // Allocate New Image Resource
-  ImageId_t id = imageIds++;
-  Image newImg(mDevice.physicalDevice, mDevice.logicalDevice, imageFile);
+  ImageId_t id = nextImageId++;
   TemporaryCommandBuffer tempCB(mDevice.logicalDevice, mCommand.commandPool);
-  newImg.Load(mDevice.queue, tempCB.commandBuffer);
-  mImageResources[id] = std::move(newImg);
-  mImageDescriptors.insert({id, CreateTexturedDescriptorSets()});
+  if (info.width <= kMaxAtlasedImageSize && info.height <= kMaxAtlasedImageSize) {
+    AddAtlasedImage(id, pixels, info, tempCB.commandBuffer);
+  } else {
+    // Large images keep a texture of their own.
+    Image newImg(mDevice.physicalDevice, mDevice.logicalDevice, 
+                 info.width, info.height, info.bytesPerPixel);
+    newImg.Load(mDevice.queue, tempCB.commandBuffer, pixels.data());
+    mImageTextureIdx[id] = AddTexture(newImg.GetSampler(), newImg.GetImageView(),
+                                      newImg.GetImageLayout());
+    mImageResources[id] = std::move(newImg);
+  }
   mImageMap[imageFile] = id;
   return id;
 }
 
+void Graphics2D::AddAtlasedImage(ImageId_t id, const std::vector<uint8_t>& pixels,
+                                 const ImageInfo& info, VkCommandBuffer commandBuffer) {
+  const int packedWidth = info.width + kAtlasPadding;
+  const int packedHeight = info.height + kAtlasPadding;
+  int x, y;
+  AtlasPage* page = nullptr;
+  for (AtlasPage& candidate : mAtlasPages) {
+    if (candidate.packer.Pack(packedWidth, packedHeight, x, y)) {
+      page = &candidate;
+      break;
+    }
+  }
+
+  if (!page) {
+    const ImageId_t pageId = nextImageId++;
+    Image pageImage(mDevice.physicalDevice, mDevice.logicalDevice, 
+                    kAtlasPageSize, kAtlasPageSize, 4);
+    // Transparent where nothing is packed (yet).
+    std::vector<uint8_t> clear(kAtlasPageSize * kAtlasPageSize * 4, 0);
+    pageImage.Load(mDevice.queue, commandBuffer, clear.data());
+    mImageTextureIdx[pageId] = AddTexture(pageImage.GetSampler(), pageImage.GetImageView(),
+                                          pageImage.GetImageLayout());
+    mImageResources[pageId] = std::move(pageImage);
+
+    mAtlasPages.push_back({pageId, SkylinePacker(kAtlasPageSize, kAtlasPageSize)});
+    page = &mAtlasPages.back();
+    const bool isPacked = page->packer.Pack(packedWidth, packedHeight, x, y);
+    assert(isPacked && "Atlased images must fit an empty page");
+  }
+
+  mImageResources[page->imageId].Update(mDevice.queue, commandBuffer, pixels.data(), 
+                                        x, y, info.width, info.height);
+
+  AtlasedImage& atlased = mAtlasedImages[id];
+  atlased.pageId = page->imageId;
+  atlased.info = info;
+  atlased.uvRect[0] = static_cast<float>(x) / kAtlasPageSize;
+  atlased.uvRect[1] = static_cast<float>(y) / kAtlasPageSize;
+  atlased.uvRect[2] = static_cast<float>(x + info.width) / kAtlasPageSize;
+  atlased.uvRect[3] = static_cast<float>(y + info.height) / kAtlasPageSize;
+}
+
 ImageInfo Graphics2D::GetImageInfo(ImageId_t id) const {
   ImageInfo info{};
+  auto atlased = mAtlasedImages.find(id);
+  if (atlased != mAtlasedImages.end()) return atlased->second.info;
   auto iter = mImageResources.find(id);
   if (iter == mImageResources.end()) return info;
   info = iter->second.GetImageInfo();
@@ -647,7 +1192,9 @@ FontId_t Graphics2D::AddFont(const std::string& fontFile, const uint32_t pointSi
   TemporaryCommandBuffer tempCB(mDevice.logicalDevice, mCommand.commandPool);
   // Loads Font Atlas onto GPU 
   FontId_t id = mText.AddFont(fontFile, pointSize, mDevice.queue, tempCB.commandBuffer);
-  mFontDescriptors.insert({id, CreateFontDescriptorSets()});
+  const Image& atlas = mText.GetFontInfo(id)->fontAtlas;
+  mFontTextureIdx[id] = AddTexture(atlas.GetSampler(), atlas.GetImageView(),
+                                   atlas.GetImageLayout());
   return id;
 }
 
@@ -695,13 +1242,41 @@ bool Graphics2D::CreateResources() {
   float queuePriority = 1.f;
   queueInfo.pQueuePriorities = &queuePriority;
 
+  // Descriptor indexing, for the texture array. (See mDescriptors)
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &indexingFeatures;
+  vkGetPhysicalDeviceFeatures2(mDevice.physicalDevice, &features);
+  if (!indexingFeatures.shaderSampledImageArrayNonUniformIndexing ||
+      !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+      !indexingFeatures.descriptorBindingPartiallyBound) {
+    throw std::runtime_error("Physical Device lacks descriptor indexing");
+  }
+  VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexingFeatures{};
+  enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  enabledIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+
+  std::vector<const char*> deviceExtensions;
+  if (!mOffscreen.enabled) {
+    deviceExtensions = enabledDeviceExtensions;
+  }
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(mDevice.physicalDevice, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+    deviceExtensions.push_back(kDescriptorIndexingExtension);
+  }
+
   VkDeviceCreateInfo deviceCi{};
   deviceCi.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  deviceCi.pNext = nullptr;
+  deviceCi.pNext = &enabledIndexingFeatures;
   deviceCi.queueCreateInfoCount = 1;
   deviceCi.pQueueCreateInfos = &queueInfo;
-  deviceCi.enabledExtensionCount = enabledDeviceExtensions.size();
-  deviceCi.ppEnabledExtensionNames = enabledDeviceExtensions.data();
+  deviceCi.enabledExtensionCount = deviceExtensions.size();
+  deviceCi.ppEnabledExtensionNames = deviceExtensions.data();
 
   VULKAN_CALL_CHECK(vkCreateDevice(mDevice.physicalDevice, &deviceCi,
                                    nullptr, &mDevice.logicalDevice));
@@ -710,19 +1285,34 @@ bool Graphics2D::CreateResources() {
   mText.SetPhysicalDevice(mDevice.physicalDevice);
   mText.SetDevice(mDevice.logicalDevice);
   
-  CreateSwapchain();
+  if (!mOffscreen.enabled) {
+    CreateSwapchain();
+  }
   CreateCommandBuffer(); 
+  if (!CreateTimestampQueries()) {
+    throw std::runtime_error("Failed to create timestamp queries");
+  }
 
   CreateRenderPass();
-  CreateFramebuffers();
+  CreateBackbuffer();
+  if (mOffscreen.enabled && !CreateReadbackBuffers()) {
+    throw std::runtime_error("Failed to create readback buffers");
+  }
+
+  // Before the Pipelines, which use its layout.
+  if (!CreateTextureDescriptors()) {
+    throw std::runtime_error("Failed to create texture array");
+  }
 
   // Graphics Pipelines 
   CreateLinePipeline();
   CreateFlatColoredPipeline();
   CreateTexturedPipeline();
   CreateTextPipeline();
-  
-  CreateDescriptorPool(); 
+
+  if (!CreateRecordingContexts(1)) {
+    throw std::runtime_error("Failed to create recording context");
+  }
 
   // Synchronization
   CreateSyncPrimitives();
@@ -751,21 +1341,7 @@ bool Graphics2D::CreateSwapchain() {
   ChooseSurfaceFormat(availableSurfaceFormats, mSurface.surfaceFormat);
 
   mSwapchain.format = mSurface.surfaceFormat.format;
-  mSwapchain.extent = mSurface.capabilities.currentExtent;
-
-  mDefaultViewport = {
-    .x = 0.0f, 
-    .y = 0.0f,
-    .minDepth = 0.f,
-    .maxDepth = 1.f
-  };
-  mDefaultViewport.width = static_cast<float>(mSwapchain.extent.width);
-  mDefaultViewport.height= static_cast<float>(mSwapchain.extent.height);
- 
-  mDefaultScissor = {
-      .offset = {0, 0},
-      .extent = mSwapchain.extent
-  };
+  SetExtent(mSurface.capabilities.currentExtent);
 
   VkSwapchainCreateInfoKHR swapCi{};
   swapCi.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -777,7 +1353,7 @@ bool Graphics2D::CreateSwapchain() {
   swapCi.imageColorSpace = mSurface.surfaceFormat.colorSpace;
   swapCi.imageExtent = mSurface.capabilities.currentExtent;
   swapCi.imageArrayLayers = 1;
-  swapCi.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  swapCi.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT; // (See RecordBackbufferCopy())
   swapCi.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
   swapCi.queueFamilyIndexCount = 0;
   swapCi.preTransform =
@@ -800,31 +1376,27 @@ bool Graphics2D::CreateSwapchain() {
       vkGetSwapchainImagesKHR(mDevice.logicalDevice, mSwapchain.swapchain,
                               &swapImageCount, mSwapchain.images.data()));
 
-  mSwapchain.imageViews.resize(swapImageCount);
-  for (int i = 0; i < swapImageCount; i++) {
-    VkImageViewCreateInfo imageCi{};
-    imageCi.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    imageCi.pNext = nullptr;
-    imageCi.flags = 0;
-    imageCi.image = mSwapchain.images[i];
-    imageCi.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    imageCi.format = mSwapchain.format;
-    imageCi.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageCi.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageCi.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    imageCi.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-    imageCi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageCi.subresourceRange.baseMipLevel = 0;
-    imageCi.subresourceRange.levelCount = 1;
-    imageCi.subresourceRange.baseArrayLayer = 0;
-    imageCi.subresourceRange.layerCount = 1;
-    VULKAN_CALL_CHECK(vkCreateImageView(mDevice.logicalDevice, &imageCi,
-                                        nullptr, &mSwapchain.imageViews[i]));
-  }
   return true;
 }
 
+void Graphics2D::SetExtent(VkExtent2D extent) {
+  mSwapchain.extent = extent;
+
+  mDefaultViewport = {
+    .x = 0.0f, 
+    .y = 0.0f,
+    .minDepth = 0.f,
+    .maxDepth = 1.f
+  };
+  mDefaultViewport.width = static_cast<float>(mSwapchain.extent.width);
+  mDefaultViewport.height= static_cast<float>(mSwapchain.extent.height);
+ 
+  mDefaultScissor = {
+      .offset = {0, 0},
+      .extent = mSwapchain.extent
+  };
+}
+
 bool Graphics2D::CreateCommandBuffer() {
   VkCommandPoolCreateInfo poolCreateInfo{};
   poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -862,7 +1434,8 @@ bool Graphics2D::CreateRenderPass() {
   colorOutAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Store
   colorOutAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   colorOutAttachment.finalLayout =
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Transition Image for Presentation
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // Transition Backbuffer for the copy
+                                            // to the Swapchain Image.
 
   // Subpass
   VkAttachmentReference colorAttachRef{};
@@ -882,7 +1455,22 @@ bool Graphics2D::CreateRenderPass() {
   subpassDesc.pDepthStencilAttachment =
       nullptr; // No Depth, Stencil Attachments
 
-  VkSubpassDependency subpassDepen{};
+  // The previous frame's copy must be done reading the Backbuffer before
+  // it is drawn into, and the drawing done before this frame's copy.
+  std::array<VkSubpassDependency, 2> subpassDepen{};
+  subpassDepen[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  subpassDepen[0].dstSubpass = 0;
+  subpassDepen[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  subpassDepen[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  subpassDepen[0].srcAccessMask = 0;
+  subpassDepen[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  subpassDepen[1].srcSubpass = 0;
+  subpassDepen[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  subpassDepen[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  subpassDepen[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  subpassDepen[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  subpassDepen[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
   VkRenderPassCreateInfo rPassCreateInfo{};
   rPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -892,34 +1480,146 @@ bool Graphics2D::CreateRenderPass() {
   rPassCreateInfo.pAttachments = &colorOutAttachment;
   rPassCreateInfo.subpassCount = 1;
   rPassCreateInfo.pSubpasses = &subpassDesc;
-  rPassCreateInfo.dependencyCount = 0;
-  rPassCreateInfo.pDependencies = &subpassDepen;
+  rPassCreateInfo.dependencyCount = subpassDepen.size();
+  rPassCreateInfo.pDependencies = subpassDepen.data();
 
   VULKAN_CALL_CHECK(vkCreateRenderPass(mDevice.logicalDevice,
                                        &rPassCreateInfo, nullptr,
                                        &mRendering.renderPass));
+
+  // Same, but keeps what the Backbuffer holds. (See Graphics2D::SetDamage)
+  colorOutAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  colorOutAttachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  VULKAN_CALL_CHECK(vkCreateRenderPass(mDevice.logicalDevice,
+                                       &rPassCreateInfo, nullptr,
+                                       &mRendering.loadRenderPass));
   return true;
 }
 
-bool Graphics2D::CreateFramebuffers() {
-  mSwapchain.framebuffers.resize(mSwapchain.images.size());
-  for (int i = 0; i < mSwapchain.framebuffers.size(); i++) {
-    VkFramebufferCreateInfo fbCi{};
-    fbCi.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fbCi.pNext = nullptr;
-    fbCi.flags = 0;
-    fbCi.renderPass = mRendering.renderPass;
-    fbCi.attachmentCount = 1;
-    fbCi.pAttachments = &mSwapchain.imageViews[i];
-    fbCi.width = mSwapchain.extent.width;
-    fbCi.height = mSwapchain.extent.height;
-    fbCi.layers = 1;
-    VULKAN_CALL_CHECK(vkCreateFramebuffer(
-        mDevice.logicalDevice, &fbCi, nullptr, &mSwapchain.framebuffers[i]));
+bool Graphics2D::CreateBackbuffer() {
+  VkImageCreateInfo imageCi{};
+  imageCi.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageCi.pNext = nullptr;
+  imageCi.flags = 0;
+  imageCi.imageType = VK_IMAGE_TYPE_2D;
+  imageCi.format = mSwapchain.format;
+  imageCi.extent = {mSwapchain.extent.width, mSwapchain.extent.height, 1};
+  imageCi.mipLevels = 1;
+  imageCi.arrayLayers = 1;
+  imageCi.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCi.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCi.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  imageCi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageCi.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VULKAN_CALL_CHECK(vkCreateImage(mDevice.logicalDevice, &imageCi, nullptr, 
+                                  &mBackbuffer.image));
+
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(mDevice.logicalDevice, mBackbuffer.image, &memReqs);
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.pNext = nullptr;
+  allocInfo.allocationSize = memReqs.size;
+  allocInfo.memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, 
+                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  VULKAN_CALL_CHECK(vkAllocateMemory(mDevice.logicalDevice, &allocInfo, nullptr, 
+                                     &mBackbuffer.memory));
+  VULKAN_CALL_CHECK(vkBindImageMemory(mDevice.logicalDevice, mBackbuffer.image, 
+                                      mBackbuffer.memory, 0));
+
+  VkImageViewCreateInfo viewCi{};
+  viewCi.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewCi.pNext = nullptr;
+  viewCi.flags = 0;
+  viewCi.image = mBackbuffer.image;
+  viewCi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewCi.format = mSwapchain.format;
+  viewCi.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+  viewCi.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+  viewCi.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+  viewCi.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+  viewCi.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  VULKAN_CALL_CHECK(vkCreateImageView(mDevice.logicalDevice, &viewCi,
+                                      nullptr, &mBackbuffer.imageView));
+
+  VkFramebufferCreateInfo fbCi{};
+  fbCi.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  fbCi.pNext = nullptr;
+  fbCi.flags = 0;
+  fbCi.renderPass = mRendering.renderPass;
+  fbCi.attachmentCount = 1;
+  fbCi.pAttachments = &mBackbuffer.imageView;
+  fbCi.width = mSwapchain.extent.width;
+  fbCi.height = mSwapchain.extent.height;
+  fbCi.layers = 1;
+  VULKAN_CALL_CHECK(vkCreateFramebuffer(
+      mDevice.logicalDevice, &fbCi, nullptr, &mBackbuffer.framebuffer));
+
+  // Undefined contents, the next frame is drawn whole.
+  mBackbuffer.isValid = false;
+  return true;
+}
+
+void Graphics2D::DestroyBackbuffer() {
+  vkDestroyFramebuffer(mDevice.logicalDevice, mBackbuffer.framebuffer, nullptr);
+  vkDestroyImageView(mDevice.logicalDevice, mBackbuffer.imageView, nullptr);
+  vkDestroyImage(mDevice.logicalDevice, mBackbuffer.image, nullptr);
+  vkFreeMemory(mDevice.logicalDevice, mBackbuffer.memory, nullptr);
+  mBackbuffer = {};
+}
+
+bool Graphics2D::CreateReadbackBuffers() {
+  const VkDeviceSize size = 
+      static_cast<VkDeviceSize>(mSwapchain.extent.width) * mSwapchain.extent.height * 4;
+  for (ReadbackBuffer& readback : mOffscreen.readbackBuffers) {
+    VkBufferCreateInfo bufferCi{};
+    bufferCi.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCi.pNext = nullptr;
+    bufferCi.flags = 0;
+    bufferCi.size = size;
+    bufferCi.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VULKAN_CALL_CHECK(vkCreateBuffer(mDevice.logicalDevice, &bufferCi, 
+                                     nullptr, &readback.buffer));
+
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(mDevice.logicalDevice, readback.buffer, &memReqs);
+
+    // Host Coherent, so reads need no invalidate after the fence.
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.allocationSize = memReqs.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, 
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VULKAN_CALL_CHECK(vkAllocateMemory(mDevice.logicalDevice, &allocInfo, 
+                                       nullptr, &readback.memory));
+    VULKAN_CALL_CHECK(vkBindBufferMemory(mDevice.logicalDevice, readback.buffer, 
+                                         readback.memory, 0));
+
+    void* mapped = nullptr;
+    VULKAN_CALL_CHECK(vkMapMemory(mDevice.logicalDevice, readback.memory, 0, 
+                                  VK_WHOLE_SIZE, 0, &mapped));
+    readback.mapped = static_cast<uint8_t*>(mapped);
   }
+  // They hold no frame yet.
+  mOffscreen.presentedIdx = -1;
   return true;
 }
 
+void Graphics2D::DestroyReadbackBuffers() {
+  for (ReadbackBuffer& readback : mOffscreen.readbackBuffers) {
+    if (readback.buffer == VK_NULL_HANDLE) {
+      continue;
+    }
+    vkUnmapMemory(mDevice.logicalDevice, readback.memory);
+    vkDestroyBuffer(mDevice.logicalDevice, readback.buffer, nullptr);
+    vkFreeMemory(mDevice.logicalDevice, readback.memory, nullptr);
+    readback = ReadbackBuffer();
+  }
+  mOffscreen.presentedIdx = -1;
+}
 
 VkShaderModule Graphics2D::CreateShaderModule(VkDevice device, const char* shaderFile) {
   std::ifstream shaderStream(shaderFile, std::ios::binary);
@@ -979,7 +1679,7 @@ bool Graphics2D::CreateLinePipeline() {
   VkPushConstantRange framebufferPushConstants;
   framebufferPushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   framebufferPushConstants.offset = 0;
-  framebufferPushConstants.size = sizeof(PushConstantQuadInfo);
+  framebufferPushConstants.size = sizeof(PushConstantFrameInfo);
 
   playoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   playoutCi.pNext = nullptr;
@@ -1021,14 +1721,8 @@ bool Graphics2D::CreateLinePipeline() {
   std::array<VkPipelineShaderStageCreateInfo, 2> pipelineShaderInfo = {
       vertexShaderInfo, fragmentShaderInfo};
 
-  // No Vertex Buffers for now.
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.pNext = nullptr;
-  vertexInputInfo.flags = 0;
-  vertexInputInfo.vertexBindingDescriptionCount = 0;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
+  // One QuadInstance per instance.
+  QuadVertexInput vertexInput(sizeof(QuadInstance));
 
   VkPipelineInputAssemblyStateCreateInfo inputAsInfo{};
   inputAsInfo.sType =
@@ -1113,7 +1807,7 @@ bool Graphics2D::CreateLinePipeline() {
   pipelineCreateInfo.flags = 0;
   pipelineCreateInfo.stageCount = 2;
   pipelineCreateInfo.pStages = pipelineShaderInfo.data();
-  pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+  pipelineCreateInfo.pVertexInputState = &vertexInput.info;
   pipelineCreateInfo.pInputAssemblyState = &inputAsInfo;
   pipelineCreateInfo.pTessellationState = nullptr;
   pipelineCreateInfo.pViewportState = &vpInfo;
@@ -1130,6 +1824,8 @@ bool Graphics2D::CreateLinePipeline() {
   VULKAN_CALL_CHECK(vkCreateGraphicsPipelines(
       mDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
       &mPipelines[LinePipelineIdx].pipeline));
+  mPipelines[LinePipelineIdx].vertexCount = 5; // Closed Line Strip
+  mPipelines[LinePipelineIdx].dynamicLineWidth = true;
   
   vkDestroyShaderModule(mDevice.logicalDevice, vsModule, nullptr);
   vkDestroyShaderModule(mDevice.logicalDevice, fsModule, nullptr);
@@ -1144,7 +1840,7 @@ bool Graphics2D::CreateFlatColoredPipeline() {
   VkPushConstantRange framebufferPushConstants;
   framebufferPushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   framebufferPushConstants.offset = 0;
-  framebufferPushConstants.size = sizeof(PushConstantQuadInfo);
+  framebufferPushConstants.size = sizeof(PushConstantFrameInfo);
 
    playoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
    playoutCi.pNext = nullptr;
@@ -1186,14 +1882,8 @@ bool Graphics2D::CreateFlatColoredPipeline() {
    std::array<VkPipelineShaderStageCreateInfo, 2> pipelineShaderInfo = {
        vertexShaderInfo, fragmentShaderInfo};
 
-   // No Vertex Buffers for now.
-   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-   vertexInputInfo.sType =
-       VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-   vertexInputInfo.pNext = nullptr;
-   vertexInputInfo.flags = 0;
-   vertexInputInfo.vertexBindingDescriptionCount = 0;
-   vertexInputInfo.vertexAttributeDescriptionCount = 0;
+   // One QuadInstance per instance.
+   QuadVertexInput vertexInput(sizeof(QuadInstance));
 
    VkPipelineInputAssemblyStateCreateInfo inputAsInfo{};
    inputAsInfo.sType =
@@ -1278,7 +1968,7 @@ bool Graphics2D::CreateFlatColoredPipeline() {
    pipelineCreateInfo.flags = 0;
    pipelineCreateInfo.stageCount = 2;
    pipelineCreateInfo.pStages = pipelineShaderInfo.data();
-   pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+   pipelineCreateInfo.pVertexInputState = &vertexInput.info;
    pipelineCreateInfo.pInputAssemblyState = &inputAsInfo;
    pipelineCreateInfo.pTessellationState = nullptr;
    pipelineCreateInfo.pViewportState = &vpInfo;
@@ -1302,34 +1992,20 @@ bool Graphics2D::CreateFlatColoredPipeline() {
 
 bool Graphics2D::CreateTexturedPipeline() {
   // Pipeline Layout:
-  //  - DescriptorSetLayout
+  //  - DescriptorSetLayout (The texture array)
   //  - PushConstant
-  VkDescriptorSetLayoutBinding layoutBinding{};
-  layoutBinding.binding = 0;
-  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  layoutBinding.descriptorCount = 1;
-  layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-  VkDescriptorSetLayoutCreateInfo layoutCi{};
-  layoutCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutCi.flags = 0;
-  layoutCi.bindingCount = 1;
-  layoutCi.pBindings = &layoutBinding;
-  
-  vkCreateDescriptorSetLayout(mDevice.logicalDevice, &layoutCi, 
-                              nullptr, &mPipelines[TexturedPipelineIdx].descriptorLayouts); 
 
   VkPipelineLayoutCreateInfo playoutCi{};
   VkPushConstantRange framebufferPushConstants;
   framebufferPushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   framebufferPushConstants.offset = 0;
-  framebufferPushConstants.size = sizeof(PushConstantQuadInfo);
+  framebufferPushConstants.size = sizeof(PushConstantFrameInfo);
 
   playoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   playoutCi.pNext = nullptr;
   playoutCi.flags = 0;
   playoutCi.setLayoutCount = 1;
-  playoutCi.pSetLayouts = &mPipelines[TexturedPipelineIdx].descriptorLayouts;
+  playoutCi.pSetLayouts = &mDescriptors.textureLayout;
   playoutCi.pushConstantRangeCount = 1;
   playoutCi.pPushConstantRanges = &framebufferPushConstants;
   VULKAN_CALL_CHECK(vkCreatePipelineLayout(
@@ -1368,14 +2044,8 @@ bool Graphics2D::CreateTexturedPipeline() {
   std::array<VkPipelineShaderStageCreateInfo, 2> pipelineShaderInfo = {
       vertexShaderInfo, fragmentShaderInfo};
 
-  // No Vertex Buffers for now.
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.pNext = nullptr;
-  vertexInputInfo.flags = 0;
-  vertexInputInfo.vertexBindingDescriptionCount = 0;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
+  // One QuadInstance per instance.
+  QuadVertexInput vertexInput(sizeof(QuadInstance));
 
   VkPipelineInputAssemblyStateCreateInfo inputAsInfo{};
   inputAsInfo.sType =
@@ -1466,7 +2136,7 @@ bool Graphics2D::CreateTexturedPipeline() {
   pipelineCreateInfo.flags = 0;
   pipelineCreateInfo.stageCount = 2;
   pipelineCreateInfo.pStages = pipelineShaderInfo.data();
-  pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+  pipelineCreateInfo.pVertexInputState = &vertexInput.info;
   pipelineCreateInfo.pInputAssemblyState = &inputAsInfo;
   pipelineCreateInfo.pTessellationState = nullptr;
   pipelineCreateInfo.pViewportState = &vpInfo;
@@ -1490,41 +2160,27 @@ bool Graphics2D::CreateTexturedPipeline() {
 
 bool Graphics2D::CreateTextPipeline() {
   // Pipeline Layout:
-  //  - DescriptorSetLayout
+  //  - DescriptorSetLayout (The texture array)
   //  - PushConstant
-  VkDescriptorSetLayoutBinding layoutBinding{};
-  layoutBinding.binding = 0;
-  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  layoutBinding.descriptorCount = 1;
-  layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-  VkDescriptorSetLayoutCreateInfo layoutCi{};
-  layoutCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutCi.flags = 0;
-  layoutCi.bindingCount = 1;
-  layoutCi.pBindings = &layoutBinding;
-  
-  vkCreateDescriptorSetLayout(mDevice.logicalDevice, &layoutCi, 
-                              nullptr, &mPipelines[TextPipelineIdx].descriptorLayouts);
 
   VkPipelineLayoutCreateInfo playoutCi{};
   VkPushConstantRange framebufferPushConstants;
   framebufferPushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   framebufferPushConstants.offset = 0;
-  framebufferPushConstants.size = sizeof(PushConstantQuadInfo);
+  framebufferPushConstants.size = sizeof(PushConstantFrameInfo);
 
   playoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   playoutCi.pNext = nullptr;
   playoutCi.flags = 0;
   playoutCi.setLayoutCount = 1;
-  playoutCi.pSetLayouts = &mPipelines[TextPipelineIdx].descriptorLayouts; // For Text Atlas
+  playoutCi.pSetLayouts = &mDescriptors.textureLayout;
   playoutCi.pushConstantRangeCount = 1;
   playoutCi.pPushConstantRanges = &framebufferPushConstants;
   VULKAN_CALL_CHECK(vkCreatePipelineLayout(
       mDevice.logicalDevice, &playoutCi, nullptr, &mPipelines[TextPipelineIdx].layout));
 
   VkShaderModule vsModule = CreateShaderModule(
-      mDevice.logicalDevice, shaderTexturedvs_spv, shaderTexturedvs_spv_len);
+      mDevice.logicalDevice, shaderTextvs_spv, shaderTextvs_spv_len);
   VkShaderModule fsModule =
       CreateShaderModule(mDevice.logicalDevice, shaderTextfs_spv, shaderTextfs_spv_len);
 
@@ -1553,14 +2209,8 @@ bool Graphics2D::CreateTextPipeline() {
   std::array<VkPipelineShaderStageCreateInfo, 2> pipelineShaderInfo = {
       vertexShaderInfo, fragmentShaderInfo};
 
-  // No Vertex Buffers for now.
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.pNext = nullptr;
-  vertexInputInfo.flags = 0;
-  vertexInputInfo.vertexBindingDescriptionCount = 0;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
+  // One GlyphInstance per instance.
+  GlyphVertexInput vertexInput(sizeof(GlyphInstance));
 
   VkPipelineInputAssemblyStateCreateInfo inputAsInfo{};
   inputAsInfo.sType =
@@ -1650,7 +2300,7 @@ bool Graphics2D::CreateTextPipeline() {
   pipelineCreateInfo.flags = 0;
   pipelineCreateInfo.stageCount = 2;
   pipelineCreateInfo.pStages = pipelineShaderInfo.data();
-  pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+  pipelineCreateInfo.pVertexInputState = &vertexInput.info;
   pipelineCreateInfo.pInputAssemblyState = &inputAsInfo;
   pipelineCreateInfo.pTessellationState = nullptr;
   pipelineCreateInfo.pViewportState = &vpInfo;
@@ -1672,49 +2322,202 @@ bool Graphics2D::CreateTextPipeline() {
   return true;
 }
 
-void Graphics2D::CreateDescriptorPool() {
+bool Graphics2D::CreateTextureDescriptors() {
+  VkDescriptorSetLayoutBinding layoutBinding{};
+  layoutBinding.binding = 0;
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  layoutBinding.descriptorCount = kMaxTextures;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  // Elements past textureCount are never written, and elements are 
+  // written while frames in flight use the set.
+  VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                          VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCi{};
+  bindingFlagsCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsCi.pNext = nullptr;
+  bindingFlagsCi.bindingCount = 1;
+  bindingFlagsCi.pBindingFlags = &bindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo layoutCi{};
+  layoutCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutCi.pNext = &bindingFlagsCi;
+  layoutCi.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layoutCi.bindingCount = 1;
+  layoutCi.pBindings = &layoutBinding;
+  VULKAN_CALL_CHECK(vkCreateDescriptorSetLayout(mDevice.logicalDevice, &layoutCi, 
+                                                nullptr, &mDescriptors.textureLayout));
+
   VkDescriptorPoolSize poolSize;
   poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSize.descriptorCount = kFRAMES_IN_FLIGHT;
+  poolSize.descriptorCount = kMaxTextures;
 
   VkDescriptorPoolCreateInfo poolCi{};
   poolCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolCi.flags =  0;
-  poolCi.maxSets = kFRAMES_IN_FLIGHT*30; // Max number of Descriptor Sets.
-                                                 // TODO: Arbitrarily chosen
-                                                 //       for now. Fix Later
-                                                 //       to handle allocation
-                                                 //       failure.
+  poolCi.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolCi.maxSets = 1;
   poolCi.poolSizeCount = 1;
   poolCi.pPoolSizes = &poolSize;
+  VULKAN_CALL_CHECK(vkCreateDescriptorPool(mDevice.logicalDevice, &poolCi, nullptr, 
+                                           &mDescriptors.descriptorPool));
 
-  vkCreateDescriptorPool(mDevice.logicalDevice, &poolCi, nullptr, &mDescriptors.descriptorPool);
-}
-
-std::array<VkDescriptorSet, 2> Graphics2D::CreateFontDescriptorSets() {
-  std::array<VkDescriptorSet, 2> sets = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-  std::array<VkDescriptorSetLayout, 2> layouts = {mPipelines[TextPipelineIdx].descriptorLayouts, mPipelines[TextPipelineIdx].descriptorLayouts};
   VkDescriptorSetAllocateInfo dsAllocInfo{}; 
   dsAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   dsAllocInfo.pNext = nullptr;
   dsAllocInfo.descriptorPool = mDescriptors.descriptorPool;
-  dsAllocInfo.descriptorSetCount = 2;
-  dsAllocInfo.pSetLayouts = layouts.data();
-  vkAllocateDescriptorSets(mDevice.logicalDevice, &dsAllocInfo, sets.data());
-  return sets;
+  dsAllocInfo.descriptorSetCount = 1;
+  dsAllocInfo.pSetLayouts = &mDescriptors.textureLayout;
+  VULKAN_CALL_CHECK(vkAllocateDescriptorSets(mDevice.logicalDevice, &dsAllocInfo, 
+                                             &mDescriptors.textureSet));
+  return true;
 }
 
-std::array<VkDescriptorSet, 2> Graphics2D::CreateTexturedDescriptorSets() {
-  std::array<VkDescriptorSet, 2> sets = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-  std::array<VkDescriptorSetLayout, 2> layouts = {mPipelines[TexturedPipelineIdx].descriptorLayouts, mPipelines[TexturedPipelineIdx].descriptorLayouts};
-  VkDescriptorSetAllocateInfo dsAllocInfo{}; 
-  dsAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  dsAllocInfo.pNext = nullptr;
-  dsAllocInfo.descriptorPool = mDescriptors.descriptorPool;
-  dsAllocInfo.descriptorSetCount = 2;
-  dsAllocInfo.pSetLayouts = layouts.data();
-  vkAllocateDescriptorSets(mDevice.logicalDevice, &dsAllocInfo, sets.data());
-  return sets;
+bool Graphics2D::CreateRecordingContexts(size_t count) {
+  while (mRecordingContexts.size() < count) {
+    auto context = std::make_unique<RecordingContext>();
+
+    // Command Pools are externally synchronized, so one per context.
+    VkCommandPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.pNext = nullptr;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCreateInfo.queueFamilyIndex = GetQueueFamilyIdx();
+    VULKAN_CALL_CHECK(vkCreateCommandPool(mDevice.logicalDevice,
+                                          &poolCreateInfo, nullptr,
+                                          &context->commandPool));
+
+    VkCommandBufferAllocateInfo cbAllocInfo;
+    cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cbAllocInfo.pNext = nullptr;
+    cbAllocInfo.commandPool = context->commandPool;
+    cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    cbAllocInfo.commandBufferCount = kFRAMES_IN_FLIGHT;
+    VkResult res = vkAllocateCommandBuffers(mDevice.logicalDevice, &cbAllocInfo, 
+                                            context->secondaryCommandBuffers.data());
+
+    bool created = (res == VK_SUCCESS);
+    for (InstanceBuffer& instances : context->instanceBuffers) {
+      created = created && ResizeInstanceBuffer(instances, kInitialInstanceBufferSize);
+    }
+    if (!created) {
+      for (InstanceBuffer& instances : context->instanceBuffers) {
+        DestroyInstanceBuffer(instances);
+      }
+      vkDestroyCommandPool(mDevice.logicalDevice, context->commandPool, nullptr);
+      return false;
+    }
+    mRecordingContexts.push_back(std::move(context));
+  }
+  return true;
+}
+
+void Graphics2D::DestroyRecordingContexts() {
+  for (auto& context : mRecordingContexts) {
+    for (InstanceBuffer& instances : context->instanceBuffers) {
+      DestroyInstanceBuffer(instances);
+    }
+    // Frees its Command Buffers too.
+    vkDestroyCommandPool(mDevice.logicalDevice, context->commandPool, nullptr);
+  }
+  mRecordingContexts.clear();
+}
+
+bool Graphics2D::ResizeInstanceBuffer(InstanceBuffer& instances, VkDeviceSize capacity) {
+  InstanceBuffer resized;
+  resized.capacity = capacity;
+  resized.size = instances.size;
+
+  VkBufferCreateInfo bufferCi{};
+  bufferCi.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCi.pNext = nullptr;
+  bufferCi.flags = 0;
+  bufferCi.size = capacity;
+  bufferCi.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+  bufferCi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VULKAN_CALL_CHECK(vkCreateBuffer(mDevice.logicalDevice, &bufferCi, 
+                                   nullptr, &resized.buffer));
+
+  VkMemoryRequirements memReqs;
+  vkGetBufferMemoryRequirements(mDevice.logicalDevice, resized.buffer, &memReqs);
+  
+  // Host Coherent, so writes need no flush before submission.
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.pNext = nullptr;
+  allocInfo.allocationSize = memReqs.size;
+  allocInfo.memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, 
+                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  VULKAN_CALL_CHECK(vkAllocateMemory(mDevice.logicalDevice, &allocInfo, 
+                                     nullptr, &resized.memory));
+  VULKAN_CALL_CHECK(vkBindBufferMemory(mDevice.logicalDevice, resized.buffer, 
+                                       resized.memory, 0));
+  
+  // Stays mapped until the buffer is destroyed.
+  void* mapped = nullptr;
+  VULKAN_CALL_CHECK(vkMapMemory(mDevice.logicalDevice, resized.memory, 0, 
+                                VK_WHOLE_SIZE, 0, &mapped));
+  resized.mapped = static_cast<uint8_t*>(mapped);
+
+  if (instances.mapped) {
+    memcpy(resized.mapped, instances.mapped, instances.size);
+  }
+  DestroyInstanceBuffer(instances);
+  instances = resized;
+  return true;
+}
+
+void Graphics2D::DestroyInstanceBuffer(InstanceBuffer& instances) {
+  if (instances.buffer == VK_NULL_HANDLE) {
+    return;
+  }
+  vkUnmapMemory(mDevice.logicalDevice, instances.memory);
+  vkDestroyBuffer(mDevice.logicalDevice, instances.buffer, nullptr);
+  vkFreeMemory(mDevice.logicalDevice, instances.memory, nullptr);
+  instances = InstanceBuffer();
+}
+
+// From https://vulkan-tutorial.com/Vertex_buffers/Vertex_buffer_creation#page_Memory-requirements
+uint32_t Graphics2D::FindMemoryType(uint32_t allowableMemoryTypes,
+                                    VkMemoryPropertyFlags requestedProperties) const {
+  VkPhysicalDeviceMemoryProperties memProps;
+  vkGetPhysicalDeviceMemoryProperties(mDevice.physicalDevice, &memProps); 
+  for (int i=0; i<memProps.memoryTypeCount; i++) {
+    if ((allowableMemoryTypes & (1 << i)) && 
+        ((memProps.memoryTypes[i].propertyFlags & requestedProperties) == requestedProperties)) {
+      return i;
+    }
+  }
+  throw std::runtime_error("Failed to find suitable memory type");
+}
+
+bool Graphics2D::CreateTimestampQueries() {
+  uint32_t queueFamilyCount;
+  vkGetPhysicalDeviceQueueFamilyProperties(mDevice.physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(mDevice.physicalDevice, &queueFamilyCount,
+                                           queueFamilies.data());
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(mDevice.physicalDevice, &deviceProperties);
+
+  const uint32_t validBits = queueFamilies[GetQueueFamilyIdx()].timestampValidBits;
+  if (validBits == 0 || deviceProperties.limits.timestampPeriod <= 0.f) {
+    return true; // Frames go untimed.
+  }
+  mTimestamps.nsPerTick = deviceProperties.limits.timestampPeriod;
+  mTimestamps.validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  VkQueryPoolCreateInfo queryPoolCi{};
+  queryPoolCi.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCi.pNext = nullptr;
+  queryPoolCi.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCi.queryCount = kQueriesPerFrame * kFRAMES_IN_FLIGHT;
+  VULKAN_CALL_CHECK(vkCreateQueryPool(mDevice.logicalDevice, &queryPoolCi, nullptr,
+                                      &mTimestamps.queryPool));
+#ifdef ENABLE_PROFILER
+  mTimestamps.track = Profiler::AddTrack("GPU");
+#endif
+  return true;
 }
 
 bool Graphics2D::CreateSyncPrimitives() {
@@ -1757,16 +2560,4 @@ const Image* Graphics2D::GetImage(ImageId_t id) const {
   return &(iter->second);
 }
 
-std::array<VkDescriptorSet, 2> Graphics2D::GetImageDescriptors(ImageId_t id) const {
-  auto iter = mImageDescriptors.find(id);
-  if (iter == mImageDescriptors.end()) return {VK_NULL_HANDLE, VK_NULL_HANDLE};
-  return iter->second;
-}
-
-std::array<VkDescriptorSet, 2> Graphics2D::GetFontDescriptors(FontId_t id) const {
-  auto iter = mFontDescriptors.find(id);
-  if (iter == mFontDescriptors.end()) return {VK_NULL_HANDLE, VK_NULL_HANDLE};
-  return iter->second;
-}
-
 
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdio>
@@ -10,6 +11,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
@@ -18,13 +20,16 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "CommandState.h"
+#include "DisplayList.h"
+#include "DrawBatcher.h"
 #include "Font.h"
 #include "Image.h"
+#include "Profiler.h"
+#include "SkylinePacker.h"
 
 // TODO: Better Resource Management.
 //       Loading and Unloading of Textures at the necessary moments, etc.
-//        
-// TODO: Switch to using Vertex Buffers!
 struct __attribute__((packed)) vec2 {
   float x;
   float y;
@@ -54,6 +59,24 @@ public:
   // as well as Extensions and Layers expressed 
   // in "enabledInstanceExtensions" and "enabledInstanceLayers"
   bool Init(const char **enabledExtensions, const uint32_t extensionCount);
+
+  // Instead of Init() and SetSurface(): creates a VkInstance without
+  // any Surface Extension, then the Vulkan Resources, drawing frames
+  // into a 'width' x 'height' image rather than a Swapchain. 
+  // Needs no window or display, so it runs on software
+  // implementations too. (eg: lavapipe)
+  bool InitOffscreen(uint32_t width, uint32_t height);
+
+  bool IsOffscreen() const { return mOffscreen.enabled; }
+
+  // Offscreen equivalent of Resize(): there's no Surface to take
+  // the size from.
+  bool ResizeOffscreen(uint32_t width, uint32_t height);
+
+  // Offscreen only. Waits for the most recently presented frame and
+  // copies it into 'rgba', 4 bytes per pixel, row by row.
+  // Returns false if no frame was presented yet.
+  bool ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
  
   // VkSurface is set. Then majority of 
   // Vulkan Resources are created.
@@ -72,8 +95,20 @@ public:
   // and starts Render Pass
   void BeginRecording();
   
+  // Records the frame's batched Draw Calls into the Backbuffer,
+  // then copies it to the Swapchain Image.
   // Ends Render Pass and Command Buffer
   void EndRecording();
+
+  // Frames are drawn into a Backbuffer which is kept from one frame to
+  // the next. Only the pixels inside 'damage' are redrawn this frame,
+  // the rest keep what previous frames drew. Call before EndRecording().
+  // Without a damage, or on the first frame after a Resize(), the whole
+  // window is redrawn. (See DamageTracker)
+  void SetDamage(const ClipRect& damage);
+
+  // Draw Calls recorded so far this frame.
+  const DisplayList& GetDisplayList() const { return mDisplayList; }
   
   // Submits Command Buffer for Execution
   // and Current Swapchain Image for 
@@ -90,25 +125,38 @@ public:
   // Revert to Default Line Width
   void UnsetLineWidth();
   
-  // Set Scissor. Returns currently-set Scissor, if one is.
-  void SetScissor(const Rect& scissor, Rect& originalScissor);
-  void SetScissor(int offsetX, int offsetY, 
-                  int sizeX, int sizeY, Rect& originalScissor);
+  // Clip subsequent Draw Calls to the given rect, intersected
+  // with the currently pushed Scissor. Every push needs a pop.
+  void PushScissor(const Rect& scissor);
+  void PushScissor(int offsetX, int offsetY, int sizeX, int sizeY);
   
-  // Apply no Scissor. Render to entire Framebuffer
-  void UnsetScissor();
+  // Revert to the Scissor before the matching PushScissor.
+  void PopScissor();
+
+  // Draw Calls don't record Vulkan commands right away. Each one appends
+  // an op to this frame's DisplayList. EndRecording() reorders the ops
+  // so that ones sharing pipeline, texture, scissor and line width are
+  // adjacent, where they don't overlap, and records each such run
+  // as a single instanced draw.
+
+  // Redirects subsequent Draw Calls into 'list', replacing its contents,
+  // until EndDisplayList(). The recorded Draw Calls can then be repeated
+  // with DrawDisplayList(), for as long as 'list' is left unchanged.
+  void BeginDisplayList(DisplayList* list);
+  void EndDisplayList();
+  void DrawDisplayList(const DisplayList& list);
 
   // Draws a Flat-colored Box at given coordinates.
-  // Uses the Set Scissor, if one is set.
+  // Uses the pushed Scissor, if one is.
   void DrawRect(int32_t l, int32_t t, int32_t r, int32_t b);
   
   // Draws outline of a Box at given coordinates.
-  // Uses Set Scissor and Set Line Width, if one is set.
+  // Uses the pushed Scissor and Set Line Width, if one is.
   void DrawOutline(int32_t l, int32_t t, int32_t r, int32_t b);
   
   // Draws Box at given coordintates with ImageId_t acting 
   // as a texture. Texture will be sampled to fit box.
-  // Uses Set Scissior, if one is set.
+  // Uses the pushed Scissor, if one is.
   void DrawTexturedRect(ImageId_t imgId, int32_t l, int32_t t, 
                         int32_t r, int32_t b);
 
@@ -116,20 +164,26 @@ public:
   // as texture. 4 Texture coords are passed through to 
   // shader for Top-Left, Top-Right, Bottom-Right,
   // Bottom-Left vertices, respectively.
-  // Uses Set Scissor, if one is set.
+  // Uses the pushed Scissor, if one is.
   void DrawTexturedRect(ImageId_t imageId, int32_t l, int32_t t, 
                         int32_t r, int32_t b, 
                         const std::vector<vec2>& textureCoords);
   
   // Draws string on baseline specified by baselineX, baselineY.
   // Uses FontId_t to specify font and point size.
-  // Uses Set Scissor, if one is set.
+  // Uses the pushed Scissor, if one is.
   void DrawText(FontId_t fontId, const std::string& str, 
                 int32_t baselineX, int32_t baselineY);
   
   // Creates Image Resource and loads it onto GPU.
   // Returns ImageId_t for user to reference 
   // images in Draw calls and GetImageInfo.
+  // Small images (eg: icons) are packed into shared atlas pages, so
+  // that draws of different ones can be batched together. Texture
+  // coordinates of those are clamped to [0, 1], they don't repeat.
+  // Image ids are unique across all Graphics2D instances and threads. The
+  // image maps, atlas pages and uploads aren't synchronized though, so
+  // call it from the thread which records frames.
   ImageId_t AddImage(const std::string& imageFile);
   
   // Get ImageInfo given ImageId_t 
@@ -145,6 +199,26 @@ public:
   // Get FontInfo given FontId_t 
   const FontInfo* GetFontInfo(FontId_t fontId);
   
+  const CommandStats& GetCommandStats() const { return mCommandStats; }
+  void ResetCommandStats() { mCommandStats = {}; }
+
+  // GPU time of a frame, from timestamps written around its Render Pass
+  // and each batch. Next to the CPU time of the frame, tells whether it
+  // is GPU-bound. Batches overlap as the GPU pipelines them, so their
+  // times can add up to more than the Render Pass.
+  struct GpuFrameStats {
+    uint64_t frame = 0; // Frames submitted before it.
+    double renderPassMs = 0.0; // 0 if nothing was redrawn.
+    // Batches of the Line, Flat, Textured and Text pipelines, summed.
+    std::array<double, 4> pipelineMs{};
+    uint32_t batchCount = 0; // Batches timed, at most kMaxTimedBatches.
+  };
+  // Of the most recent frame read back. Frames are read back when their
+  // fence is next waited on, kFRAMES_IN_FLIGHT frames later, so this
+  // never stalls. All zero if the queue can't write timestamps.
+  const GpuFrameStats& GetGpuFrameStats() const { return mTimestamps.stats; }
+  static constexpr uint32_t kMaxTimedBatches = 1024; // Per frame.
+
   VkInstance GetVkInstance() const { return mVulkanInstance; }
 
  private:
@@ -162,11 +236,39 @@ public:
                                     // most recently acquired when calling
                                     // Graphics2D::BeginRecording.
  
-    std::vector<VkImageView> imageViews;
-    std::vector<VkFramebuffer> framebuffers;
     bool Resize();
   } mSwapchain;
 
+  // What the Render Pass draws into. Copied to the Swapchain Image
+  // every frame: Swapchain Images don't keep their contents between
+  // the frames they're acquired in, this does. (See SetDamage())
+  struct {
+    VkImage image{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkImageView imageView{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    bool isValid = false; // Holds a whole frame.
+  } mBackbuffer;
+  ClipRect mDamage{0, 0, 0, 0};
+  bool mDamageIsSet = false;
+
+  // Host-visible and persistently mapped.
+  struct ReadbackBuffer {
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    uint8_t* mapped = nullptr;
+  };
+
+  // Offscreen, there's no Surface or Swapchain. The Backbuffer is the
+  // render target: mSwapchain.extent and format are its own, and each
+  // frame ends copying it into the frame's ReadbackBuffer. (See ReadPixels())
+  struct {
+    bool enabled = false;
+    std::array<ReadbackBuffer, kFRAMES_IN_FLIGHT> readbackBuffers{};
+    int presentedIdx = -1; // Command Buffer of the most recently presented 
+                           // frame, -1 if none since the last resize.
+  } mOffscreen;
+
   struct {
     VkSurfaceKHR surface{VK_NULL_HANDLE}; // Platform
     VkSurfaceCapabilitiesKHR capabilities;
@@ -197,6 +299,8 @@ public:
     VkDescriptorSetLayout descriptorLayouts{VK_NULL_HANDLE};
     VkPipelineLayout layout{VK_NULL_HANDLE};
     VkPipeline pipeline{VK_NULL_HANDLE};
+    uint32_t vertexCount = 6; // Vertices drawn per instance.
+    bool dynamicLineWidth = false;
   };
   std::array<Pipeline, 4> mPipelines;
   static constexpr size_t LinePipelineIdx = 0;
@@ -212,13 +316,97 @@ public:
   } mCommand;
 
   struct {
-    VkRenderPass renderPass{VK_NULL_HANDLE};
+    VkRenderPass renderPass{VK_NULL_HANDLE}; // Clears the Backbuffer.
+    VkRenderPass loadRenderPass{VK_NULL_HANDLE}; // Keeps it. Compatible with renderPass.
   } mRendering;
   
+  // Every Image and Font Atlas is an element of one array of Combined
+  // Image Samplers, written once when it is added. Instances carry the
+  // index of their texture, so the set is bound once and draws of 
+  // different textures share batches. Needs descriptor indexing: 
+  // non-uniform indices, partially bound and update-after-bind arrays.
   struct {
     VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSetLayout textureLayout{VK_NULL_HANDLE};
+    VkDescriptorSet textureSet{VK_NULL_HANDLE};
+    uint32_t textureCount = 0; // Elements written so far.
   } mDescriptors;
   
+  // Per-instance data of a quad. Read by the quad vertex shaders
+  // through the vertex input attributes. (See QuadVertexInput in Graphics2D.cpp)
+  struct __attribute__((packed)) QuadInstance {
+    int32_t quadCoords[4]; // In FrameBuffer Coordinates.
+    uint8_t rgba[4];
+    uint32_t textureIdx; // Textured only. (See mDescriptors)
+    uint32_t padding[2];
+    vec2 textureCoords[4]; // Normalized Coordinates [0, 1]
+                           // Top Left, Top Right, Bottom Right, BottomLeft
+  };
+
+  // Per-instance data of a glyph. Read by shaderText.vert, 
+  // which is why it is much smaller than a QuadInstance: Text-heavy 
+  // frames emit thousands of these. (See GlyphVertexInput in Graphics2D.cpp)
+  struct __attribute__((packed)) GlyphInstance {
+    int32_t position[2]; // Top Left, in FrameBuffer Coordinates.
+    int16_t size[2]; // width, height
+    uint16_t atlasRect[4]; // (See GlyphQuad::atlasRect)
+    uint8_t rgba[4];
+    uint32_t textureIdx; // Of the Font Atlas. (See mDescriptors)
+  };
+
+  // Host-visible and persistently mapped. One per frame in flight,
+  // so the CPU fills one while the GPU may still read the other.
+  struct InstanceBuffer {
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    uint8_t* mapped = nullptr;
+    VkDeviceSize capacity = 0; // In bytes.
+    VkDeviceSize size = 0; // Bytes written this frame.
+  };
+
+  // What one thread needs to record a chunk of the ordered ops.
+  // A frame small enough for one chunk is recorded by the first context 
+  // into the primary Command Buffer. Otherwise each chunk is recorded into 
+  // its context's Secondary Command Buffer, in parallel.
+  // (See RecordDisplayList())
+  struct RecordingContext {
+    std::array<InstanceBuffer, kFRAMES_IN_FLIGHT> instanceBuffers;
+    DrawBatcher batcher; // This frame's batches, laid out in instanceBuffers.
+    VkCommandPool commandPool{VK_NULL_HANDLE};
+    std::array<VkCommandBuffer, kFRAMES_IN_FLIGHT> secondaryCommandBuffers{};
+    VkCommandBuffer commandBuffer{VK_NULL_HANDLE}; // Recorded into this frame.
+    // Of commandBuffer. Reset when recording begins, except its stats, 
+    // which are added to mCommandStats once recorded.
+    CommandState state;
+  };
+  std::vector<std::unique_ptr<RecordingContext>> mRecordingContexts;
+  CommandStats mCommandStats;
+
+  // Timestamp queries, a range of kQueriesPerFrame per frame in flight:
+  // the Render Pass begin and end, then a begin and end per batch.
+  // With ENABLE_PROFILER, frames read back are also recorded as zones
+  // of the "GPU" track. (See ReadTimestamps())
+  static constexpr uint32_t kQueriesPerFrame = 2 + 2 * kMaxTimedBatches;
+  struct {
+    VkQueryPool queryPool{VK_NULL_HANDLE}; // VK_NULL_HANDLE if the queue can't write timestamps.
+    double nsPerTick = 1.0;
+    uint64_t validMask = ~0ull; // Of the bits written.
+    // Per frame in flight.
+    std::array<std::atomic<uint32_t>, kFRAMES_IN_FLIGHT> batchCount{}; // Batches given queries,
+                                                                       // may pass kMaxTimedBatches.
+    std::array<std::array<uint8_t, kMaxTimedBatches>, kFRAMES_IN_FLIGHT> batchPipelines; // Of each.
+    std::array<bool, kFRAMES_IN_FLIGHT> isSubmitted{}; // Not read back yet.
+    std::array<uint64_t, kFRAMES_IN_FLIGHT> submitTime{}; // Profiler::Now()
+    std::array<uint64_t, kFRAMES_IN_FLIGHT> frame{};
+    uint64_t submittedFrames = 0;
+    std::vector<uint64_t> results; // Value and availability of each query.
+    GpuFrameStats stats;
+
+    Profiler::Track* track = nullptr;
+    bool hasClockOffset = false;
+    int64_t clockOffset = 0; // Profiler::Now() minus GPU time, in ns.
+  } mTimestamps;
+
   struct {
     std::vector<VkSemaphore> renderCompleteSemaphores;
     std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -247,20 +435,75 @@ public:
     VkCommandBuffer commandBuffer;
   };
 
-  void UpdateDescriptorSet(VkDescriptorSet descriptorSet, VkSampler sampler,
-                           VkImageView imageView, VkImageLayout imageLayout);
+  // Writes the next element of the texture array. Returns its index.
+  uint32_t AddTexture(VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout);
+
+  // Records the Render Pass: mDisplayList's ops, in the order 
+  // DisplayList::Order() gives, as instanced draws.
+  void RecordDisplayList();
+  // Records ordered ops [first, last) into context.commandBuffer.
+  void RecordChunk(RecordingContext& context, size_t first, size_t last);
+  void RecordOp(RecordingContext& context, const DrawOp& op, const VkRect2D& scissor);
+  void BeginRenderPass(VkSubpassContents contents, const ClipRect& renderArea);
+  void BeginSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+
+  // Appends 'count' instances of 'instanceSize' bytes, to be drawn with 
+  // the given pipeline and descriptor set. Extends the current batch if its 
+  // state matches, starts a new one otherwise.
+  // Returns where the instance data must be written.
+  uint8_t* AddInstance(RecordingContext& context, 
+                       size_t pipelineIdx, VkDescriptorSet descriptorSet,
+                       const VkRect2D& scissor, float lineWidth,
+                       VkDeviceSize instanceSize, uint32_t count = 1);
+  void AddQuad(RecordingContext& context, 
+               size_t pipelineIdx, VkDescriptorSet descriptorSet,
+               const VkRect2D& scissor, float lineWidth,
+               const QuadInstance& quad);
+
+  // Copies the Backbuffer to the current Swapchain Image
+  // and readies the latter for presentation.
+  void RecordBackbufferCopy();
+
+  // Offscreen, copies the Backbuffer to this frame's ReadbackBuffer.
+  void RecordReadback();
+
+  // Records context.batcher's batches into context.commandBuffer.
+  void RecordBatches(RecordingContext& context);
+
+  // Writes query 'query' of this frame's range, if timestamps are written.
+  void CmdWriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage,
+                         uint32_t query);
+  // Reads back the timestamps of this frame's previous submission,
+  // once its fence is signaled, into mTimestamps.stats.
+  void ReadTimestamps();
+
+  // Record a state command into context.commandBuffer, 
+  // unless context.state says it is already set.
+  void CmdBindPipeline(RecordingContext& context, size_t pipelineIdx);
+  void CmdBindDescriptorSet(RecordingContext& context, size_t pipelineIdx, 
+                            VkDescriptorSet descriptorSet);
+  void CmdSetViewport(RecordingContext& context, const VkViewport& viewport);
+  void CmdSetScissor(RecordingContext& context, const VkRect2D& scissor);
+  void CmdSetLineWidth(RecordingContext& context, float lineWidth);
+  void CmdPushFrameInfo(RecordingContext& context, size_t pipelineIdx);
+  void CmdBindVertexBuffer(RecordingContext& context, VkBuffer buffer);
   
+  // Copies 'pixels' into the first AtlasPage with room for them,
+  // creating a page if none has.
+  void AddAtlasedImage(ImageId_t id, const std::vector<uint8_t>& pixels,
+                       const ImageInfo& info, VkCommandBuffer commandBuffer);
+
   // Image Retrieval
   const Image* GetImage(ImageId_t id) const;
-  std::array<VkDescriptorSet, 2> GetImageDescriptors(ImageId_t id) const;
-  
-  // Font Retrieval
-  std::array<VkDescriptorSet, 2> GetFontDescriptors(FontId_t id) const;
   
   //
   // Vulkan Resource Creation
   // 
 
+  // Enables given Instance Extensions, and the Layers of 
+  // "enabledInstanceLayers" which are installed.
+  bool CreateInstance(const std::vector<const char*>& extensions);
+
   void ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats, VkSurfaceFormatKHR &formatOut) const;
 
   // Creates Vulkan Resources below.
@@ -269,14 +512,36 @@ public:
   
   // Create VkSwapchain 
   bool CreateSwapchain();
+
+  // Size frames are drawn at. Sets the default Viewport and Scissor.
+  void SetExtent(VkExtent2D extent);
   // Create VkCommandBuffer
   bool CreateCommandBuffer();
 
   // Create VkRenderPass
   bool CreateRenderPass();
 
-  // Create VkFramebuffer
-  bool CreateFramebuffers();
+  // Create mBackbuffer, sized as the Swapchain, and its VkFramebuffer.
+  bool CreateBackbuffer();
+  void DestroyBackbuffer();
+
+  // Create mOffscreen.readbackBuffers, sized as the Backbuffer.
+  bool CreateReadbackBuffers();
+  void DestroyReadbackBuffers();
+
+  // Create mTimestamps.queryPool, unless the queue can't write timestamps.
+  bool CreateTimestampQueries();
+
+  // Grows mRecordingContexts to 'count' contexts.
+  bool CreateRecordingContexts(size_t count);
+  void DestroyRecordingContexts();
+
+  // (Re)allocates 'instances' with room for 'capacity' bytes.
+  // Contents written so far are kept.
+  bool ResizeInstanceBuffer(InstanceBuffer& instances, VkDeviceSize capacity);
+  void DestroyInstanceBuffer(InstanceBuffer& instances);
+  uint32_t FindMemoryType(uint32_t allowableMemoryTypes,
+                          VkMemoryPropertyFlags requestedProperties) const;
   
   // Create VkShaderModule using given file.
   VkShaderModule CreateShaderModule(VkDevice device, const char* shaderFile); 
@@ -299,15 +564,9 @@ public:
   // drawing Text
   bool CreateTextPipeline();
   
-  // Create Descriptor Pool (VkDescriptorPool)
-  // for allocating Descriptor Sets.
-  void CreateDescriptorPool();
-  
-  // Create Descriptor Sets for Text Atlas
-  // and Texture.
-  // Stored in mFontDescriptors and mImageDescriptors respectively.
-  std::array<VkDescriptorSet, 2> CreateFontDescriptorSets();
-  std::array<VkDescriptorSet, 2> CreateTexturedDescriptorSets();
+  // Create the texture array's VkDescriptorSetLayout, 
+  // VkDescriptorPool and VkDescriptorSet. (See mDescriptors)
+  bool CreateTextureDescriptors();
   
   // Create the Following synchorization
   // primitives:
@@ -356,21 +615,33 @@ public:
                             // Line Width...
   VkViewport mDefaultViewport;
   VkRect2D mDefaultScissor;
-  VkRect2D mSetScissor;
-  bool mScissorIsSet = false;
+  DisplayList mDisplayList; // This frame's Draw Calls.
+  DisplayList* mRecordingList = &mDisplayList; // Where Draw Calls go.
+  std::vector<DisplayList::Item> mOrderedOps;
   bool mLineWidthIsSet = false;
 
-  float mDefaultLineWidth = 2.0f;
+  float mDefaultLineWidth = 1.0f; // Wider lines need the wideLines feature.
   float mCurrentLineWidth = 1.0f;
 
   Text mText;
 
   std::unordered_map<std::string, ImageId_t> mImageMap;
   std::unordered_map<ImageId_t, Image> mImageResources;
-  std::unordered_map<ImageId_t, std::array<VkDescriptorSet, 2>> mImageDescriptors;
-  std::unordered_map<FontId_t, std::array<VkDescriptorSet, 2>> mFontDescriptors;
-  
-  // Used to ensure we only update a Descriptor Set once every frame.
-  std::unordered_set<FontId_t> mFontDescriptorsUpdated;
-  std::unordered_set<ImageId_t> mImageDescriptorsUpdated;
+  std::unordered_map<ImageId_t, uint32_t> mImageTextureIdx; // Into the texture array.
+  std::unordered_map<FontId_t, uint32_t> mFontTextureIdx;
+
+  // Shared texture of small images. Pages are Images of their own,
+  // in mImageResources, so they're bound and batched like any other.
+  struct AtlasPage {
+    ImageId_t imageId;
+    SkylinePacker packer;
+  };
+  // Image added with AddImage() which lives in an AtlasPage.
+  struct AtlasedImage {
+    ImageId_t pageId;
+    ImageInfo info;
+    float uvRect[4]; // Left, Top, Right, Bottom in the page. Normalized Coordinates.
+  };
+  std::vector<AtlasPage> mAtlasPages;
+  std::unordered_map<ImageId_t, AtlasedImage> mAtlasedImages;
 };
@@ -11,6 +11,8 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "thirdparty/stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "thirdparty/stb_image_write.h"
 
 // From https://vulkan-tutorial.com/Vertex_buffers/Vertex_buffer_creation#page_Memory-requirements
 uint32_t Image::FindMemoryType(uint32_t allowableMemoryTypes,
@@ -57,7 +59,7 @@ Image::Image(VkPhysicalDevice phyDev, VkDevice device,
 
 Image::Image(VkPhysicalDevice phyDev, VkDevice device, const int width, 
              const int height, const int bytesPerPixel) : mPhysicalDevice(phyDev), 
-             mDevice(device), mIsLoaded(false) {
+             mDevice(device), mImageLayout(VK_IMAGE_LAYOUT_UNDEFINED), mIsLoaded(false) {
   assert(width > 0 && height > 0 && bytesPerPixel > 0 && "Image dimensions must be greater than 0");
   mInfo.width = width;
   mInfo.height = height;
@@ -209,16 +211,23 @@ void Image::CreateStagingBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDevi
 }
 
 void Image::Load(VkQueue queue, VkCommandBuffer commandBuffer, const uint8_t* const imgData) {
-  assert(mImage != VK_NULL_HANDLE && "VkImage must be created before we can transfer to it");
-  assert(mDeviceMemory != VK_NULL_HANDLE && "VkImage must be created before we can transfer to it");
   if (mIsLoaded) {
     return;
   }
+  Update(queue, commandBuffer, imgData, 0, 0, mInfo.width, mInfo.height);
+}
+
+void Image::Update(VkQueue queue, VkCommandBuffer commandBuffer, const uint8_t* const imgData,
+                   int x, int y, int width, int height) {
+  assert(mImage != VK_NULL_HANDLE && "VkImage must be created before we can transfer to it");
+  assert(mDeviceMemory != VK_NULL_HANDLE && "VkImage must be created before we can transfer to it");
+  assert(x >= 0 && y >= 0 && x + width <= mInfo.width && y + height <= mInfo.height &&
+         "Region must be inside the Image");
   
   VkBuffer stagingBuffer;
   VkDeviceMemory stagingMemory;
 
-  const size_t imgSize = mInfo.width * mInfo.height * mInfo.bytesPerPixel;
+  const size_t imgSize = width * height * mInfo.bytesPerPixel;
   CreateStagingBuffer(stagingBuffer, stagingMemory, imgSize);
   
   // Map and Write to Staging Memory
@@ -236,7 +245,8 @@ void Image::Load(VkQueue queue, VkCommandBuffer commandBuffer, const uint8_t* co
   
   VkImageMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // Pixels outside of the region are kept once loaded.
+  barrier.oldLayout = mImageLayout;
   barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -246,10 +256,12 @@ void Image::Load(VkQueue queue, VkCommandBuffer commandBuffer, const uint8_t* co
   barrier.subresourceRange.levelCount = 1;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = 1;
-  barrier.srcAccessMask = 0; 
+  // Frames drawn so far may still be sampling it.
+  barrier.srcAccessMask = mIsLoaded ? VK_ACCESS_SHADER_READ_BIT : 0; 
   barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
   
-  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 
+  vkCmdPipelineBarrier(commandBuffer, 
+                        mIsLoaded ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 
                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
     VkBufferImageCopy region{};
@@ -261,8 +273,8 @@ void Image::Load(VkQueue queue, VkCommandBuffer commandBuffer, const uint8_t* co
     region.imageSubresource.mipLevel = 0;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {static_cast<uint32_t>(mInfo.width), static_cast<uint32_t>(mInfo.height), 1};
+    region.imageOffset = {x, y, 0};
+    region.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
     vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
     
     VkImageMemoryBarrier barrier2{};
@@ -316,3 +328,23 @@ void Image::Load(VkQueue queue, VkCommandBuffer commandBuffer) {
   stbi_image_free(imgData);
 }
 
+
+bool LoadImageFile(const std::string& file, std::vector<uint8_t>& pixels, ImageInfo& info) {
+  int comp;
+  uint8_t* imgData = stbi_load(file.c_str(), &info.width, &info.height, &comp, 4);
+  if (!imgData) {
+    return false;
+  }
+  info.bytesPerPixel = 4;
+  pixels.assign(imgData, imgData + static_cast<size_t>(info.width) * info.height * 4);
+  stbi_image_free(imgData);
+  return true;
+}
+
+bool WritePNGFile(const std::string& file, const std::vector<uint8_t>& pixels, 
+                  int width, int height) {
+  if (pixels.size() < static_cast<size_t>(width) * height * 4) {
+    return false;
+  }
+  return stbi_write_png(file.c_str(), width, height, 4, pixels.data(), width * 4) != 0;
+}
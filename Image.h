@@ -3,6 +3,7 @@
 #include <array>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -14,6 +15,15 @@ struct ImageInfo {
   int bytesPerPixel;
 };
 
+// Decodes an image file to RGBA pixels, 4 bytes each, row by row.
+// Returns false if it can't be read.
+bool LoadImageFile(const std::string& file, std::vector<uint8_t>& pixels, ImageInfo& info);
+
+// Encodes RGBA pixels, 4 bytes each, row by row, as a PNG file.
+// Returns false if it can't be written.
+bool WritePNGFile(const std::string& file, const std::vector<uint8_t>& pixels, 
+                  int width, int height);
+
 class Image {
  public:
    Image();
@@ -28,6 +38,10 @@ class Image {
    
    void Load(VkQueue queue, VkCommandBuffer buffer);
    void Load(VkQueue queue, VkCommandBuffer buffer, const uint8_t* data);
+   // Uploads 'data', 'width' x 'height' tightly packed pixels, to the region 
+   // at 'x', 'y'. Unlike Load(), can be repeated, eg: to add to an atlas.
+   void Update(VkQueue queue, VkCommandBuffer buffer, const uint8_t* data,
+               int x, int y, int width, int height);
    void CreateDescriptorSets(VkDescriptorSetLayout layout);
 
    bool isLoaded() const {
@@ -5,6 +5,7 @@ ImageView::ImageView(WindowRoot* window, const std::string& uri,
                      mURI(uri), mScrollable(scrollable), 
                      mImageResource(-1) {
   mImageResource = GetGraphics()->AddImage(mURI);
+  EnableDrawCache();
 }
 
 // TODO: When to perform scaling?
@@ -16,28 +17,7 @@ void ImageView::measure() {
 }
 
 void ImageView::UpdateConstraints() {
- UpdateWidthConstraint();
- UpdateHeightConstraint();
-}
-
-void ImageView::UpdateWidthConstraint() {
-  if (!mAddedWidthConstraint) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Width, 
-                          Relation::EqualTo, nullptr, 
-                          BoxAttribute::NoAttribute, 
-                          0.f, mContentWidth, 1)); 
-    mAddedWidthConstraint = true;
-  }
-}
-
-void ImageView::UpdateHeightConstraint() {
-  if (!mAddedHeightConstraint) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Height, 
-                           Relation::EqualTo, nullptr, 
-                           BoxAttribute::NoAttribute, 
-                           0.f, mContentHeight, 1)); 
-    mAddedHeightConstraint = true;
-  }
+  UpdateIntrinsicSizeConstraints();
 }
 
 void ImageView::draw() {
@@ -89,12 +69,14 @@ void ImageView::InjectInputEvent(const InputEvent& e) {
       if (mScrollable && mContentHeight > GetHeight()) {
         mContentOffsetY += e.velocityY;
         mContentOffsetY = std::clamp<int>(mContentOffsetY, 0, mContentHeight - GetHeight());
+        InvalidateDraw();
       }
       break;
     case InputType::ScrollHorizontal:
       if (mScrollable && mContentWidth > GetWidth()) {
         mContentOffsetX += e.velocityX;
         mContentOffsetX = std::clamp<int>(mContentOffsetX, 0, mContentWidth - GetWidth());
+        InvalidateDraw();
       }
       break;
      default:
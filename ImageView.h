@@ -23,15 +23,10 @@ class ImageView : public View {
    void InjectInputEvent(const InputEvent& e) override;
 
   private:
-   void UpdateWidthConstraint();
-   void UpdateHeightConstraint();
-    
     std::string mURI;
     bool mScrollable;
     uint32_t mContentOffsetX{0}; // Scroll Offset X 
     uint32_t mContentOffsetY{0}; // Scroll Offset Y
     ImageId_t mImageResource;
-    bool mAddedHeightConstraint{false};
-    bool mAddedWidthConstraint{false};
 };
 
@@ -0,0 +1,52 @@
+#include "LayoutCache.h"
+
+#include <utility>
+
+void LayoutCache::SetCapacity(size_t capacity) {
+  mCapacity = capacity;
+  EvictToCapacity();
+}
+
+const std::vector<LayoutRect>* LayoutCache::Find(int width, int height, uint64_t version) {
+  if (mCapacity == 0) {
+    return nullptr;
+  }
+  auto iter = mIndex.find({ width, height, version });
+  if (iter == mIndex.end()) {
+    mMisses++;
+    return nullptr;
+  }
+  mHits++;
+  mEntries.splice(mEntries.begin(), mEntries, iter->second);
+  return &iter->second->rects;
+}
+
+const std::vector<LayoutRect>* LayoutCache::Insert(int width, int height, uint64_t version,
+                                                   std::vector<LayoutRect> rects) {
+  if (mCapacity == 0) {
+    return nullptr;
+  }
+  const Key key = { width, height, version };
+  auto iter = mIndex.find(key);
+  if (iter != mIndex.end()) {
+    iter->second->rects = std::move(rects);
+    mEntries.splice(mEntries.begin(), mEntries, iter->second);
+    return &iter->second->rects;
+  }
+  mEntries.push_front({ key, std::move(rects) });
+  mIndex[key] = mEntries.begin();
+  EvictToCapacity();
+  return &mEntries.front().rects;
+}
+
+void LayoutCache::Clear() {
+  mEntries.clear();
+  mIndex.clear();
+}
+
+void LayoutCache::EvictToCapacity() {
+  while (mEntries.size() > mCapacity) {
+    mIndex.erase(mEntries.back().key);
+    mEntries.pop_back();
+  }
+}
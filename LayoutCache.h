@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "ParametricLayout.h"
+
+// Bounded LRU cache of solved layouts.
+//
+// Maps (window width, window height, Tableau2::GetVersion()) to the rect of
+// every View, indexed like the rects of WindowRoot's ParametricLayout.
+// Dragging a window edge back and forth then re-solves each size once.
+// Any constraint change other than the window size bumps the version, so
+// stale entries simply stop matching and age out.
+class LayoutCache {
+ public:
+  // A capacity of 0 disables the cache.
+  explicit LayoutCache(size_t capacity = 0) : mCapacity(capacity) {}
+
+  void SetCapacity(size_t capacity);
+  size_t GetCapacity() const { return mCapacity; }
+  size_t GetSize() const { return mEntries.size(); }
+
+  // nullptr on a miss. Valid until the next Insert().
+  const std::vector<LayoutRect>* Find(int width, int height, uint64_t version);
+
+  // Evicts the least recently used entry when full.
+  const std::vector<LayoutRect>* Insert(int width, int height, uint64_t version,
+                                        std::vector<LayoutRect> rects);
+
+  void Clear();
+
+  size_t GetHitCount() const { return mHits; }
+  size_t GetMissCount() const { return mMisses; }
+
+ private:
+  struct Key {
+    int width;
+    int height;
+    uint64_t version;
+
+    bool operator==(const Key& other) const {
+      return width == other.width && height == other.height && version == other.version;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t h = std::hash<uint64_t>{}(key.version);
+      h = h * 31 + std::hash<int>{}(key.width);
+      h = h * 31 + std::hash<int>{}(key.height);
+      return h;
+    }
+  };
+
+  struct Entry {
+    Key key;
+    std::vector<LayoutRect> rects;
+  };
+
+  void EvictToCapacity();
+
+  size_t mCapacity;
+  std::list<Entry> mEntries; // Most recently used first.
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mIndex;
+  size_t mHits = 0;
+  size_t mMisses = 0;
+};
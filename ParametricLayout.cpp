@@ -0,0 +1,115 @@
+#include "ParametricLayout.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// Same slack as ApproxEq(), so sizes right on a region's edge still match.
+constexpr double kEpsilon = 1e-6;
+
+// Converts an affine term relative to (width, height) into an absolute one.
+void AppendAbsolute(const std::vector<double>& relative, size_t count,
+                    int width, int height, std::vector<double>& out) {
+  for (size_t i=0; i<count; i++) {
+    const double* term = &relative[i * 3];
+    out.push_back(term[0] - term[1] * width - term[2] * height);
+    out.push_back(term[1]);
+    out.push_back(term[2]);
+  }
+}
+
+// min, min + step, ..., always ending on max.
+std::vector<int> GridSamples(int min, int max, int step) {
+  std::vector<int> samples;
+  for (int v=min; v<max; v+=step) {
+    samples.push_back(v);
+  }
+  samples.push_back(max);
+  return samples;
+}
+
+} // namespace
+
+size_t ParametricLayout::AddRect(const Variable& left, const Variable& top,
+                                 const Variable& width, const Variable& height) {
+  const size_t index = GetRectCount();
+  mOutputs.push_back(left);
+  mOutputs.push_back(top);
+  mOutputs.push_back(width);
+  mOutputs.push_back(height);
+  mCompiled = false;
+  return index;
+}
+
+void ParametricLayout::Clear() {
+  mRegions.clear();
+  mLastRegion = 0;
+  mCompiled = false;
+}
+
+void ParametricLayout::Compile(Tableau2& tableau,
+                               const std::vector<Variable>& widthEdits,
+                               const std::vector<Variable>& heightEdits,
+                               const std::function<void(int, int)>& setSize,
+                               int minWidth, int maxWidth,
+                               int minHeight, int maxHeight, int step) {
+  assert(step > 0 && "ParametricLayout: step must be positive");
+  Clear();
+  const std::vector<std::vector<Variable>> inputs = { widthEdits, heightEdits };
+  for (int h : GridSamples(minHeight, maxHeight, step)) {
+    for (int w : GridSamples(minWidth, maxWidth, step)) {
+      if (FindRegion(w, h) != npos) {
+        continue;
+      }
+      setSize(w, h);
+      const AffineSolution solution = tableau.GetAffineSolution(inputs, mOutputs);
+      Region region;
+      AppendAbsolute(solution.outputs, mOutputs.size(), w, h, region.outputs);
+      AppendAbsolute(solution.bounds, solution.bounds.size() / 3, w, h, region.bounds);
+      mRegions.push_back(std::move(region));
+    }
+  }
+  mVersion = tableau.GetVersion();
+  mCompiled = true;
+}
+
+bool ParametricLayout::Contains(const Region& region, int width, int height) const {
+  for (size_t i=0; i<region.bounds.size(); i+=3) {
+    const double* bound = &region.bounds[i];
+    if (bound[0] + bound[1] * width + bound[2] * height < -kEpsilon) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t ParametricLayout::FindRegion(int width, int height) const {
+  // Resizes are continuous, so the last hit is the likely one.
+  if (mLastRegion < mRegions.size() && Contains(mRegions[mLastRegion], width, height)) {
+    return mLastRegion;
+  }
+  for (size_t i=0; i<mRegions.size(); i++) {
+    if (Contains(mRegions[i], width, height)) {
+      mLastRegion = i;
+      return i;
+    }
+  }
+  return npos;
+}
+
+double ParametricLayout::Evaluate(const Region& region, size_t output, int width, int height) const {
+  const double* term = &region.outputs[output * 3];
+  return term[0] + term[1] * width + term[2] * height;
+}
+
+LayoutRect ParametricLayout::GetRect(size_t region, size_t rect, int width, int height) const {
+  assert(region < mRegions.size() && rect < GetRectCount() && "ParametricLayout: Out of range");
+  const Region& r = mRegions[region];
+  LayoutRect result;
+  result.left = ToPixel(Evaluate(r, rect * 4 + 0, width, height));
+  result.top = ToPixel(Evaluate(r, rect * 4 + 1, width, height));
+  result.width = ToPixel(Evaluate(r, rect * 4 + 2, width, height));
+  result.height = ToPixel(Evaluate(r, rect * 4 + 3, width, height));
+  return result;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "Expression.h"
+
+// Pixel rect of a Box, as handed to View::layout().
+struct LayoutRect {
+  int left = 0;
+  int top = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Rounds down to a pixel. The solver's own variables are never negative,
+// so for a live solve this is the truncation it always used. Negative
+// offsets, eg: from a compiled layout, round down too rather than toward
+// zero, so every rect stays on the same pixel grid. Values a hair below a
+// whole pixel (float noise) count as that pixel, so the solver and a
+// compiled layout agree.
+inline int ToPixel(double value) {
+  return static_cast<int>(std::floor(value + 1e-6));
+}
+
+// Layout of a static screen compiled into a piecewise-affine function of
+// the window size.
+//
+// Once the content of a screen is fixed, the window width and height are
+// the only inputs the solver sees. Within one optimal basis of the tableau,
+// every variable is an affine function of them, valid over a convex region
+// of (width, height). Compile() sweeps a grid of window sizes, re-solving
+// the tableau only for sizes not covered by a region found so far, and
+// records each region's bounds and affine map.
+//
+// A resize then costs a region lookup plus a small matrix-vector product.
+// Sizes outside every region, and any change to the constraints (tracked
+// through Tableau2::GetVersion()), fall back to the live solver.
+class ParametricLayout {
+ public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  // Returns the rect's index for GetRect().
+  size_t AddRect(const Variable& left, const Variable& top,
+                 const Variable& width, const Variable& height);
+
+  size_t GetRectCount() const {
+    return mOutputs.size() / 4;
+  }
+
+  // 'setSize' must push a window size into 'tableau', through the edit
+  // variables listed in 'widthEdits' and 'heightEdits'. Those must be
+  // input variables of the tableau. (See Tableau2::AddInputVariable())
+  // The tableau is left at the last size explored.
+  void Compile(Tableau2& tableau,
+               const std::vector<Variable>& widthEdits,
+               const std::vector<Variable>& heightEdits,
+               const std::function<void(int, int)>& setSize,
+               int minWidth, int maxWidth,
+               int minHeight, int maxHeight, int step);
+
+  // False once the tableau changed after Compile().
+  bool IsValid(const Tableau2& tableau) const {
+    return mCompiled && mVersion == tableau.GetVersion();
+  }
+
+  void Clear();
+
+  // Region containing (width, height), or npos.
+  size_t FindRegion(int width, int height) const;
+
+  LayoutRect GetRect(size_t region, size_t rect, int width, int height) const;
+
+  size_t GetRegionCount() const {
+    return mRegions.size();
+  }
+
+ private:
+  // Both in terms of absolute window size:
+  //   value = c + w * width + h * height, stored as {c, w, h}.
+  struct Region {
+    std::vector<double> outputs;
+    std::vector<double> bounds; // Inside while every bound is >= 0.
+  };
+
+  bool Contains(const Region& region, int width, int height) const;
+  double Evaluate(const Region& region, size_t output, int width, int height) const;
+
+  std::vector<Variable> mOutputs; // left, top, width, height per rect.
+  std::vector<Region> mRegions;
+  mutable size_t mLastRegion = 0;
+  uint64_t mVersion = 0;
+  bool mCompiled = false;
+};
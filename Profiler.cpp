@@ -0,0 +1,200 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Fields are atomics so that WriteChromeTrace() can read a slot while
+// its thread overwrites it. Relaxed, the ring's counters order them.
+struct Slot {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> begin{0};
+  std::atomic<uint64_t> end{0};
+  std::atomic<int64_t> arg{0};
+};
+
+} // namespace
+
+struct Profiler::Track {
+  uint32_t tid;
+  std::atomic<const char*> name{nullptr};
+  std::array<Slot, Profiler::kZonesPerThread> slots;
+  // Zones are numbered in recording order, zone i lives in
+  // slots[i % kZonesPerThread].
+  std::atomic<uint64_t> started{0}; // Zones whose slot is being written or was.
+  std::atomic<uint64_t> recorded{0}; // Zones whose slot was written.
+  std::atomic<uint64_t> cleared{0}; // Zones before this were dropped by Clear().
+};
+
+namespace {
+
+// Tracks outlive their threads, so that zones of
+// finished threads make it into the trace.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Profiler::Track>> tracks;
+};
+
+// Never destroyed: threads may still record during static destruction.
+Registry& GetRegistry() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+Profiler::Track& GetThreadTrack() {
+  thread_local Profiler::Track* track = nullptr;
+  if (!track) {
+    track = Profiler::AddTrack(nullptr);
+  }
+  return *track;
+}
+
+void WriteJSONString(std::ostream& out, const char* str) {
+  out << '"';
+  for (; *str; str++) {
+    const char c = *str;
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+uint64_t Profiler::Now() {
+  using Clock = std::chrono::steady_clock;
+  static const Clock::time_point epoch = Clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end, int64_t arg) {
+  Record(&GetThreadTrack(), name, begin, end, arg);
+}
+
+Profiler::Track* Profiler::AddTrack(const char* name) {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.tracks.push_back(std::make_unique<Track>());
+  Track* track = registry.tracks.back().get();
+  track->tid = static_cast<uint32_t>(registry.tracks.size());
+  track->name.store(name, std::memory_order_relaxed);
+  return track;
+}
+
+void Profiler::Record(Track* track, const char* name, uint64_t begin, uint64_t end,
+                      int64_t arg) {
+  Track& buffer = *track;
+  // Only one thread writes the counters.
+  const uint64_t idx = buffer.recorded.load(std::memory_order_relaxed);
+  buffer.started.store(idx + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  Slot& slot = buffer.slots[idx % kZonesPerThread];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(begin, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  slot.arg.store(arg, std::memory_order_relaxed);
+  buffer.recorded.store(idx + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) {
+  GetThreadTrack().name.store(name, std::memory_order_relaxed);
+}
+
+void Profiler::Clear() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto& buffer : registry.tracks) {
+    buffer->cleared.store(buffer->recorded.load(std::memory_order_acquire),
+                          std::memory_order_relaxed);
+  }
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out) {
+  struct Event {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    int64_t arg;
+  };
+
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  auto separate = [&]() {
+    if (!first) out << ",";
+    out << "\n";
+    first = false;
+  };
+
+  std::vector<Event> events;
+  for (auto& buffer : registry.tracks) {
+    // Seqlock style: copy, then drop what the thread may have
+    // started overwriting in the meantime.
+    const uint64_t recorded = buffer->recorded.load(std::memory_order_acquire);
+    const uint64_t from = std::max(buffer->cleared.load(std::memory_order_relaxed),
+                             recorded > kZonesPerThread ? recorded - kZonesPerThread : 0);
+    events.clear();
+    for (uint64_t i = from; i < recorded; i++) {
+      const Slot& slot = buffer->slots[i % kZonesPerThread];
+      events.push_back({slot.name.load(std::memory_order_relaxed),
+                        slot.begin.load(std::memory_order_relaxed),
+                        slot.end.load(std::memory_order_relaxed),
+                        slot.arg.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t started = buffer->started.load(std::memory_order_relaxed);
+    if (started > kZonesPerThread && started - kZonesPerThread > from) {
+      const uint64_t overwritten = std::min(started - kZonesPerThread, recorded) - from;
+      events.erase(events.begin(), events.begin() + overwritten);
+    }
+
+    const char* threadName = buffer->name.load(std::memory_order_relaxed);
+    if (threadName) {
+      separate();
+      out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << buffer->tid
+          << ",\"args\":{\"name\":";
+      WriteJSONString(out, threadName);
+      out << "}}";
+    }
+
+    // Complete events, in microseconds.
+    for (const Event& event : events) {
+      separate();
+      out << "{\"ph\":\"X\",\"name\":";
+      WriteJSONString(out, event.name ? event.name : "");
+      out << ",\"pid\":0,\"tid\":" << buffer->tid
+          << ",\"ts\":" << event.begin / 1000 << "." << event.begin % 1000 / 100
+          << ",\"dur\":" << (event.end - event.begin) / 1000 << "."
+          << (event.end - event.begin) % 1000 / 100;
+      if (event.arg != kNoArg) {
+        out << ",\"args\":{\"arg\":" << event.arg << "}";
+      }
+      out << "}";
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Profiler::WriteChromeTrace(const std::string& file) {
+  std::ofstream out(file);
+  if (!out.is_open()) {
+    return false;
+  }
+  WriteChromeTrace(out);
+  return out.good();
+}
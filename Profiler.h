@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Where frame time goes, without attaching a profiler.
+//
+// Code is instrumented with named zones, timed from construction to
+// destruction:
+//
+//   void WindowRoot::SolveLayout() {
+//     PROFILE_ZONE("Solve");
+//     ...
+//
+// Each thread records its zones into a ring buffer of its own, keeping
+// the most recent kZonesPerThread. Recording takes no lock. The zones
+// can be written out at any time as Chrome trace_event JSON, for
+// chrome://tracing or Perfetto.
+//
+// The macros compile to nothing unless ENABLE_PROFILER is defined.
+// (eg: make PROFILER=1)
+class Profiler {
+ public:
+  static constexpr uint32_t kZonesPerThread = 1 << 15; // Power of 2.
+  static constexpr int64_t kNoArg = INT64_MIN;
+
+  // Times its scope. 'name' must outlive the Profiler. (eg: a literal)
+  // 'arg' is shown with the zone, unless kNoArg. (eg: an index)
+  class Zone {
+   public:
+    explicit Zone(const char* name, int64_t arg = kNoArg)
+        : mName(name), mArg(arg), mBegin(Now()) {}
+    ~Zone() { Record(mName, mBegin, Now(), mArg); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+   private:
+    const char* mName;
+    int64_t mArg;
+    uint64_t mBegin;
+  };
+
+  // Nanoseconds since the first call.
+  static uint64_t Now();
+
+  // Records a zone of the calling thread.
+  static void Record(const char* name, uint64_t begin, uint64_t end, int64_t arg = kNoArg);
+
+  // Names the calling thread's track in the trace. 'name' as for Zone.
+  static void SetThreadName(const char* name);
+
+  // A track of zones not timed by a thread's clock, eg: the GPU's.
+  // Zones must already be in Now()'s time base, and be recorded by one
+  // thread at a time. Tracks are never destroyed.
+  struct Track;
+  static Track* AddTrack(const char* name);
+  static void Record(Track* track, const char* name, uint64_t begin, uint64_t end,
+                     int64_t arg = kNoArg);
+
+  // Drops the zones recorded so far, on every thread.
+  static void Clear();
+
+  // Zones still held by the ring buffers, as Chrome trace_event JSON.
+  // Zones overwritten while this runs are left out.
+  static void WriteChromeTrace(std::ostream& out);
+  static bool WriteChromeTrace(const std::string& file);
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) \
+  Profiler::Zone PROFILE_CONCAT(profileZone, __COUNTER__)(name)
+#define PROFILE_ZONE_ARG(name, arg) \
+  Profiler::Zone PROFILE_CONCAT(profileZone, __COUNTER__)(name, static_cast<int64_t>(arg))
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_ZONE_ARG(name, arg) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
@@ -29,10 +29,11 @@ void ScrollableView::layout(int l, int t, int r, int b) {
   //  int lChild = mLeft - mViewportX, tChild = mTop - mViewportY;
   int lowestPoint = std::numeric_limits<int>::min();
   for (auto childView : mChildren) {
-    int lChild = GetTableau().GetResult(childView->GetLeftVar()) - mViewportX;
-    int tChild = GetTableau().GetResult(childView->GetTopVar()) - mViewportY;
-    int rChild = GetTableau().GetResult(childView->GetRightVar()) - mViewportX;
-    int bChild = GetTableau().GetResult(childView->GetBottomVar()) - mViewportY;
+    const LayoutRect rect = mWindow->GetLayoutRect(childView);
+    int lChild = rect.left - mViewportX;
+    int tChild = rect.top - mViewportY;
+    int rChild = rect.left + rect.width - mViewportX;
+    int bChild = rect.top + rect.height - mViewportY;
     childView->layout(lChild, tChild, rChild, bChild);
     lowestPoint = std::max<int>(lowestPoint, bChild + mViewportY);
   }
@@ -49,19 +50,15 @@ void ScrollableView::draw() {
                                    mOutlineRGB[2], 1.f);
   GetGraphics()->DrawOutline(mLeft, mTop, mRight, mBottom);
   
-  Rect originalScissor;
-  GetGraphics()->SetScissor(GetLeft(), GetTop(), 
-                                     GetWidth(), GetHeight(), originalScissor);
+  GetGraphics()->PushScissor(GetLeft(), GetTop(), GetWidth(), GetHeight());
   // Draw Children
   for (auto childView : mChildren) {
     if (childView->IntersectsView(this)) {
-      childView->draw();  
+      childView->DrawCached();
     }
   }
 
-  Rect r;
-  GetGraphics()->UnsetScissor();
-  GetGraphics()->SetScissor(originalScissor, r); // Reset to original.
+  GetGraphics()->PopScissor(); // Reset to original.
 }
 
 // XXX: May need to be adjusted more.
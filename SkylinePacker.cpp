@@ -0,0 +1,75 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+SkylinePacker::SkylinePacker(int width, int height) : mWidth(width), mHeight(height) {
+  assert(width > 0 && height > 0 && "Page must not be empty");
+  mSkyline.push_back({0, 0, width});
+}
+
+int SkylinePacker::Fit(size_t idx, int width, int height) const {
+  const int x = mSkyline[idx].x;
+  if (x + width > mWidth) return -1;
+
+  // Rests on the highest segment it spans.
+  int y = 0;
+  for (int widthLeft = width; widthLeft > 0; idx++) {
+    y = std::max(y, mSkyline[idx].y);
+    if (y + height > mHeight) return -1;
+    widthLeft -= mSkyline[idx].width;
+  }
+  return y;
+}
+
+bool SkylinePacker::Pack(int width, int height, int& x, int& y) {
+  if (width <= 0 || height <= 0) return false;
+
+  size_t bestIdx = mSkyline.size();
+  int bestBottom = std::numeric_limits<int>::max();
+  int bestWidth = std::numeric_limits<int>::max();
+  for (size_t i = 0; i < mSkyline.size(); i++) {
+    const int top = Fit(i, width, height);
+    if (top < 0) continue;
+    // Ties go to the narrower segment, leaving wide ones for wide rects.
+    const int bottom = top + height;
+    if (bottom < bestBottom ||
+        (bottom == bestBottom && mSkyline[i].width < bestWidth)) {
+      bestIdx = i;
+      bestBottom = bottom;
+      bestWidth = mSkyline[i].width;
+    }
+  }
+  if (bestIdx == mSkyline.size()) return false;
+
+  x = mSkyline[bestIdx].x;
+  y = bestBottom - height;
+
+  // The rect's bottom edge replaces the segments under it.
+  mSkyline.insert(mSkyline.begin() + bestIdx, {x, bestBottom, width});
+  const int right = x + width;
+  size_t next = bestIdx + 1;
+  while (next < mSkyline.size() && mSkyline[next].x < right) {
+    Segment& segment = mSkyline[next];
+    const int segmentRight = segment.x + segment.width;
+    if (segmentRight <= right) {
+      mSkyline.erase(mSkyline.begin() + next);
+    } else {
+      segment.width = segmentRight - right;
+      segment.x = right;
+      break;
+    }
+  }
+
+  // Merge neighbours at the same height.
+  for (size_t i = 0; i + 1 < mSkyline.size();) {
+    if (mSkyline[i].y == mSkyline[i + 1].y) {
+      mSkyline[i].width += mSkyline[i + 1].width;
+      mSkyline.erase(mSkyline.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+  return true;
+}
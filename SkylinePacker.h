@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Packs rects into a fixed size page, for texture atlases.
+//
+// Keeps the skyline: the bottom edge of everything placed so far, as
+// horizontal segments spanning the page's width. Each rect is placed on
+// the skyline where its bottom ends up highest, which keeps the space
+// left under the skyline (and so wasted) small without tracking it.
+class SkylinePacker {
+ public:
+  SkylinePacker(int width, int height);
+
+  // Finds room for a 'width' x 'height' rect and returns its top left
+  // in 'x', 'y'. Returns false if the page has no room left for it.
+  bool Pack(int width, int height, int& x, int& y);
+
+  int GetWidth() const { return mWidth; }
+  int GetHeight() const { return mHeight; }
+
+ private:
+  struct Segment {
+    int x;
+    int y; // First free row above [x, x + width).
+    int width;
+  };
+
+  // Row a 'width' wide rect would be placed at, starting at segment
+  // 'idx'. -1 if it would cross the right or bottom edge of the page.
+  int Fit(size_t idx, int width, int height) const;
+
+  int mWidth;
+  int mHeight;
+  std::vector<Segment> mSkyline; // Ordered by x, without gaps.
+};
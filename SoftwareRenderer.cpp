@@ -0,0 +1,352 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "Profiler.h"
+#include "WorkerPool.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2 1
+#endif
+
+namespace {
+
+// Linear color, alpha last. Lanes of one register where there's SSE2.
+#ifdef SOFTWARE_RENDERER_SSE2
+using Vec4 = __m128;
+
+inline Vec4 MakeVec4(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+inline Vec4 Lerp(Vec4 a, Vec4 b, float t) {
+  return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+// Fixed point in [0, 4095], rounded.
+inline void ToFixed(Vec4 v, int32_t out[4]) {
+  const __m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                   _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(4095.0f))));
+}
+#else
+struct Vec4 {
+  float v[4];
+};
+
+inline Vec4 MakeVec4(float r, float g, float b, float a) { return {{r, g, b, a}}; }
+inline Vec4 Lerp(Vec4 a, Vec4 b, float t) {
+  Vec4 out;
+  for (int i = 0; i < 4; i++) out.v[i] = a.v[i] + (b.v[i] - a.v[i]) * t;
+  return out;
+}
+inline void ToFixed(Vec4 v, int32_t out[4]) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = static_cast<int32_t>(std::lround(std::clamp(v.v[i], 0.0f, 1.0f) * 4095.0f));
+  }
+}
+#endif
+
+// sRGB transfer function, both ways. Encoding goes through 12 bits
+// of linear precision, which is plenty for 8 bit sRGB.
+struct SRGBTables {
+  float decode[256];
+  uint8_t encode[4096];
+
+  SRGBTables() {
+    for (int i = 0; i < 256; i++) {
+      const float c = i / 255.0f;
+      decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < 4096; i++) {
+      const float c = i / 4095.0f;
+      const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+      encode[i] = static_cast<uint8_t>(std::lround(s * 255.0f));
+    }
+  }
+};
+
+const SRGBTables& GetSRGBTables() {
+  static const SRGBTables tables;
+  return tables;
+}
+
+// Color and alpha as the GPU writes them to a _SRGB attachment.
+uint32_t Pack(Vec4 color) {
+  const SRGBTables& srgb = GetSRGBTables();
+  int32_t fixed[4];
+  ToFixed(color, fixed);
+  const uint8_t bytes[4] = {srgb.encode[fixed[0]], srgb.encode[fixed[1]], srgb.encode[fixed[2]],
+                            static_cast<uint8_t>((fixed[3] * 255 + 2047) / 4095)}; // Alpha is linear.
+  uint32_t pixel;
+  memcpy(&pixel, bytes, sizeof(pixel));
+  return pixel;
+}
+
+Vec4 Unpack(uint32_t pixel) {
+  const SRGBTables& srgb = GetSRGBTables();
+  uint8_t bytes[4];
+  memcpy(bytes, &pixel, sizeof(bytes));
+  return MakeVec4(srgb.decode[bytes[0]], srgb.decode[bytes[1]], srgb.decode[bytes[2]],
+                  bytes[3] / 255.0f);
+}
+
+// Blend factors of the Textured and Text Pipelines: SRC_ALPHA,
+// ONE_MINUS_SRC_ALPHA for color, and the source's alpha kept as is.
+uint32_t Blend(uint32_t dst, Vec4 src, float srcAlpha) {
+  Vec4 out = Lerp(Unpack(dst), src, srcAlpha);
+#ifdef SOFTWARE_RENDERER_SSE2
+  // Alpha lane from 'src'.
+  const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  out = _mm_or_ps(_mm_andnot_ps(alphaMask, out), _mm_and_ps(alphaMask, src));
+#else
+  out.v[3] = src.v[3];
+#endif
+  return Pack(out);
+}
+
+void FillSpan(uint32_t* dst, size_t count, uint32_t pixel) {
+  size_t i = 0;
+#ifdef SOFTWARE_RENDERER_SSE2
+  const __m128i pixels = _mm_set1_epi32(static_cast<int32_t>(pixel));
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pixels);
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = pixel;
+  }
+}
+
+// Bilinear, repeating. 'u' and 'v' in Normalized Coordinates.
+Vec4 Sample(const uint8_t* pixels, int width, int height, float u, float v) {
+  const SRGBTables& srgb = GetSRGBTables();
+  const float x = u * width - 0.5f;
+  const float y = v * height - 0.5f;
+  const float x0 = std::floor(x);
+  const float y0 = std::floor(y);
+  const float fx = x - x0;
+  const float fy = y - y0;
+
+  auto wrap = [](int i, int size) {
+    i %= size;
+    return i < 0 ? i + size : i;
+  };
+  const int left = wrap(static_cast<int>(x0), width);
+  const int right = wrap(left + 1, width);
+  const int top = wrap(static_cast<int>(y0), height);
+  const int bottom = wrap(top + 1, height);
+
+  auto texel = [&](int tx, int ty) {
+    const uint8_t* p = pixels + (static_cast<size_t>(ty) * width + tx) * 4;
+    return MakeVec4(srgb.decode[p[0]], srgb.decode[p[1]], srgb.decode[p[2]], p[3] / 255.0f);
+  };
+  return Lerp(Lerp(texel(left, top), texel(right, top), fx),
+              Lerp(texel(left, bottom), texel(right, bottom), fx), fy);
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(int width, int height) {
+  Resize(width, height);
+}
+
+void SoftwareRenderer::Resize(int width, int height) {
+  assert(width >= 0 && height >= 0);
+  mWidth = width;
+  mHeight = height;
+  mPixels.assign(static_cast<size_t>(width) * height, 0);
+}
+
+void SoftwareRenderer::SetImage(int32_t imageId, const uint8_t* pixels, int width, int height) {
+  Texture& texture = mImages[imageId];
+  texture.width = width;
+  texture.height = height;
+  texture.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+}
+
+void SoftwareRenderer::SetFont(int32_t fontId, const GlyphTable& glyphs,
+                               const uint8_t* atlas, int width, int height) {
+  Font& font = mFonts[fontId];
+  font.glyphs = glyphs;
+  font.atlas.width = width;
+  font.atlas.height = height;
+  font.atlas.pixels.assign(atlas, atlas + static_cast<size_t>(width) * height);
+}
+
+void SoftwareRenderer::Draw(const DisplayList& list, const ClipRect& root, WorkerPool* pool) {
+  const ClipRect target = root.Intersect({0, 0, mWidth, mHeight});
+  if (target.IsEmpty()) return;
+
+  // Scissors resolved, in issue order: tiles don't batch.
+  mList = &list;
+  list.Order(target, mItems, 0);
+
+  mTileColumns = (mWidth + kTileSize - 1) / kTileSize;
+  const int tileRows = (mHeight + kTileSize - 1) / kTileSize;
+  mTileItems.resize(static_cast<size_t>(mTileColumns) * tileRows);
+  for (std::vector<uint32_t>& items : mTileItems) {
+    items.clear();
+  }
+  for (uint32_t i = 0; i < mItems.size(); i++) {
+    const DrawOp& op = list.GetOps()[mItems[i].opIdx];
+    const ClipRect visible = op.bounds.Intersect(mItems[i].scissor);
+    for (int row = visible.top / kTileSize; row <= (visible.bottom - 1) / kTileSize; row++) {
+      for (int column = visible.left / kTileSize;
+           column <= (visible.right - 1) / kTileSize; column++) {
+        mTileItems[static_cast<size_t>(row) * mTileColumns + column].push_back(i);
+      }
+    }
+  }
+
+  WorkerPool& workers = pool ? *pool : WorkerPool::GetShared();
+  workers.Dispatch(mTileItems.size(), [this](size_t tileIdx) { DrawTile(tileIdx); });
+  workers.Wait();
+  mList = nullptr;
+}
+
+void SoftwareRenderer::DrawTile(size_t tileIdx) {
+  PROFILE_ZONE_ARG("Draw Tile", tileIdx);
+  const int left = static_cast<int>(tileIdx % mTileColumns) * kTileSize;
+  const int top = static_cast<int>(tileIdx / mTileColumns) * kTileSize;
+  const ClipRect tile{left, top, std::min(left + kTileSize, mWidth),
+                      std::min(top + kTileSize, mHeight)};
+
+  for (uint32_t itemIdx : mTileItems[tileIdx]) {
+    const DisplayList::Item& item = mItems[itemIdx];
+    const DrawOp& op = mList->GetOps()[item.opIdx];
+    const ClipRect clip = op.bounds.Intersect(item.scissor).Intersect(tile);
+    if (clip.IsEmpty()) continue;
+
+    switch (op.type) {
+      case DrawOpType::Rect:
+        DrawRect(op.bounds, op.rgba, clip);
+        break;
+      case DrawOpType::Outline:
+        DrawOutline(op, clip);
+        break;
+      case DrawOpType::TexturedRect:
+        DrawTexturedRect(op, clip);
+        break;
+      case DrawOpType::Text:
+        DrawText(op, clip);
+        break;
+      default:
+        break; // Scissors are resolved by DisplayList::Order()
+    }
+  }
+}
+
+void SoftwareRenderer::DrawRect(const ClipRect& rect, const float rgba[4],
+                                const ClipRect& clip) {
+  // The Flat and Line Pipelines don't blend.
+  const ClipRect area = rect.Intersect(clip);
+  if (area.IsEmpty()) return;
+  const uint32_t pixel = Pack(MakeVec4(rgba[0], rgba[1], rgba[2], rgba[3]));
+  for (int y = area.top; y < area.bottom; y++) {
+    FillSpan(&mPixels[static_cast<size_t>(y) * mWidth + area.left],
+             area.right - area.left, pixel);
+  }
+}
+
+void SoftwareRenderer::DrawOutline(const DrawOp& op, const ClipRect& clip) {
+  ClipRect rect; // Unpadded. (See DisplayList::AddOutline)
+  memcpy(&rect, op.payload, sizeof(ClipRect));
+
+  // Lines are centered on the edges, right and bottom included.
+  const int width = std::max(1, static_cast<int>(std::lround(op.lineWidth)));
+  const int before = width / 2;
+  const int after = width - before;
+  DrawRect({rect.left - before, rect.top - before, rect.right + after, rect.top + after},
+           op.rgba, clip);
+  DrawRect({rect.left - before, rect.bottom - before, rect.right + after, rect.bottom + after},
+           op.rgba, clip);
+  DrawRect({rect.left - before, rect.top - before, rect.left + after, rect.bottom + after},
+           op.rgba, clip);
+  DrawRect({rect.right - before, rect.top - before, rect.right + after, rect.bottom + after},
+           op.rgba, clip);
+}
+
+void SoftwareRenderer::DrawTexturedRect(const DrawOp& op, const ClipRect& clip) {
+  auto image = mImages.find(op.resourceId);
+  if (image == mImages.end()) return;
+  const Texture& texture = image->second;
+  if (texture.width == 0 || texture.height == 0) return;
+
+  // Top Left, Top Right, Bottom Right, Bottom Left.
+  float uv[8];
+  memcpy(uv, op.payload, sizeof(uv));
+
+  const float width = static_cast<float>(op.bounds.right - op.bounds.left);
+  const float height = static_cast<float>(op.bounds.bottom - op.bounds.top);
+  for (int y = clip.top; y < clip.bottom; y++) {
+    // Sampled at pixel centers, like the rasterizer.
+    const float t = (y + 0.5f - op.bounds.top) / height;
+    uint32_t* row = &mPixels[static_cast<size_t>(y) * mWidth];
+    for (int x = clip.left; x < clip.right; x++) {
+      const float s = (x + 0.5f - op.bounds.left) / width;
+      const float topU = uv[0] + (uv[2] - uv[0]) * s;
+      const float topV = uv[1] + (uv[3] - uv[1]) * s;
+      const float bottomU = uv[6] + (uv[4] - uv[6]) * s;
+      const float bottomV = uv[7] + (uv[5] - uv[7]) * s;
+      const Vec4 texel = Sample(texture.pixels.data(), texture.width, texture.height,
+                                topU + (bottomU - topU) * t, topV + (bottomV - topV) * t);
+      float rgba[4];
+      memcpy(rgba, &texel, sizeof(rgba));
+      row[x] = Blend(row[x], texel, rgba[3]);
+    }
+  }
+}
+
+void SoftwareRenderer::DrawText(const DrawOp& op, const ClipRect& clip) {
+  auto fontIt = mFonts.find(op.resourceId);
+  if (fontIt == mFonts.end()) return;
+  const Font& font = fontIt->second;
+  const Texture& atlas = font.atlas;
+
+  // Text takes its alpha from the atlas. (See shaderText.frag)
+  const Vec4 color = MakeVec4(op.rgba[0], op.rgba[1], op.rgba[2], 1.0f);
+  const uint32_t opaque = Pack(color);
+
+  const char* str = static_cast<const char*>(op.payload);
+  int32_t l = op.baselineX;
+  for (uint32_t i = 0; i < op.payloadSize; i++) {
+    const unsigned char c = str[i];
+    if (c >= font.glyphs.size() || !font.glyphs[c].present) {
+      continue;
+    }
+    const GlyphQuad& glyph = font.glyphs[c];
+    const ClipRect quad{l, op.baselineY - glyph.baselineYOffset,
+                        l + glyph.width, op.baselineY - glyph.baselineYOffset + glyph.height};
+    l += glyph.horizontalAdvance;
+    const ClipRect area = quad.Intersect(clip);
+    if (area.IsEmpty()) continue;
+
+    // Quads are the size of the glyph, so each pixel is one texel.
+    const int atlasLeft = (glyph.atlasRect[0] * atlas.width + 0x7FFF) / 0xFFFF;
+    const int atlasTop = (glyph.atlasRect[1] * atlas.height + 0x7FFF) / 0xFFFF;
+    for (int y = area.top; y < area.bottom; y++) {
+      const int atlasY = atlasTop + (y - quad.top);
+      if (atlasY < 0 || atlasY >= atlas.height) continue;
+      const uint8_t* coverage = &atlas.pixels[static_cast<size_t>(atlasY) * atlas.width];
+      uint32_t* row = &mPixels[static_cast<size_t>(y) * mWidth];
+      for (int x = area.left; x < area.right; x++) {
+        const int atlasX = atlasLeft + (x - quad.left);
+        if (atlasX < 0 || atlasX >= atlas.width) continue;
+        const uint8_t alpha = coverage[atlasX];
+        if (alpha == 0) {
+          // Blends nothing in, but writes the source's alpha.
+          uint8_t bytes[4];
+          memcpy(bytes, &row[x], sizeof(bytes));
+          bytes[3] = 0;
+          memcpy(&row[x], bytes, sizeof(bytes));
+        } else if (alpha == 255) {
+          row[x] = opaque;
+        } else {
+          const float a = alpha / 255.0f;
+          row[x] = Blend(row[x], MakeVec4(op.rgba[0], op.rgba[1], op.rgba[2], a), a);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "DisplayList.h"
+#include "Glyph.h"
+
+class WorkerPool;
+
+// Draws DisplayLists into RGBA pixels on the CPU, without Vulkan.
+// Reference rasterizer for pixel tests and benchmarks, not a backend:
+// Views and WindowRoot only draw through Graphics2D, and their fonts and
+// images are loaded onto the GPU. To compare, replay a frame's
+// Graphics2D::GetDisplayList() here, with the same images and fonts set.
+//
+// Gives the pixels Graphics2D does: the target is sRGB, so colors are
+// encoded when written, and TexturedRects and Text blend in linear
+// space, as the GPU does with _SRGB formats. Images are sampled
+// bilinearly, repeating.
+//
+// The target is split into tiles of kTileSize x kTileSize, drawn in
+// parallel. Each tile draws the ops overlapping it, in issue order.
+class SoftwareRenderer {
+ public:
+  static constexpr int kTileSize = 64;
+
+  SoftwareRenderer(int width, int height);
+
+  SoftwareRenderer(const SoftwareRenderer&) = delete;
+  SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+  // Pixels are undefined until drawn whole.
+  void Resize(int width, int height);
+
+  // Textures, looked up by the resourceId of the ops drawing them.
+  // 'pixels' are copied.
+
+  // RGBA, 4 bytes per pixel, sRGB. The ImageId_t of TexturedRects.
+  void SetImage(int32_t imageId, const uint8_t* pixels, int width, int height);
+
+  // 'atlas' holds 1 byte of coverage per pixel, the glyphs are laid out
+  // in it as 'glyphs' says. The FontId_t of Text runs.
+  void SetFont(int32_t fontId, const GlyphTable& glyphs,
+               const uint8_t* atlas, int width, int height);
+
+  // Draws 'list' inside 'root'. Pixels outside of it keep what they
+  // held. (See Graphics2D::SetDamage)
+  // Tiles are drawn on 'pool', WorkerPool::GetShared() if null.
+  void Draw(const DisplayList& list, const ClipRect& root, WorkerPool* pool = nullptr);
+
+  int GetWidth() const { return mWidth; }
+  int GetHeight() const { return mHeight; }
+
+  // 4 bytes per pixel, row by row.
+  const uint8_t* GetPixels() const {
+    return reinterpret_cast<const uint8_t*>(mPixels.data());
+  }
+
+ private:
+  struct Texture {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+  };
+
+  struct Font {
+    GlyphTable glyphs;
+    Texture atlas;
+  };
+
+  void DrawTile(size_t tileIdx);
+  // Draws 'op', limited to 'clip'.
+  void DrawRect(const ClipRect& rect, const float rgba[4], const ClipRect& clip);
+  void DrawOutline(const DrawOp& op, const ClipRect& clip);
+  void DrawTexturedRect(const DrawOp& op, const ClipRect& clip);
+  void DrawText(const DrawOp& op, const ClipRect& clip);
+
+  int mWidth;
+  int mHeight;
+  std::vector<uint32_t> mPixels; // RGBA bytes, in memory order.
+  std::unordered_map<int32_t, Texture> mImages;
+  std::unordered_map<int32_t, Font> mFonts;
+
+  // Of the Draw() in progress.
+  const DisplayList* mList = nullptr;
+  std::vector<DisplayList::Item> mItems;
+  std::vector<std::vector<uint32_t>> mTileItems; // Into mItems, per tile.
+  int mTileColumns = 0;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+#include "Expression.h"
+#include "ParametricLayout.h"
+
+// Compile-time solver for fully static sub-layouts.
+//
+// A panel whose constraints are all required equalities with constants
+// known at compile time has exactly one solution, independent of the
+// window. StaticLayout solves such a system with constexpr Gauss-Jordan
+// elimination, so the rects are baked into the binary and the panel's
+// Views never enter the Tableau2. (See View::SetStaticRect())
+//
+// Each box has four unknowns, Left, Top, Width and Height. Right, Bottom,
+// CenterX and CenterY are derived from those, same as in Tableau2.
+//
+//   constexpr auto kToolbar = StaticLayout<2, 8>()
+//       .Add(0, BoxAttribute::Left, 0).Add(0, BoxAttribute::Top, 0)
+//       .Add(0, BoxAttribute::Width, 32).Add(0, BoxAttribute::Height, 32)
+//       .Add(1, BoxAttribute::Left, 0, BoxAttribute::Right, 1.0, 4)
+//       ...
+//       .Solve();
+//
+// Under-determined or inconsistent systems throw, which turns into a
+// compile error when evaluated in a constant expression.
+template<size_t Boxes, size_t MaxConstraints>
+class StaticLayout {
+ public:
+  static constexpr size_t kUnknowns = Boxes * 4;
+
+  constexpr StaticLayout() : mRows{}, mRowCount(0) {}
+
+  // box.attribute = constant
+  constexpr StaticLayout& Add(size_t box, BoxAttribute attribute, double constant) {
+    Row& row = NextRow();
+    AddTerm(row, box, attribute, 1.0);
+    row[kUnknowns] = constant;
+    return *this;
+  }
+
+  // box.attribute = multiplier * otherBox.otherAttribute + constant
+  constexpr StaticLayout& Add(size_t box, BoxAttribute attribute,
+                              size_t otherBox, BoxAttribute otherAttribute,
+                              double multiplier = 1.0, double constant = 0.0) {
+    Row& row = NextRow();
+    AddTerm(row, box, attribute, 1.0);
+    AddTerm(row, otherBox, otherAttribute, -multiplier);
+    row[kUnknowns] = constant;
+    return *this;
+  }
+
+  // Rects in window coordinates, rounded down like ToPixel().
+  constexpr std::array<LayoutRect, Boxes> Solve() const {
+    std::array<Row, MaxConstraints> m = mRows;
+    size_t rank = 0;
+    for (size_t col=0; col<kUnknowns; col++) {
+      // Partial pivoting.
+      size_t pivot = rank;
+      double best = 0.0;
+      for (size_t r=rank; r<mRowCount; r++) {
+        if (Abs(m[r][col]) > best) {
+          best = Abs(m[r][col]);
+          pivot = r;
+        }
+      }
+      if (best < kEpsilon) {
+        throw std::runtime_error("StaticLayout: Under-determined layout");
+      }
+      for (size_t c=0; c<=kUnknowns; c++) {
+        const double tmp = m[rank][c];
+        m[rank][c] = m[pivot][c];
+        m[pivot][c] = tmp;
+      }
+
+      const double scale = 1.0 / m[rank][col];
+      for (size_t c=0; c<=kUnknowns; c++) {
+        m[rank][c] *= scale;
+      }
+      for (size_t r=0; r<mRowCount; r++) {
+        const double factor = m[r][col];
+        if (r == rank || factor == 0.0) continue;
+        for (size_t c=0; c<=kUnknowns; c++) {
+          m[r][c] -= factor * m[rank][c];
+        }
+      }
+      rank++;
+    }
+    // Whatever is left over must have reduced to 0 = 0.
+    for (size_t r=rank; r<mRowCount; r++) {
+      if (Abs(m[r][kUnknowns]) > kEpsilon) {
+        throw std::runtime_error("StaticLayout: Inconsistent layout");
+      }
+    }
+
+    // Row i now reads: unknown i = constant.
+    std::array<LayoutRect, Boxes> rects{};
+    for (size_t b=0; b<Boxes; b++) {
+      rects[b].left = Pixel(m[b * 4 + 0][kUnknowns]);
+      rects[b].top = Pixel(m[b * 4 + 1][kUnknowns]);
+      rects[b].width = Pixel(m[b * 4 + 2][kUnknowns]);
+      rects[b].height = Pixel(m[b * 4 + 3][kUnknowns]);
+    }
+    return rects;
+  }
+
+ private:
+  using Row = std::array<double, kUnknowns + 1>; // Unknowns, then constant.
+
+  static constexpr double kEpsilon = 1e-9;
+
+  static constexpr double Abs(double v) {
+    return v < 0.0 ? -v : v;
+  }
+
+  // constexpr version of ToPixel(), std::floor() isn't constexpr.
+  static constexpr int Pixel(double v) {
+    const double shifted = v + 1e-6;
+    const int truncated = static_cast<int>(shifted);
+    return (shifted < truncated) ? truncated - 1 : truncated;
+  }
+
+  constexpr Row& NextRow() {
+    if (mRowCount == MaxConstraints) {
+      throw std::runtime_error("StaticLayout: Too many constraints");
+    }
+    return mRows[mRowCount++];
+  }
+
+  static constexpr void AddTerm(Row& row, size_t box, BoxAttribute attribute, double coeff) {
+    if (box >= Boxes) {
+      throw std::runtime_error("StaticLayout: Box index out of range");
+    }
+    double* const unknowns = &row[box * 4];
+    switch (attribute) {
+      case BoxAttribute::Left:    unknowns[0] += coeff; break;
+      case BoxAttribute::Top:     unknowns[1] += coeff; break;
+      case BoxAttribute::Width:   unknowns[2] += coeff; break;
+      case BoxAttribute::Height:  unknowns[3] += coeff; break;
+      case BoxAttribute::Right:   unknowns[0] += coeff; unknowns[2] += coeff; break;
+      case BoxAttribute::Bottom:  unknowns[1] += coeff; unknowns[3] += coeff; break;
+      case BoxAttribute::CenterX: unknowns[0] += coeff; unknowns[2] += coeff * 0.5; break;
+      case BoxAttribute::CenterY: unknowns[1] += coeff; unknowns[3] += coeff * 0.5; break;
+      default:
+        throw std::runtime_error("StaticLayout: Constraint needs an attribute");
+    }
+  }
+
+  std::array<Row, MaxConstraints> mRows;
+  size_t mRowCount;
+};
@@ -11,16 +11,19 @@ TextView::TextView(WindowRoot* const window,
                           mTextRGB({1.f, 1.f, 1.f}) {
   mFontResources = GetGraphics()->AddFont(mUriTypeface, 
                                                       mFontSize);
+  EnableDrawCache();
 }
 
 void TextView::SetTextRGB(float r, float g, float b) {
   mTextRGB[0] = r;
   mTextRGB[1] = g;
   mTextRGB[2] = b;
+  InvalidateDraw();
 }
 
 void TextView::SetText(const std::string& str) {
   mText = str;
+  InvalidateDraw();
 }
 
 void TextView::measure() {
@@ -48,21 +51,8 @@ void TextView::measure() {
 }
 
 void TextView::UpdateConstraints() {
-  constexpr int ContentConstraintPriority = 1;
-  if (!mMeasuredWidthSet) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Width, 
-                           Relation::EqualTo, nullptr,
-                           BoxAttribute::NoAttribute, 0.f, mContentWidth, 
-                           ContentConstraintPriority));
-  }
-  if (!mMeasuredHeightSet) {
-    mWindow->AddConstraint(new Constraint(this, BoxAttribute::Height, 
-                           Relation::EqualTo, nullptr,
-                           BoxAttribute::NoAttribute, 0.f, mContentHeight, 
-                           ContentConstraintPriority));
-  }
-  mMeasuredWidthSet = true;
-  mMeasuredHeightSet = true;
+  // Text may change between frames (SetText). Intrinsic size follows it.
+  UpdateIntrinsicSizeConstraints();
 }
 
 void TextView::draw() {
@@ -104,13 +94,9 @@ void TextView::draw() {
   baselineX = std::max<int>(GetLeft() + mPadding, baselineX);
   baselineY = std::max<int>(mTop + mPadding, baselineY);
   
-  Rect originalRect;
-  GetGraphics()->SetScissor(GetLeft(), GetTop(), 
-                            GetWidth(), GetHeight(), originalRect);
+  GetGraphics()->PushScissor(GetLeft(), GetTop(), GetWidth(), GetHeight());
   GetGraphics()->SetColor(mTextRGB[0], mTextRGB[1], 
                                    mTextRGB[2], 1.f);
   GetGraphics()->DrawText(mFontResources, mText, baselineX, baselineY);
-  GetGraphics()->UnsetScissor();
-  Rect blah;
-  GetGraphics()->SetScissor(originalRect, blah);
+  GetGraphics()->PopScissor();
 }
@@ -31,9 +31,6 @@ class TextView : public View {
    FontId_t mFontResources{-1};
    std::array<float, 3> mTextRGB;
    
-   bool mMeasuredWidthSet{false};
-   bool mMeasuredHeightSet{false};
-   
    TextAlignment mAlignment;
    int mPadding = 10;
    struct {
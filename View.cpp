@@ -1,6 +1,9 @@
 #include "View.h"
+#include "Image.h"
+#include "Profiler.h"
 
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <sstream>
 
@@ -30,6 +33,12 @@ std::string Box::GenerateVarName(BoxAttribute attribute) const {
     case BoxAttribute::Height:
       stream << "Height";
       break;
+    case BoxAttribute::CenterX:
+      stream << "CenterX";
+      break;
+    case BoxAttribute::CenterY:
+      stream << "CenterY";
+      break;
     default:
       stream << "NoAttribute";
       break;
@@ -48,9 +57,13 @@ View::View(WindowRoot* const window) : mWindow(window),
                                       mOutlineRGB({0.f, 0.f, 0.f}) {
   assert(mWindow && "WindowRoot must be Non-Nullptr to properly construct View object");
   
-  // System-defined Box Constraints
-  window->GetTableau().AddConstraint(GetWidthVar(), Relation::EqualTo, GetRightVar() - GetLeftVar());
-  window->GetTableau().AddConstraint(GetHeightVar(), Relation::EqualTo, GetBottomVar() - GetTopVar());
+  // System-defined Box relations. Right = Left + Width, Bottom = Top + Height, etc.
+  AddDerivedVariables(window->GetTableau());
+  window->AddLayoutBox(this);
+}
+
+View::~View() {
+  mWindow->RemoveLayoutBox(this);
 }
 
 void View::InjectInputEvent(const InputEvent& e) {
@@ -65,6 +78,25 @@ void View::RegisterClickEvent(std::function<void(View*)> onClick) {
   mOnClickEvent = onClick;
 }
 
+void View::DrawCached() {
+  if (!mDrawCache.enabled) {
+    draw();
+    return;
+  }
+
+  const int rect[4] = {mLeft, mTop, mRight, mBottom};
+  if (!mDrawCache.valid || mDrawCache.recordedVersion != mDrawCache.version ||
+      memcmp(mDrawCache.recordedRect, rect, sizeof(rect)) != 0) {
+    GetGraphics()->BeginDisplayList(&mDrawCache.ops);
+    draw();
+    GetGraphics()->EndDisplayList();
+    mDrawCache.valid = true;
+    mDrawCache.recordedVersion = mDrawCache.version;
+    memcpy(mDrawCache.recordedRect, rect, sizeof(rect));
+  }
+  GetGraphics()->DrawDisplayList(mDrawCache.ops);
+}
+
 bool View::HitBy(const InputEvent& e) const {
   return e.pointerX > mLeft && e.pointerX < mRight && 
          e.pointerY > mTop && e.pointerY < mBottom;
@@ -84,6 +116,28 @@ Tableau2& View::GetTableau() {
   return mWindow->GetTableau();
 }
 
+void View::UpdateIntrinsicSizeConstraints() {
+  constexpr int ContentConstraintPriority = 1;
+  if (mHasStaticRect) {
+    return; // Not in the tableau.
+  }
+  Tableau2& tableau = GetTableau();
+  if (!mIntrinsicSizeAdded) {
+    tableau.AddConstraint(GetWidthVar(), Relation::EqualTo, mContentWidth, ContentConstraintPriority);
+    tableau.AddConstraint(GetHeightVar(), Relation::EqualTo, mContentHeight, ContentConstraintPriority);
+    mIntrinsicSizeAdded = true;
+  } else {
+    if (mContentWidth != mIntrinsicWidth) {
+      tableau.UpdateConstraint(GetWidthVar(), mContentWidth);
+    }
+    if (mContentHeight != mIntrinsicHeight) {
+      tableau.UpdateConstraint(GetHeightVar(), mContentHeight);
+    }
+  }
+  mIntrinsicWidth = mContentWidth;
+  mIntrinsicHeight = mContentHeight;
+}
+
 void View::AddHeldView(View* const view) {
   mWindow->AddHeldView(view);
 }
@@ -99,7 +153,9 @@ Graphics2D* View::GetGraphics() {
 WindowRoot::WindowRoot(int width, 
                        int height) : mWidth(width), 
                        mHeight(height),
-                       mGraphics(nullptr), mInit(false),
+                       mGraphics(nullptr),
+                       mTableauWidth(width), mTableauHeight(height),
+                       mInit(false),
                        mFocusedView(nullptr),
                        mRGB({0.0f, 0.0f, 0.0f}) {
   //mGraphics = new Graphics2D();
@@ -116,6 +172,23 @@ bool WindowRoot::Init(const char** extensions, const uint32_t extensionCount) {
      // Initialize our Graphics Engine.
      bool retVal = mGraphics->Init(extensions, extensionCount);
      if (!retVal) { return retVal; }
+     InitLayout();
+     return retVal;
+}
+
+bool WindowRoot::InitOffscreen() {
+     if (mInit) { return true; }
+     bool retVal = mGraphics->InitOffscreen(mWidth, mHeight);
+     if (!retVal) { return retVal; }
+     InitLayout();
+     return retVal;
+}
+
+void WindowRoot::InitLayout() {
+     // Generated Box relations. Must be registered before the window
+     // constraints are added, since those reference Right and Bottom.
+     AddDerivedVariables(mTableau);
+
      GenerateConstraints();
      mTableau.AddConstraint(GetWidthConstraint());
      mTableau.AddConstraint(GetHeightConstraint());
@@ -123,12 +196,27 @@ bool WindowRoot::Init(const char** extensions, const uint32_t extensionCount) {
      mTableau.AddConstraint(GetRightConstraint());
      mTableau.AddConstraint(GetTopConstraint());
      mTableau.AddConstraint(GetBottomConstraint());
-
-     // Generated Box Constraints
-     mTableau.AddConstraint(GetWidthVar(), Relation::EqualTo, GetRightVar() - GetLeftVar());
-     mTableau.AddConstraint(GetHeightVar(), Relation::EqualTo, GetBottomVar() - GetTopVar());
+     // Window size edits don't invalidate the compiled layout.
+     mTableau.AddInputVariable(GetWidthVar());
+     mTableau.AddInputVariable(GetRightVar());
+     mTableau.AddInputVariable(GetHeightVar());
+     mTableau.AddInputVariable(GetBottomVar());
+     mTableauWidth = mWidth;
+     mTableauHeight = mHeight;
      mInit = true;
-     return retVal;
+}
+
+bool WindowRoot::ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) {
+  return mGraphics->ReadPixels(rgba, width, height);
+}
+
+bool WindowRoot::WritePNG(const std::string& file) {
+  std::vector<uint8_t> rgba;
+  uint32_t width, height;
+  if (!mGraphics->ReadPixels(rgba, width, height)) {
+    return false;
+  }
+  return WritePNGFile(file, rgba, width, height);
 }
 
 void WindowRoot::GenerateConstraints() {
@@ -150,42 +238,79 @@ void WindowRoot::SetSurface(VkSurfaceKHR surface) {
 
 
 void WindowRoot::UpdateViewHierarchy() {
+  PROFILE_ZONE("UpdateViewHierarchy");
   // Measure pass
-  for (auto* view : mViews) {
-    view->measure();
-    view->UpdateConstraints();
+  {
+    PROFILE_ZONE("Measure");
+    for (auto* view : mViews) {
+      view->measure();
+      PROFILE_ZONE("UpdateConstraints");
+      view->UpdateConstraints();
+    }
   }
 
   // XXX: why is this here?
   // TODO
   UpdateConstraints(); // Update the window constraints.
-    
-  mTableau.Solve(); // Tableau Solve
+
+  if (mCompileRequested) {
+    PROFILE_ZONE("Compile Layout");
+    mCompileRequested = false;
+    mTableau.FinishUpdates();
+    const LayoutCompileRequest& r = mCompileRequest;
+    mParametricLayout.Compile(mTableau,
+                              { GetWidthVar(), GetRightVar() },
+                              { GetHeightVar(), GetBottomVar() },
+                              [this](int width, int height) { PushSizeToTableau(width, height); },
+                              r.minWidth, r.maxWidth, r.minHeight, r.maxHeight, r.step);
+  }
+
+  // Use the compiled layout while it still matches the tableau.
+  mLayoutRegion = ParametricLayout::npos;
+  if (mParametricLayout.IsValid(mTableau)) {
+    mLayoutRegion = mParametricLayout.FindRegion(mWidth, mHeight);
+  }
+  mCachedRects = nullptr;
+  if (mLayoutRegion == ParametricLayout::npos) {
+    PROFILE_ZONE("Solve");
+    SolveLayout();
+  }
 
   // Layout
-  for (auto* view : mViews) {
-    const int left = static_cast<int>(mTableau.GetResult(view->GetLeftVar()));
-    const int top = static_cast<int>(mTableau.GetResult(view->GetTopVar()));
-    const int width = static_cast<int>(mTableau.GetResult(view->GetWidthVar()));
-    const int height = static_cast<int>(mTableau.GetResult(view->GetHeightVar()));
-    view->layout(left, top, left + width, top + height);
+  {
+    PROFILE_ZONE("Layout");
+    for (auto* view : mViews) {
+      const LayoutRect rect = GetLayoutRect(view);
+      view->layout(rect.left, rect.top, rect.left + rect.width, rect.top + rect.height);
+    }
   }
     
   
   // Draw
   mGraphics->BeginRecording(); // Note: Blocks until command buffer is available
    
-  mGraphics->SetColor(mRGB[0], mRGB[1], mRGB[2], 1.f);
-  mGraphics->DrawRect(0, 0, GetWidth(), GetHeight());
-
-  // This is needed so that when we Resize window,
-  // we get rid of the scissor applied by the View 
-  // rendered last. (which should be the old Window size).
-  mGraphics->UnsetScissor();
-  Rect blah;
-  mGraphics->SetScissor(0, 0, GetWidth(), GetHeight(), blah);
-  for (auto* view : mViews) {
-   view->draw(); // Draw all descendant views.
+  {
+    PROFILE_ZONE("Draw");
+    // Each View's ops are compared with the ones it drew last frame,
+    // only what changed gets redrawn.
+    const DisplayList& frame = mGraphics->GetDisplayList();
+    auto trackSince = [&](const void* key, size_t first) {
+      mDamageTracker.Track(key, frame.GetOps().data() + first, frame.GetSize() - first);
+    };
+
+    mGraphics->SetColor(mRGB[0], mRGB[1], mRGB[2], 1.f);
+    mGraphics->DrawRect(0, 0, GetWidth(), GetHeight());
+    trackSince(this, 0);
+
+    // Views push and pop their own Scissors. The whole
+    // Window is the Scissor of a new frame.
+    for (size_t i = 0; i < mViews.size(); i++) {
+     PROFILE_ZONE_ARG("Draw View", i);
+     const size_t first = frame.GetSize();
+     mViews[i]->DrawCached(); // Draw all descendant views.
+     trackSince(mViews[i], first);
+    }
+    mGraphics->SetDamage(mDamageTracker.EndFrame({0, 0, GetWidth(), GetHeight()}));
   }
   mGraphics->EndRecording(); // End renderpass. Stops command buffer Recording
 }
@@ -212,21 +337,100 @@ void WindowRoot::Present() {
 
 void WindowRoot::Resize(int newWidth, int newHeight) {
   if (mWidth != newWidth || mHeight != newHeight) {
-    GetGraphics()->Resize(); // Will recreate swapchain.
+    if (GetGraphics()->IsOffscreen()) {
+      GetGraphics()->ResizeOffscreen(newWidth, newHeight);
+    } else {
+      GetGraphics()->Resize(); // Will recreate swapchain.
+    }
+    mDamageTracker.Invalidate();
   }
  
   mWidth = newWidth;
   mHeight = newHeight;
- 
+  // The tableau catches up in SyncTableauSize(), once
+  // neither the compiled layout nor the cache has the size.
+}
+
+void WindowRoot::SolveLayout() {
+  mCachedRects = mLayoutCache.Find(mWidth, mHeight, mTableau.GetVersion());
+  if (mCachedRects) {
+    return;
+  }
+  SyncTableauSize();
+  // Re-optimize after any intrinsic size edits from UpdateConstraints().
+  mTableau.FinishUpdates();
+  mTableau.Solve(); // Tableau Solve
+  if (mLayoutCache.GetCapacity() == 0) {
+    return;
+  }
+
+  std::vector<LayoutRect> rects(mParametricLayout.GetRectCount());
+  for (const auto& entry : mLayoutRectIndex) {
+    const Box* box = entry.first;
+    LayoutRect& rect = rects[entry.second];
+    rect.left = ToPixel(mTableau.GetResult(box->GetLeftVar()));
+    rect.top = ToPixel(mTableau.GetResult(box->GetTopVar()));
+    rect.width = ToPixel(mTableau.GetResult(box->GetWidthVar()));
+    rect.height = ToPixel(mTableau.GetResult(box->GetHeightVar()));
+  }
+  mCachedRects = mLayoutCache.Insert(mWidth, mHeight, mTableau.GetVersion(), std::move(rects));
+}
+
+void WindowRoot::PushSizeToTableau(int width, int height) {
   // Does this really go here or in the UpdateConstraint section ?
-  mTableau.UpdateConstraint(*GetWidthConstraint(), mWidth-1);
-  mTableau.UpdateConstraint(*GetRightConstraint(), mWidth-1);
-  mTableau.UpdateConstraint(*GetHeightConstraint(), mHeight-1);
-  mTableau.UpdateConstraint(*GetBottomConstraint(), mHeight-1);
+  mTableau.UpdateConstraint(*GetWidthConstraint(), width-1);
+  mTableau.UpdateConstraint(*GetRightConstraint(), width-1);
+  mTableau.UpdateConstraint(*GetHeightConstraint(), height-1);
+  mTableau.UpdateConstraint(*GetBottomConstraint(), height-1);
   mTableau.FinishUpdates();
+  mTableauWidth = width;
+  mTableauHeight = height;
+}
+
+void WindowRoot::SyncTableauSize() {
+  if (mTableauWidth != mWidth || mTableauHeight != mHeight) {
+    PushSizeToTableau(mWidth, mHeight);
+  }
+}
+
+void WindowRoot::CompileLayout(int minWidth, int maxWidth, int minHeight, int maxHeight, int step) {
+  mCompileRequest = { minWidth, maxWidth, minHeight, maxHeight, step };
+  mCompileRequested = true;
+}
+
+void WindowRoot::AddLayoutBox(const Box* box) {
+  mLayoutRectIndex[box] = mParametricLayout.AddRect(box->GetLeftVar(), box->GetTopVar(),
+                                                    box->GetWidthVar(), box->GetHeightVar());
+}
+
+void WindowRoot::RemoveLayoutBox(const Box* box) {
+  mLayoutRectIndex.erase(box);
+}
+
+LayoutRect WindowRoot::GetLayoutRect(const View* view) {
+  if (view->HasStaticRect()) {
+    return view->GetStaticRect();
+  }
+  if (mLayoutRegion != ParametricLayout::npos || mCachedRects) {
+    auto iter = mLayoutRectIndex.find(view);
+    if (iter != mLayoutRectIndex.end()) {
+      if (mCachedRects) {
+        return (*mCachedRects)[iter->second];
+      }
+      return mParametricLayout.GetRect(mLayoutRegion, iter->second, mWidth, mHeight);
+    }
+  }
+  SyncTableauSize();
+  LayoutRect rect;
+  rect.left = ToPixel(mTableau.GetResult(view->GetLeftVar()));
+  rect.top = ToPixel(mTableau.GetResult(view->GetTopVar()));
+  rect.width = ToPixel(mTableau.GetResult(view->GetWidthVar()));
+  rect.height = ToPixel(mTableau.GetResult(view->GetHeightVar()));
+  return rect;
 }
 
 void WindowRoot::InjectInputEvent(const InputEvent& e) {
+  PROFILE_ZONE("Input");
   if (e.type == InputType::MouseHeld && !mHeldViews.empty()) {
     for (auto* heldView : mHeldViews) {
       heldView ->InjectInputEvent(e);
@@ -9,10 +9,15 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "Graphics2D.h"
+#include "ConstraintTemplate.h"
+#include "DamageTracker.h"
 #include "Expression.h"
+#include "LayoutCache.h"
+#include "ParametricLayout.h"
 #include "Timer.h"
 
 #define VK_USE_PLATFORM_XLIB_KHR
@@ -61,6 +66,8 @@ class Box {
             mBottomVar(GenerateVarName(BoxAttribute::Bottom)),
             mWidthVar(GenerateVarName(BoxAttribute::Width)),
             mHeightVar(GenerateVarName(BoxAttribute::Height)),
+            mCenterXVar(GenerateVarName(BoxAttribute::CenterX)),
+            mCenterYVar(GenerateVarName(BoxAttribute::CenterY)),
             mHorizontalConstraint(nullptr), mVerticalConstraint(nullptr),
             mLeftConstraint(nullptr), mRightConstraint(nullptr),
             mTopConstraint(nullptr), mBottomConstraint(nullptr),
@@ -83,6 +90,23 @@ class Box {
    Variable GetBottomVar() const { return mBottomVar; }
    Variable GetWidthVar() const { return mWidthVar; }
    Variable GetHeightVar() const { return mHeightVar; }
+   Variable GetCenterXVar() const { return mCenterXVar; }
+   Variable GetCenterYVar() const { return mCenterYVar; }
+
+   // Right, Bottom and Centers are derived from Left/Top and Width/Height,
+   // so they don't need rows of their own in the tableau.
+   Expression<double> GetRightExpression() const { return mLeftVar + mWidthVar; }
+   Expression<double> GetBottomExpression() const { return mTopVar + mHeightVar; }
+   Expression<double> GetCenterXExpression() const { return mLeftVar + mWidthVar * 0.5; }
+   Expression<double> GetCenterYExpression() const { return mTopVar + mHeightVar * 0.5; }
+
+   // Registers Right, Bottom, CenterX and CenterY with the tableau.
+   void AddDerivedVariables(Tableau2& tableau) const {
+     tableau.AddDerivedVariable(mRightVar, GetRightExpression());
+     tableau.AddDerivedVariable(mBottomVar, GetBottomExpression());
+     tableau.AddDerivedVariable(mCenterXVar, GetCenterXExpression());
+     tableau.AddDerivedVariable(mCenterYVar, GetCenterYExpression());
+   }
 
    std::string GenerateVarName(BoxAttribute attribute) const;
 
@@ -105,7 +129,8 @@ class Box {
    Constraint* GetWidthConstraint() const { return mWidthConstraint; }
    Constraint* GetHeightConstraint() const { return mHeightConstraint; }
   
-   // XXX: I don't think this is used any longer...
+   // XXX: No longer used. Right and Bottom are now derived variables.
+   //      See GetRightExpression() and GetBottomExpression().
    // Box Constraints. Two:
    //   1. Box-Width = Box-RightVar - Box-LeftVar
    //   2. Box-Height = Box-BottomVar - Box-TopVar    
@@ -130,6 +155,8 @@ class Box {
   Variable mBottomVar;
   Variable mWidthVar;
   Variable mHeightVar;
+  Variable mCenterXVar;
+  Variable mCenterYVar;
   
   Constraint* mHorizontalConstraint;
   Constraint* mVerticalConstraint;
@@ -153,7 +180,7 @@ class View : public Box {
   View(const View& v) = delete;
   
   // Destructor
-  ~View() = default;
+  virtual ~View();
 
   // operators
   View& operator=(const View& view) = delete; // assignment
@@ -173,6 +200,11 @@ class View : public Box {
   }
 
   virtual void draw() = 0; // Draw Your Own View, then all Children View.
+
+  // Calls draw(), unless the View enabled its draw cache and neither its
+  // rect nor its draw version changed since the last call. Then the
+  // Draw Calls recorded last time are replayed instead.
+  void DrawCached();
    // TODO : Make this non-const. Why? Views with children
   //      may want to modify how it forwards input events.
   virtual void InjectInputEvent(const InputEvent& e);
@@ -188,10 +220,21 @@ class View : public Box {
   bool HasFocus() const { return mHasFocus; }
   void RegisterClickEvent(std::function<void(View*)> onClick);
 
+  // Places the view at a fixed rect, typically from a StaticLayout solved
+  // at compile time. The view's box then never enters the tableau, so
+  // no constraint may reference it.
+  void SetStaticRect(const LayoutRect& rect) {
+    mStaticRect = rect;
+    mHasStaticRect = true;
+  }
+  bool HasStaticRect() const { return mHasStaticRect; }
+  const LayoutRect& GetStaticRect() const { return mStaticRect; }
+
   void SetRGB(float r, float g, float b) {
     mRGB[0] = r;
     mRGB[1] = g;
     mRGB[2] = b;
+    InvalidateDraw();
   }
 
   void SetBackground(float r, float g, float b) {
@@ -202,6 +245,7 @@ class View : public Box {
     mOutlineRGB[0] = r;
     mOutlineRGB[1] = g;
     mOutlineRGB[2] = b;
+    InvalidateDraw();
   }
   
   // Returns True iff InputEvent's pointer position
@@ -217,14 +261,36 @@ class View : public Box {
   Tableau2& GetTableau();
   void AddHeldView(View* const view);
 
+  // Makes the measured content size (mContentWidth/mContentHeight) the
+  // view's weak intrinsic size. The first call adds
+  //   Width = mContentWidth   (weak, makes Width an edit variable)
+  // and the same for height. Later calls only push changed content sizes
+  // through the tableau's edit path, so the tableau never grows.
+  // Note: Another single-variable optional equality on Width would take
+  //       over its edit variable.
+  void UpdateIntrinsicSizeConstraints();
+
   void SetFocusedView(View* const view);
 
   Graphics2D* GetGraphics();
+
+  // For Views whose draw() only depends on their rect and on state whose
+  // setters call InvalidateDraw(). Not for Views drawing children or
+  // anything time-dependent.
+  void EnableDrawCache() { mDrawCache.enabled = true; }
+  void InvalidateDraw() { mDrawCache.version++; }
   
   WindowRoot* mWindow;
  
   int mContentWidth; // Set in measure()
   int mContentHeight;
+
+  // Content size last pushed to the tableau.
+  bool mIntrinsicSizeAdded = false;
+  int mIntrinsicWidth = 0;
+  int mIntrinsicHeight = 0;
+  bool mHasStaticRect = false;
+  LayoutRect mStaticRect;
   int mWidth; // Set in layout()
   int mHeight;
  
@@ -242,6 +308,16 @@ class View : public Box {
   
  bool mHasFocus = false;
  std::function<void(View*)> mOnClickEvent;
+
+ private:
+  struct {
+    bool enabled = false;
+    uint64_t version = 0; // Bumped by InvalidateDraw()
+    bool valid = false; // ops were recorded for 'recordedVersion' at 'recordedRect'
+    uint64_t recordedVersion = 0;
+    int recordedRect[4];
+    DisplayList ops;
+  } mDrawCache;
 };
 
 class WindowRoot : public Box {
@@ -258,10 +334,25 @@ class WindowRoot : public Box {
    WindowRoot& operator=(WindowRoot&&) = delete;
    
    bool Init(const char** extensions, const uint32_t extensionCount);
+
+   // Instead of Init() and SetSurface(): frames are drawn into an image
+   // of the window's size, no window or display needed. Read them back
+   // with ReadPixels() or WritePNG() after Present().
+   bool InitOffscreen();
+
+   // Offscreen only. Most recently presented frame, 
+   // 4 bytes per pixel, row by row.
+   bool ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
+   bool WritePNG(const std::string& file);
    
    VkInstance GetVkInstance() {
      return GetGraphics()->GetVkInstance();
    }
+
+   // GPU time of a recent frame. (See Graphics2D::GetGpuFrameStats)
+   const Graphics2D::GpuFrameStats& GetGpuFrameStats() {
+     return GetGraphics()->GetGpuFrameStats();
+   }
    
    void SetSurface(VkSurfaceKHR surface);
    
@@ -273,6 +364,50 @@ class WindowRoot : public Box {
      mTableau.AddConstraint(c);
    }
 
+   void AddConstraint(const LinearConstraint& c) {
+     mTableau.AddConstraint(c);
+   }
+
+   // One instance of 'pattern', with its placeholders replaced by 'boxes'.
+   void AddConstraints(const ConstraintTemplate& pattern, const std::vector<const Box*>& boxes) {
+     pattern.Instantiate(mTableau, boxes);
+   }
+
+   // Constraints added in between form a group which
+   // can be switched as a unit. (eg: per breakpoint)
+   void BeginConstraintGroup(const std::string& name) {
+     mTableau.BeginGroup(name);
+   }
+
+   void EndConstraintGroup() {
+     mTableau.EndGroup();
+   }
+
+   void EnableConstraintGroup(const std::string& name) {
+     mTableau.EnableGroup(name);
+   }
+
+   void DisableConstraintGroup(const std::string& name) {
+     mTableau.DisableGroup(name);
+   }
+
+   // Compiles the layout for window sizes in [minWidth, maxWidth] x
+   // [minHeight, maxHeight], sampled every 'step' pixels, so that resizing
+   // doesn't need the solver. (See ParametricLayout)
+   // Runs during the next UpdateViewHierarchy(), once Views pushed their
+   // intrinsic sizes. Meant for static screens: after any other constraint
+   // change, layout falls back to the tableau until compiled again.
+   void CompileLayout(int minWidth, int maxWidth, int minHeight, int maxHeight, int step = 16);
+
+   // Keeps the layouts of up to 'entries' window sizes, so resizing back
+   // to a size seen before skips the solver. 0 (the default) disables it.
+   void SetLayoutCacheSize(size_t entries) {
+     mLayoutCache.SetCapacity(entries);
+   }
+
+   // Rect of 'view' for the current frame.
+   LayoutRect GetLayoutRect(const View* view);
+
   int GetWidth() const { return mWidth; }
 
   int GetHeight() const { return mHeight; }
@@ -315,11 +450,31 @@ class WindowRoot : public Box {
 
 
  private:
+   // Window Constraints and the Tableau's edit variables,
+   // once Graphics are initialized.
+   void InitLayout();
+
    // Constructs Window Constraints.
    void GenerateConstraints();
     
    // Updates Constraints... for some reason.
    void UpdateConstraints();
+
+   // Registers a View's rect with the compiled layout.
+   void AddLayoutBox(const Box* box);
+   // Forgets it again, once the View is gone. Its slot in the compiled
+   // layout stays unused until the layout is rebuilt.
+   void RemoveLayoutBox(const Box* box);
+
+   // Pushes a window size through the window's edit variables.
+   void PushSizeToTableau(int width, int height);
+
+   // Brings the tableau up to the current window size. Resizes skip the
+   // tableau, in case the compiled layout or the layout cache cover them.
+   void SyncTableauSize();
+
+   // Solves the tableau for this frame, going through the layout cache.
+   void SolveLayout();
     
    // These are for Views to use.
    const View* GetFocusedView() const;
@@ -347,7 +502,26 @@ class WindowRoot : public Box {
    // Reference to Graphics Resources.
    std::unique_ptr<Graphics2D> mGraphics;
 
+   // Limits each frame to what its Views changed. (See Graphics2D::SetDamage)
+   DamageTracker mDamageTracker;
+
    Tableau2 mTableau;
+   int mTableauWidth; // Window size last pushed into mTableau.
+   int mTableauHeight;
+
+   ParametricLayout mParametricLayout;
+   std::unordered_map<const Box*, size_t> mLayoutRectIndex;
+   size_t mLayoutRegion = ParametricLayout::npos; // Region used for this frame.
+   struct LayoutCompileRequest {
+     int minWidth, maxWidth;
+     int minHeight, maxHeight;
+     int step;
+   };
+   LayoutCompileRequest mCompileRequest;
+   bool mCompileRequested = false;
+
+   LayoutCache mLayoutCache;
+   const std::vector<LayoutRect>* mCachedRects = nullptr; // Rects used for this frame.
 
    std::unordered_set<Timer*> mTimers; // Note: When timer is destroyed
                                        //       it should tell Window
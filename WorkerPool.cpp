@@ -0,0 +1,95 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include "Profiler.h"
+
+WorkerPool::WorkerPool(size_t workerCount) {
+  mWorkers.reserve(workerCount);
+  for (size_t i=0; i<workerCount; i++) {
+    mWorkers.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWorkAvailable.notify_all();
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::Dispatch(size_t jobCount, std::function<void(size_t)> job) {
+  std::unique_lock<std::mutex> batchLock(mBatchMutex);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(mFinishedJobs == mJobCount && "WorkerPool: Dispatch called before Wait");
+    mJob = std::move(job);
+    mJobCount = jobCount;
+    mNextJob = 0;
+    mFinishedJobs = 0;
+    mError = nullptr;
+  }
+  mBatchLock = std::move(batchLock);
+  mWorkAvailable.notify_all();
+}
+
+void WorkerPool::Wait() {
+  // Released on the way out, even when rethrowing.
+  std::unique_lock<std::mutex> batchLock(std::move(mBatchLock));
+  std::unique_lock<std::mutex> lock(mMutex);
+  // Help out with whatever hasn't been started yet.
+  while (mNextJob < mJobCount) {
+    const size_t job = mNextJob++;
+    lock.unlock();
+    RunJob(job);
+    lock.lock();
+    mFinishedJobs++;
+  }
+  mWorkDone.wait(lock, [this] { return mFinishedJobs == mJobCount; });
+  std::exception_ptr error = std::move(mError);
+  mError = nullptr;
+  lock.unlock();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void WorkerPool::RunJob(size_t job) {
+  try {
+    mJob(job);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mError) {
+      mError = std::current_exception();
+    }
+  }
+}
+
+void WorkerPool::WorkerLoop() {
+  PROFILE_THREAD("Worker");
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true) {
+    mWorkAvailable.wait(lock, [this] { return mStopping || mNextJob < mJobCount; });
+    if (mStopping) {
+      return;
+    }
+    const size_t job = mNextJob++;
+    lock.unlock();
+    RunJob(job);
+    lock.lock();
+    if (++mFinishedJobs == mJobCount) {
+      mWorkDone.notify_all();
+    }
+  }
+}
+
+WorkerPool& WorkerPool::GetShared() {
+  static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small persistent thread pool for data-parallel loops.
+//
+// Dispatch() hands out jobs [0, jobCount) to the workers and returns right
+// away, so the caller can do other work in the meantime. Wait() then runs
+// any jobs which haven't been picked up yet on the calling thread, and
+// blocks until every job has finished.
+//
+// A pool with zero workers is valid. Everything then runs inside Wait().
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t workerCount);
+  WorkerPool(const WorkerPool&) = delete;
+
+  ~WorkerPool();
+
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  size_t GetWorkerCount() const {
+    return mWorkers.size();
+  }
+
+  // Must be followed by Wait() on the same thread. Only one batch is in
+  // flight at a time: Dispatch() from another thread blocks until the
+  // current batch's Wait() returns, so tableaus solved on different
+  // threads can share a pool.
+  void Dispatch(size_t jobCount, std::function<void(size_t)> job);
+  // If a job threw, the remaining jobs still run and Wait() rethrows
+  // the first exception once the batch is done.
+  void Wait();
+
+  // Process-wide pool. One worker per hardware thread, minus the caller.
+  static WorkerPool& GetShared();
+
+ private:
+  void WorkerLoop();
+  // Runs 'job' of the current batch, keeping the first exception thrown.
+  void RunJob(size_t job);
+
+  std::vector<std::thread> mWorkers;
+  std::mutex mBatchMutex;
+  std::unique_lock<std::mutex> mBatchLock; // Held from Dispatch() until Wait() returns.
+  std::mutex mMutex;
+  std::condition_variable mWorkAvailable;
+  std::condition_variable mWorkDone;
+
+  // Guarded by mMutex.
+  std::function<void(size_t)> mJob;
+  size_t mJobCount = 0;
+  size_t mNextJob = 0;
+  size_t mFinishedJobs = 0;
+  std::exception_ptr mError;
+  bool mStopping = false;
+};
@@ -223,13 +223,12 @@ int main(int argc, char **argv) {
                                             BoxAttribute::Bottom,
                                             1.f, -400.f);
   
-  // XXX: This is where we need a CenterX Attribute 
-  //      to fix the scrollview to the center of guideline!
+  // Fix the scrollview to the center of guideline.
   Constraint* scrollRight = new Constraint(scrollView, 
                                    BoxAttribute::Right,
                                    Relation::EqualTo,
                                    guideline,
-                                   BoxAttribute::Left, 1.f, 0.f);
+                                   BoxAttribute::CenterX, 1.f, 0.f);
   windowRoot->AddView(scrollView);
   windowRoot->AddConstraint(scrollLeft);
   windowRoot->AddConstraint(scrollTop);
@@ -237,6 +236,15 @@ int main(int argc, char **argv) {
   windowRoot->AddConstraint(scrollRight);
 
   
+  // Every row below the first: pinned to the list's sides, under the row above.
+  ConstraintTemplate rowTemplate(3); // 0: Row, 1: Row above, 2: List
+  const Box& row = rowTemplate.GetBox(0);
+  const Box& rowAbove = rowTemplate.GetBox(1);
+  const Box& list = rowTemplate.GetBox(2);
+  rowTemplate.AddConstraint(row.GetLeftVar(), Relation::EqualTo, list.GetLeftVar());
+  rowTemplate.AddConstraint(row.GetRightVar(), Relation::EqualTo, list.GetRightVar());
+  rowTemplate.AddConstraint(row.GetTopVar(), Relation::EqualTo, rowAbove.GetBottomVar());
+
   View* lastView = nullptr;
   int index = 0;
   EditTextView* editTextView;
@@ -259,23 +267,19 @@ int main(int argc, char **argv) {
     textBox->SetRGB(0.05, 0.05, 0.09);
     textBox->SetTextRGB(1.f, 1.f, 1.f);
 
-    Constraint* left = new Constraint(textBox, BoxAttribute::Left, Relation::EqualTo,
-                                      scrollView, BoxAttribute::Left, 1.f, 0.f);
-    Constraint* right = new Constraint(textBox, BoxAttribute::Right, Relation::EqualTo,
-                                      scrollView, BoxAttribute::Right, 1.0f, 0.f);
- 
-    Constraint* top;
     if (lastView) {
-      top = new Constraint(textBox, BoxAttribute::Top, Relation::EqualTo,
-                                      lastView, BoxAttribute::Bottom, 1.f, 0.f);
+      windowRoot->AddConstraints(rowTemplate, { textBox, lastView, scrollView });
     } else {
-      top = new Constraint(textBox, BoxAttribute::Top, Relation::EqualTo,
-                           scrollView, BoxAttribute::Top, 1.f, 0.f);
+      Constraint* left = new Constraint(textBox, BoxAttribute::Left, Relation::EqualTo,
+                                        scrollView, BoxAttribute::Left, 1.f, 0.f);
+      Constraint* right = new Constraint(textBox, BoxAttribute::Right, Relation::EqualTo,
+                                        scrollView, BoxAttribute::Right, 1.0f, 0.f);
+      Constraint* top = new Constraint(textBox, BoxAttribute::Top, Relation::EqualTo,
+                                       scrollView, BoxAttribute::Top, 1.f, 0.f);
+      windowRoot->AddConstraint(left);
+      windowRoot->AddConstraint(right);
+      windowRoot->AddConstraint(top);
     }
- 
-    windowRoot->AddConstraint(left);
-    windowRoot->AddConstraint(right);
-    windowRoot->AddConstraint(top);
     scrollView->AddView(textBox);
     lastView = textBox;
     index++;
@@ -405,6 +409,12 @@ int main(int argc, char **argv) {
   // Add Another Edit Text Box and Open Button for opening any file!
   // Rather than just the ones in scrollview.
 
+  // Resizing the window then skips the solver, until text is edited
+  // or a guideline is dragged.
+  windowRoot->CompileLayout(320, 2560, 240, 1440, 32);
+  // After that, sizes already seen are still solved only once.
+  windowRoot->SetLayoutCacheSize(64);
+
   int frameidx = 0;
   while (!glfwWindowShouldClose(GlfwResources.window)) {
     std::cout << "Frame Index: " << frameidx++ << std::endl;
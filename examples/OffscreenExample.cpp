@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <vulkan/vulkan.h>
+
+#include "../BoxView.h"
+#include "../Profiler.h"
+
+// Draws without a window or display: on build machines,
+// or servers rendering thumbnails. (eg: on lavapipe)
+//
+// Usage: OffscreenExample.out [out.png] [frames] [trace.json]
+// Draws 'frames' frames, prints the average frame time and the
+// GPU time of a recent frame, then writes the last frame to 'out.png'.
+// Built with make PROFILER=1, also writes where the time went,
+// GPU track included, to 'trace.json'.
+int main(int argc, char **argv) {
+  const char* pngFile = argc > 1 ? argv[1] : "OffscreenExample.png";
+  const int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 1;
+  const char* traceFile = argc > 3 ? argv[3] : nullptr;
+  PROFILE_THREAD("Main");
+
+  constexpr int Width = 640;
+  constexpr int Height = 360;
+  WindowRoot* const windowRoot = new WindowRoot(Width, Height);
+  if (!windowRoot || !windowRoot->InitOffscreen()) {
+    return 1; // E_INIT
+  }
+  windowRoot->SetRGB(0.1f, 0.1f, 0.15f);
+
+  BoxView* boxView = new BoxView(windowRoot);
+  boxView->SetRGB(0.5f, 0.5f, 0.75f);
+  windowRoot->AddView(boxView);
+  windowRoot->AddConstraint(new Constraint(boxView, BoxAttribute::Top, 
+                                           Relation::EqualTo, nullptr,
+                                           BoxAttribute::NoAttribute, 1.f, 40.f));
+  windowRoot->AddConstraint(new Constraint(boxView, BoxAttribute::Left, 
+                                           Relation::EqualTo, nullptr,
+                                           BoxAttribute::NoAttribute, 1.f, 40.f));
+
+  BoxView* boxView2 = new BoxView(windowRoot);
+  boxView2->SetRGB(0.75f, 0.5f, 0.5f);
+  windowRoot->AddView(boxView2);
+  windowRoot->AddConstraint(new Constraint(boxView2, BoxAttribute::Top, 
+                                           Relation::EqualTo, windowRoot,
+                                           BoxAttribute::Bottom, 0.5f, 0.f));
+  windowRoot->AddConstraint(new Constraint(boxView2, BoxAttribute::Bottom, 
+                                           Relation::EqualTo, windowRoot,
+                                           BoxAttribute::Bottom, 0.8f, 0.f));
+  windowRoot->AddConstraint(new Constraint(boxView2, BoxAttribute::Left, 
+                                           Relation::EqualTo, windowRoot,
+                                           BoxAttribute::Left, 1.f, 50.f));
+  windowRoot->AddConstraint(new Constraint(boxView2, BoxAttribute::Right, 
+                                           Relation::EqualTo, windowRoot,
+                                           BoxAttribute::Right, 1.f, -50.f));
+
+  std::vector<uint8_t> pixels;
+  uint32_t width, height;
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < frames; i++) {
+    windowRoot->SetCurrentTime(std::chrono::high_resolution_clock::now());
+    windowRoot->UpdateViewHierarchy();
+    windowRoot->Present();
+  }
+  // Waits for the last frame.
+  windowRoot->ReadPixels(pixels, width, height);
+  const std::chrono::duration<double, std::milli> elapsed = 
+      std::chrono::high_resolution_clock::now() - start;
+  printf("%d frames, %.3f ms per frame\n", frames, elapsed.count() / frames);
+  // Read back kFRAMES_IN_FLIGHT frames late, none yet for a lone frame.
+  const Graphics2D::GpuFrameStats& gpu = windowRoot->GetGpuFrameStats();
+  printf("GPU: %.3f ms for frame %llu, %u batches\n", gpu.renderPassMs,
+         static_cast<unsigned long long>(gpu.frame), gpu.batchCount);
+
+  if (traceFile && !Profiler::WriteChromeTrace(traceFile)) {
+    fprintf(stderr, "Failed to write %s\n", traceFile);
+  }
+
+  const bool written = windowRoot->WritePNG(pngFile);
+  if (!written) {
+    fprintf(stderr, "Failed to write %s\n", pngFile);
+  }
+  delete windowRoot;
+  return written ? 0 : 1;
+}
@@ -1,22 +1,18 @@
 #version 450 core
 
-// TODO: Use Vertex Buffers.
-
-// Input
+// Input: One instance per quad. (See Graphics2D::QuadInstance)
+layout (location = 0) in ivec4 fbCoords; // left, top, right, bottom
+layout (location = 1) in vec4 rgba;
+layout (location = 2) in vec2 textureCoords[4]; // Top Left, Top Right,
+                                                // Bottom Right, Bottom Left
 
 // Output
 layout (location = 0) out vec4 OutColor;
 layout (location = 1) out vec2 textureCoordinates;
 
 // Push constants use std430 layout
-// Padding?
 layout(push_constant) uniform fb {
-  int fbCoords[4]; // left, top, right, bottom
-                    // Each element is 4 bytes
   uvec2 frameBufferSize; // 8 bytes
-  float rgba[4]; // 12 bytes // XXX: Apparently vec3 doesn't work too well with std140, std340 
-                //                  layout.
-  float textureCoords[8];
 };
 
 void main() {
@@ -1,16 +1,20 @@
 #version 450 core
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Input
 layout (location = 0) in vec2 textureCoords;
 
 layout (location = 1) in vec3 TextColor;
+layout (location = 2) flat in uint TextureIdx;
 
 // Output
 layout (location = 0) out vec4 FragmentColor;
 
 // Uniforms
-layout (set=0, binding=0) uniform sampler2D textureSampler;
+// Every Font Atlas. (See kMaxTextures in Graphics2D.cpp)
+layout (set=0, binding=0) uniform sampler2D textures[1024];
 
 void main() {
-  FragmentColor = vec4(TextColor, texture(textureSampler, textureCoords).r);
+  // Runs of different fonts may share a batch.
+  FragmentColor = vec4(TextColor, texture(textures[nonuniformEXT(TextureIdx)], textureCoords).r);
 }
@@ -0,0 +1,34 @@
+#version 450 core
+
+// Input: One instance per glyph. (See Graphics2D::GlyphInstance)
+layout (location = 0) in ivec2 position; // Top Left
+layout (location = 1) in ivec2 size; // width, height
+layout (location = 2) in vec4 atlasRect; // left, top, right, bottom. Normalized
+layout (location = 3) in vec4 rgba;
+layout (location = 4) in uint textureIdx; // Into the texture array.
+
+// Output
+layout (location = 0) out vec2 textureCoordinates;
+layout (location = 1) out vec3 Color;
+layout (location = 2) flat out uint TextureIdx;
+
+// Push constants use std430 layout
+layout(push_constant) uniform fb {
+  uvec2 frameBufferSize; // 8 bytes
+};
+
+// Two triangles: Top Left, Top Right, Bottom Right, 
+//                Bottom Right, Bottom Left, Top Left
+const ivec2 corners[6] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+                                 ivec2(1, 1), ivec2(0, 1), ivec2(0, 0));
+
+void main() {
+  ivec2 corner = corners[gl_VertexIndex];
+  vec2 fbCoord = vec2(position + corner * size);
+
+  vec2 clipCoord = 2 * (fbCoord / vec2(frameBufferSize)) - 1;
+  gl_Position = vec4(clipCoord, 0.0, 1.0);
+  textureCoordinates = mix(atlasRect.xy, atlasRect.zw, vec2(corner));
+  Color = rgba.rgb;
+  TextureIdx = textureIdx;
+}
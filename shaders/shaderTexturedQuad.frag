@@ -1,14 +1,18 @@
 #version 450 core
+#extension GL_EXT_nonuniform_qualifier : require
 
 // Input
 layout (location = 0) in vec2 textureCoords;
+layout (location = 2) flat in uint TextureIdx;
 
 // Output
 layout (location = 0) out vec4 FragmentColor;
 
 // Uniforms
-layout (set=0, binding=0) uniform sampler2D textureSampler;
+// Every Image's texture. (See kMaxTextures in Graphics2D.cpp)
+layout (set=0, binding=0) uniform sampler2D textures[1024];
 
 void main() {
-  FragmentColor = texture(textureSampler, textureCoords);
+  // Instances of a batch may use different textures.
+  FragmentColor = texture(textures[nonuniformEXT(TextureIdx)], textureCoords);
 }
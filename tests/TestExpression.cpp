@@ -1,6 +1,16 @@
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <random>
+#include <thread>
 #include "gtest/gtest.h"
 #include "../Expression.h"
+#include "../DenseTableau.h"
+#include "../ParametricLayout.h"
+#include "../StaticLayout.h"
+#include "../ConstraintTemplate.h"
+#include "../LayoutCache.h"
+#include "../WorkerPool.h"
 #include "../View.h"
 
 // TODO: Clean all this up...
@@ -345,3 +355,861 @@ TEST(TableauTest, GeneratedConstraint) {
 }
 
 
+
+// Dense and Sparse backends should produce the same layouts.
+namespace {
+
+struct TestConstraint {
+  Expression<double> lhs;
+  Relation relation;
+  Expression<double> rhs;
+  int strength;
+};
+
+double Evaluate(Tableau2& tableau, const Expression<double>& e) {
+  double result = e.GetConstant();
+  for (const auto& var : e.GetVariables()) {
+    result += e.GetCoefficient(var) * tableau.GetResult(var);
+  }
+  return result;
+}
+
+// Returns total error for each strength. Index REQUIRED holds
+// the violation of required constraints, which should be 0.
+std::array<double, Tableau2::REQUIRED+1> ConstraintError(Tableau2& tableau, const std::vector<TestConstraint>& constraints) {
+  std::array<double, Tableau2::REQUIRED+1> error{};
+  for (const auto& c : constraints) {
+    const double difference = Evaluate(tableau, c.lhs) - Evaluate(tableau, c.rhs);
+    switch (c.relation) {
+      case Relation::EqualTo:
+        error[c.strength] += std::abs(difference);
+        break;
+      case Relation::GreaterThanOrEqualTo:
+        error[c.strength] += std::max(0.0, -difference);
+        break;
+      case Relation::LessThanOrEqualTo:
+        error[c.strength] += std::max(0.0, difference);
+        break;
+    }
+  }
+  return error;
+}
+
+// Random layout-like problem. Required constraints are all satisfied
+// by a random (non-negative) point, so the system is always solvable.
+std::vector<TestConstraint> GenerateProblem(std::mt19937& rng, const std::vector<Variable>& vars) {
+  std::uniform_real_distribution<double> position(0.0, 500.0);
+  std::uniform_int_distribution<int> varIdx(0, vars.size() - 1);
+  std::uniform_int_distribution<int> kind(0, 3);
+  std::uniform_int_distribution<int> optionalStrength(1, Tableau2::STRONG);
+  std::vector<double> point(vars.size());
+  for (auto& p : point) p = std::round(position(rng));
+
+  std::vector<TestConstraint> constraints;
+  for (size_t i=0; i<vars.size(); i++) {
+    constraints.push_back({vars[i], Relation::EqualTo, std::round(position(rng)), 1});
+  }
+  for (size_t i=0; i<vars.size() * 2; i++) {
+    const int a = varIdx(rng), b = varIdx(rng);
+    if (a == b) continue;
+    const double gap = point[a] - point[b];
+    switch (kind(rng)) {
+      case 0: // Required: A >= B + c
+        constraints.push_back({vars[a], Relation::GreaterThanOrEqualTo, Expression<double>(vars[b]) + (gap - std::round(position(rng) * 0.1)), Tableau2::REQUIRED});
+        break;
+      case 1: // Required: A <= B + c
+        constraints.push_back({vars[a], Relation::LessThanOrEqualTo, Expression<double>(vars[b]) + (gap + std::round(position(rng) * 0.1)), Tableau2::REQUIRED});
+        break;
+      case 2: // Optional: A = 0.5*B + c
+        constraints.push_back({vars[a], Relation::EqualTo, 0.5 * vars[b] + std::round(position(rng) * 0.1), optionalStrength(rng)});
+        break;
+      default: // Optional: A - B <= c
+        constraints.push_back({vars[a] - vars[b], Relation::LessThanOrEqualTo, std::round(position(rng) * 0.2), optionalStrength(rng)});
+        break;
+    }
+  }
+  return constraints;
+}
+
+void ExpectSameError(Tableau2& sparse, Tableau2& dense, const std::vector<TestConstraint>& constraints) {
+  auto sparseError = ConstraintError(sparse, constraints);
+  auto denseError = ConstraintError(dense, constraints);
+  EXPECT_NEAR(sparseError[Tableau2::REQUIRED], 0.0, 1e-4);
+  EXPECT_NEAR(denseError[Tableau2::REQUIRED], 0.0, 1e-4);
+  for (int strength=1; strength<Tableau2::REQUIRED; strength++) {
+    EXPECT_NEAR(sparseError[strength], denseError[strength], 1e-4) << "Strength: " << strength;
+  }
+}
+
+} // namespace
+
+TEST(TableauBackendTest, DenseMatchesSparse) {
+  Variable windowLeft("WindowLeft"), windowRight("WindowRight"), windowWidth("WindowWidth");
+  Variable boxLeft("BoxLeft"), boxRight("BoxRight"), boxWidth("BoxWidth");
+
+  Tableau2 tableaus[2];
+  tableaus[0].SetBackend(TableauBackend::Sparse);
+  tableaus[1].SetBackend(TableauBackend::Dense);
+  for (auto& tableau : tableaus) {
+    tableau.AddConstraint(windowLeft, Relation::EqualTo, 0, Tableau2::STRONG);
+    tableau.AddConstraint(windowRight, Relation::EqualTo, 150, Tableau2::STRONG);
+    tableau.AddConstraint(windowWidth, Relation::EqualTo, 150, Tableau2::STRONG);
+    tableau.AddConstraint(boxRight-boxLeft, Relation::EqualTo, boxWidth, Tableau2::REQUIRED);
+    tableau.AddConstraint(boxWidth, Relation::GreaterThanOrEqualTo, 40, 3);
+    tableau.AddConstraint(boxWidth, Relation::LessThanOrEqualTo, 100, 3);
+    tableau.AddConstraint(boxWidth, Relation::EqualTo, windowWidth * (1.0/3), Tableau2::WEAK);
+    tableau.AddConstraint(boxLeft, Relation::EqualTo, windowLeft, Tableau2::STRONG);
+    tableau.Solve();
+  }
+  for (const auto& var : {windowLeft, windowRight, windowWidth, boxLeft, boxRight, boxWidth}) {
+    EXPECT_NEAR(tableaus[0].GetResult(var), tableaus[1].GetResult(var), 1e-6) << var;
+  }
+  EXPECT_NEAR(tableaus[1].GetResult(boxWidth), 50, 1e-6);
+
+  for (auto& tableau : tableaus) {
+    tableau.UpdateConstraint(windowWidth, 400);
+    tableau.UpdateConstraint(windowRight, 400);
+    tableau.FinishUpdates();
+  }
+  for (const auto& var : {windowLeft, windowRight, windowWidth, boxLeft, boxRight, boxWidth}) {
+    EXPECT_NEAR(tableaus[0].GetResult(var), tableaus[1].GetResult(var), 1e-6) << var;
+  }
+  EXPECT_NEAR(tableaus[1].GetResult(boxWidth), 100, 1e-6);
+}
+
+TEST(TableauBackendTest, RandomizedDifferential) {
+  std::mt19937 rng(1234);
+  for (int problem=0; problem<40; problem++) {
+    std::vector<Variable> vars;
+    const int varCount = 4 + problem % 12;
+    for (int i=0; i<varCount; i++) {
+      vars.emplace_back("v" + std::to_string(i));
+    }
+    std::vector<TestConstraint> constraints = GenerateProblem(rng, vars);
+
+    Tableau2 sparse, dense;
+    sparse.SetBackend(TableauBackend::Sparse);
+    dense.SetBackend(TableauBackend::Dense);
+    for (const auto& c : constraints) {
+      sparse.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+      dense.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+    }
+    sparse.Solve();
+    dense.Solve();
+    ExpectSameError(sparse, dense, constraints);
+
+    // Incremental path: move the weak edit variables and re-solve.
+    std::uniform_real_distribution<double> position(0.0, 500.0);
+    for (size_t i=0; i<vars.size(); i+=2) {
+      const double value = std::round(position(rng));
+      sparse.UpdateConstraint(vars[i], value);
+      dense.UpdateConstraint(vars[i], value);
+      constraints[i].rhs = value;
+    }
+    sparse.FinishUpdates();
+    dense.FinishUpdates();
+    ExpectSameError(sparse, dense, constraints);
+  }
+}
+
+TEST(TableauBackendTest, UniqueSolutionDifferential) {
+  // Required equalities chain every variable to v0, and a strong
+  // constraint pins v0, so both backends must land on the same point
+  // no matter how they break ties among the weak constraints.
+  std::mt19937 rng(4321);
+  std::uniform_real_distribution<double> position(0.0, 500.0);
+  for (int problem=0; problem<20; problem++) {
+    std::vector<Variable> vars;
+    const int varCount = 4 + problem % 12;
+    for (int i=0; i<varCount; i++) {
+      vars.emplace_back("v" + std::to_string(i));
+    }
+    std::vector<double> point(varCount);
+    std::vector<TestConstraint> constraints;
+    point[0] = std::round(position(rng));
+    constraints.push_back({vars[0], Relation::EqualTo, point[0], Tableau2::STRONG});
+    for (int i=1; i<varCount; i++) {
+      const int parent = std::uniform_int_distribution<int>(0, i - 1)(rng);
+      const double offset = std::round(position(rng) * 0.5); // Variables are >= 0.
+      point[i] = point[parent] + offset;
+      constraints.push_back({vars[i], Relation::EqualTo, Expression<double>(vars[parent]) + offset, Tableau2::REQUIRED});
+    }
+    std::uniform_int_distribution<int> varIdx(0, varCount - 1);
+    for (int i=0; i<varCount; i++) {
+      const int a = varIdx(rng), b = varIdx(rng);
+      if (a == b) continue;
+      constraints.push_back({vars[a], Relation::GreaterThanOrEqualTo, Expression<double>(vars[b]) + (point[a] - point[b] - 5), Tableau2::REQUIRED});
+      constraints.push_back({vars[a], Relation::EqualTo, 0.5 * vars[b] + std::round(position(rng) * 0.1), Tableau2::WEAK});
+    }
+
+    Tableau2 sparse, dense;
+    sparse.SetBackend(TableauBackend::Sparse);
+    dense.SetBackend(TableauBackend::Dense);
+    for (const auto& c : constraints) {
+      sparse.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+      dense.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+    }
+    sparse.Solve();
+    dense.Solve();
+    for (int i=0; i<varCount; i++) {
+      EXPECT_NEAR(sparse.GetResult(vars[i]), point[i], 1e-6) << vars[i];
+      EXPECT_NEAR(dense.GetResult(vars[i]), point[i], 1e-6) << vars[i];
+    }
+
+    // Moving v0 moves every variable by the same amount.
+    const double shift = std::round(position(rng) * 0.5);
+    sparse.UpdateConstraint(vars[0], point[0] + shift);
+    dense.UpdateConstraint(vars[0], point[0] + shift);
+    sparse.FinishUpdates();
+    dense.FinishUpdates();
+    for (int i=0; i<varCount; i++) {
+      EXPECT_NEAR(sparse.GetResult(vars[i]), point[i] + shift, 1e-6) << vars[i];
+      EXPECT_NEAR(dense.GetResult(vars[i]), point[i] + shift, 1e-6) << vars[i];
+    }
+  }
+}
+
+TEST(TableauBackendTest, ScalarMatchesSimd) {
+  auto solve = [](std::vector<double>& results) {
+    std::mt19937 rng(99);
+    std::vector<Variable> vars;
+    for (int i=0; i<24; i++) {
+      vars.emplace_back("v" + std::to_string(i));
+    }
+    Tableau2 tableau;
+    tableau.SetBackend(TableauBackend::Dense);
+    for (const auto& c : GenerateProblem(rng, vars)) {
+      tableau.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+    }
+    tableau.Solve();
+    for (const auto& var : vars) {
+      results.push_back(tableau.GetResult(var));
+    }
+  };
+
+  const bool simdEnabled = DenseTableau::IsSimdEnabled();
+  std::vector<double> scalarResults, simdResults;
+  DenseTableau::SetSimdEnabled(false);
+  solve(scalarResults);
+  DenseTableau::SetSimdEnabled(true);
+  solve(simdResults);
+  DenseTableau::SetSimdEnabled(simdEnabled);
+  EXPECT_EQ(scalarResults, simdResults);
+}
+
+TEST(TableauTest, ParallelPivotIsDeterministic) {
+  auto solve = [](WorkerPool* pool, std::vector<double>& results) {
+    std::mt19937 rng(3);
+    std::vector<Variable> vars;
+    for (int i=0; i<60; i++) {
+      vars.emplace_back("v" + std::to_string(i));
+    }
+    Tableau2 tableau;
+    tableau.SetBackend(TableauBackend::Sparse);
+    if (pool) {
+      tableau.SetParallelPivot(pool, 1); // Fan out on every pivot.
+    }
+    for (const auto& c : GenerateProblem(rng, vars)) {
+      tableau.AddConstraint(c.lhs, c.relation, c.rhs, c.strength);
+    }
+    tableau.Solve();
+    for (const auto& var : vars) {
+      results.push_back(tableau.GetResult(var));
+    }
+  };
+
+  std::vector<double> serial;
+  solve(nullptr, serial);
+  for (size_t workers : {0, 1, 3}) {
+    WorkerPool pool(workers);
+    std::vector<double> parallel;
+    solve(&pool, parallel);
+    EXPECT_EQ(serial, parallel) << "Workers: " << workers;
+  }
+}
+
+TEST(WorkerPoolTest, WaitRethrowsJobException) {
+  WorkerPool pool(2);
+  std::atomic<int> ran{0};
+  pool.Dispatch(16, [&](size_t job) {
+    ran++;
+    if (job == 5) throw std::runtime_error("Job failed");
+  });
+  EXPECT_THROW(pool.Wait(), std::runtime_error);
+  EXPECT_EQ(ran.load(), 16); // The others still ran.
+
+  // The pool is usable again.
+  ran = 0;
+  pool.Dispatch(4, [&](size_t) { ran++; });
+  EXPECT_NO_THROW(pool.Wait());
+  EXPECT_EQ(ran.load(), 4);
+}
+
+TEST(TableauTest, DerivedBoxVariables) {
+  Box box;
+  Tableau2 tableau;
+  tableau.AddDerivedVariable(box.GetRightVar(), box.GetRightExpression());
+  tableau.AddDerivedVariable(box.GetBottomVar(), box.GetBottomExpression());
+  EXPECT_TRUE(tableau.ContainsVar(box.GetRightVar()));
+
+  tableau.AddConstraint(box.GetLeftVar(), Relation::EqualTo, 10);
+  tableau.AddConstraint(box.GetRightVar(), Relation::EqualTo, 110, Tableau2::STRONG); // Edit Var
+  tableau.AddConstraint(box.GetTopVar(), Relation::EqualTo, 5);
+  tableau.AddConstraint(box.GetBottomVar(), Relation::GreaterThanOrEqualTo, box.GetTopVar() * 2 + 20);
+  tableau.Solve();
+  EXPECT_NEAR(tableau.GetResult(box.GetWidthVar()), 100, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(box.GetRightVar()), 110, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(box.GetHeightVar()), 25, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(box.GetBottomVar()), 30, 1e-6);
+
+  // Right/Bottom never become tableau variables. (Right is still listed as an Edit Var)
+  const std::string rep = tableau.GetRep();
+  const std::string rows = rep.substr(0, rep.find("Edit Vars:"));
+  EXPECT_EQ(rows.find(box.GetRightVar().GetName()), std::string::npos);
+  EXPECT_EQ(rows.find(box.GetBottomVar().GetName()), std::string::npos);
+
+  tableau.UpdateConstraint(box.GetRightVar(), 60);
+  tableau.FinishUpdates();
+  EXPECT_NEAR(tableau.GetResult(box.GetWidthVar()), 50, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(box.GetRightVar()), 60, 1e-6);
+}
+
+TEST(TableauTest, CenterAttributes) {
+  Box parent, child;
+  Tableau2 tableau;
+  parent.AddDerivedVariables(tableau);
+  child.AddDerivedVariables(tableau);
+
+  tableau.AddConstraint(parent.GetLeftVar(), Relation::EqualTo, 0);
+  tableau.AddConstraint(parent.GetWidthVar(), Relation::EqualTo, 300);
+  tableau.AddConstraint(parent.GetTopVar(), Relation::EqualTo, 0);
+  tableau.AddConstraint(parent.GetHeightVar(), Relation::EqualTo, 100);
+
+  Constraint centerX(&child, BoxAttribute::CenterX, Relation::EqualTo, &parent, BoxAttribute::CenterX, 1.0, 0.0);
+  Constraint centerY(&child, BoxAttribute::CenterY, Relation::EqualTo, &parent, BoxAttribute::CenterY, 1.0, 0.0);
+  tableau.AddConstraint(&centerX);
+  tableau.AddConstraint(&centerY);
+  tableau.AddConstraint(child.GetWidthVar(), Relation::EqualTo, 50);
+  tableau.AddConstraint(child.GetHeightVar(), Relation::EqualTo, 20);
+  tableau.Solve();
+
+  EXPECT_NEAR(tableau.GetResult(child.GetLeftVar()), 125, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(child.GetRightVar()), 175, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(child.GetTopVar()), 40, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(child.GetCenterXVar()), 150, 1e-6);
+}
+
+TEST(TableauTest, LinearConstraint) {
+  Box a, b, window;
+  Tableau2 tableau;
+  for (Box* box : {&a, &b, &window}) {
+    box->AddDerivedVariables(tableau);
+  }
+  tableau.AddConstraint(window.GetLeftVar(), Relation::EqualTo, 0);
+  tableau.AddConstraint(window.GetWidthVar(), Relation::EqualTo, 400);
+
+  // a and b side by side, sharing the window width minus a 20px gap,
+  // with a twice as wide as b.
+  tableau.AddConstraint(LinearConstraint(a.GetLeftVar(), Relation::EqualTo, window.GetLeftVar()));
+  tableau.AddConstraint(LinearConstraint(b.GetLeftVar(), Relation::EqualTo, a.GetRightVar() + 20));
+  tableau.AddConstraint(LinearConstraint(a.GetWidthVar() + b.GetWidthVar(), Relation::EqualTo, window.GetWidthVar() - 20));
+  tableau.AddConstraint(LinearConstraint(a.GetWidthVar(), Relation::EqualTo, 2 * b.GetWidthVar()));
+  tableau.Solve();
+
+  EXPECT_NEAR(tableau.GetResult(a.GetWidthVar()), 253.3333333, 1e-4);
+  EXPECT_NEAR(tableau.GetResult(b.GetWidthVar()), 126.6666666, 1e-4);
+  EXPECT_NEAR(tableau.GetResult(b.GetRightVar()), 400, 1e-6);
+}
+
+TEST(TableauTest, DuplicateAndRedundantConstraints) {
+  Variable a("A"), b("B"), c("C"), d("D");
+  Tableau2 tableau;
+  tableau.AddConstraint(a, Relation::EqualTo, b + 10.0);
+  tableau.AddConstraint(b + 10.0, Relation::EqualTo, a);           // Same constraint, flipped.
+  tableau.AddConstraint(2 * a - 20, Relation::EqualTo, 2 * b);     // Same constraint, scaled.
+  tableau.AddConstraint(a, Relation::GreaterThanOrEqualTo, b + 5); // Implied by A = B + 10.
+  tableau.AddConstraint(b, Relation::EqualTo, c);
+  tableau.AddConstraint(a, Relation::EqualTo, c + 10.0);           // Implied by the two equalities.
+  tableau.AddConstraint(c, Relation::EqualTo, 30, Tableau2::WEAK);
+  tableau.AddConstraint(c, Relation::EqualTo, 30, Tableau2::WEAK); // Optional, kept.
+  tableau.AddConstraint(c, Relation::EqualTo, 30, Tableau2::STRONG);
+  tableau.AddConstraint(d, Relation::EqualTo, 1e15);               // Too large to key. Still added.
+  tableau.Solve();
+
+  TableauStats stats = tableau.GetStats();
+  EXPECT_EQ(stats.addedConstraints, 6);
+  EXPECT_EQ(stats.duplicateConstraints, 2);
+  EXPECT_EQ(stats.redundantConstraints, 2);
+  EXPECT_NEAR(tableau.GetResult(a), 40, 1e-6);
+
+  // Optional duplicates add up, as if each was its own constraint.
+  Variable x("X");
+  Tableau2 weights;
+  weights.AddConstraint(x, Relation::EqualTo, 10, Tableau2::WEAK);
+  weights.AddConstraint(x, Relation::EqualTo, 10, Tableau2::WEAK);
+  weights.AddConstraint(x, Relation::EqualTo, 20, Tableau2::WEAK);
+  weights.Solve();
+  EXPECT_NEAR(weights.GetResult(x), 10, 1e-6);
+
+  // A constraint that couldn't be added isn't a duplicate later.
+  Tableau2 conflicting;
+  conflicting.AddConstraint(x, Relation::EqualTo, 10);
+  EXPECT_THROW(conflicting.AddConstraint(x, Relation::EqualTo, 20), std::runtime_error);
+  EXPECT_THROW(conflicting.AddConstraint(x, Relation::EqualTo, 20), std::runtime_error);
+  EXPECT_EQ(conflicting.GetStats().duplicateConstraints, 0);
+}
+
+TEST(TableauTest, ConstraintGroups) {
+  Variable sidebar("Sidebar"), gap("Gap");
+  Tableau2 tableau;
+  tableau.AddConstraint(sidebar, Relation::EqualTo, 100, 1);
+  tableau.AddConstraint(gap, Relation::EqualTo, 0, 1);
+
+  tableau.BeginGroup("wide");
+  tableau.AddConstraint(sidebar, Relation::EqualTo, 200, 3);
+  tableau.AddConstraint(gap, Relation::EqualTo, 8, 3);
+  tableau.EndGroup();
+
+  tableau.BeginGroup("narrow");
+  tableau.AddConstraint(sidebar, Relation::EqualTo, 50, 3);
+  tableau.AddConstraint(gap, Relation::EqualTo, 8, 3); // Also in "wide".
+  tableau.EndGroup();
+
+  tableau.DisableGroup("narrow");
+  tableau.Solve();
+  EXPECT_TRUE(tableau.IsGroupEnabled("wide"));
+  EXPECT_FALSE(tableau.IsGroupEnabled("narrow"));
+  EXPECT_NEAR(tableau.GetResult(sidebar), 200, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(gap), 8, 1e-6);
+  const TableauStats stats = tableau.GetStats();
+
+  // Switching keeps every row, nothing gets rebuilt.
+  tableau.DisableGroup("wide");
+  tableau.EnableGroup("narrow");
+  EXPECT_NEAR(tableau.GetResult(sidebar), 50, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(gap), 8, 1e-6);
+  EXPECT_EQ(tableau.GetStats().rows, stats.rows);
+  EXPECT_EQ(tableau.GetStats().addedConstraints, stats.addedConstraints);
+
+  tableau.DisableGroup("narrow");
+  EXPECT_NEAR(tableau.GetResult(sidebar), 100, 1e-6);
+  EXPECT_NEAR(tableau.GetResult(gap), 0, 1e-6);
+
+  tableau.EnableGroup("wide");
+  EXPECT_NEAR(tableau.GetResult(sidebar), 200, 1e-6);
+
+  tableau.BeginGroup("wide");
+  EXPECT_THROW(tableau.AddConstraint(sidebar, Relation::GreaterThanOrEqualTo, 0), std::runtime_error);
+  tableau.EndGroup();
+  EXPECT_THROW(tableau.EnableGroup("missing"), std::runtime_error);
+}
+
+// Mirrors View::UpdateIntrinsicSizeConstraints()
+TEST(TableauTest, IntrinsicSizeEditVariables) {
+  Box window, text;
+  Tableau2 tableau;
+  window.AddDerivedVariables(tableau);
+  text.AddDerivedVariables(tableau);
+  tableau.AddConstraint(window.GetLeftVar(), Relation::EqualTo, 0, Tableau2::REQUIRED - 1);
+  tableau.AddConstraint(window.GetWidthVar(), Relation::EqualTo, 300, Tableau2::REQUIRED - 1);
+  tableau.AddConstraint(text.GetLeftVar(), Relation::EqualTo, window.GetLeftVar());
+  tableau.AddConstraint(text.GetRightVar(), Relation::LessThanOrEqualTo, window.GetRightVar());
+  const size_t rowsBefore = tableau.GetStats().rows;
+
+  // Same as View::UpdateIntrinsicSizeConstraints(). One row per axis.
+  tableau.AddConstraint(text.GetWidthVar(), Relation::EqualTo, 120, 1);
+  tableau.Solve();
+  EXPECT_NEAR(tableau.GetResult(text.GetWidthVar()), 120, 1e-6);
+  const TableauStats stats = tableau.GetStats();
+  EXPECT_EQ(stats.rows, rowsBefore + 1);
+
+  // Content grows past the window, then shrinks again.
+  for (double width : {200.0, 500.0, 80.0}) {
+    tableau.UpdateConstraint(text.GetWidthVar(), width);
+    tableau.FinishUpdates();
+    tableau.Solve();
+    EXPECT_NEAR(tableau.GetResult(text.GetWidthVar()), std::min(width, 300.0), 1e-6);
+    EXPECT_EQ(tableau.GetStats().rows, stats.rows);
+    EXPECT_EQ(tableau.GetStats().addedConstraints, stats.addedConstraints);
+  }
+}
+
+// A frame can both add a constraint and update an edit variable before
+// WindowRoot::SolveLayout() finishes the updates and solves.
+TEST(TableauTest, EditAfterAddingConstraint) {
+  for (TableauBackend backend : {TableauBackend::Sparse, TableauBackend::Dense}) {
+    Variable x("x"), y("y");
+    Tableau2 tableau;
+    tableau.SetBackend(backend);
+    tableau.AddConstraint(x, Relation::LessThanOrEqualTo, 100);
+    tableau.AddConstraint(x, Relation::EqualTo, 10, Tableau2::WEAK); // Edit Var
+    tableau.Solve();
+    EXPECT_NEAR(tableau.GetResult(x), 10, 1e-6);
+
+    // Violated when added, and x + y = 5 leaves x the edit var.
+    tableau.AddConstraint(x + y, Relation::EqualTo, 5, Tableau2::STRONG);
+    tableau.UpdateConstraint(x, 200);
+    tableau.FinishUpdates();
+    tableau.Solve();
+    EXPECT_NEAR(tableau.GetResult(x), 5, 1e-6);
+
+    // Same as solving from scratch.
+    Tableau2 fresh;
+    fresh.SetBackend(backend);
+    fresh.AddConstraint(x, Relation::LessThanOrEqualTo, 100);
+    fresh.AddConstraint(x, Relation::EqualTo, 200, Tableau2::WEAK);
+    fresh.AddConstraint(x + y, Relation::EqualTo, 5, Tableau2::STRONG);
+    fresh.Solve();
+    EXPECT_NEAR(fresh.GetResult(x), 5, 1e-6);
+
+    // And the other way around, an edit pending when a row is added.
+    tableau.UpdateConstraint(x, 0);
+    tableau.AddConstraint(y, Relation::GreaterThanOrEqualTo, 7);
+    tableau.FinishUpdates();
+    tableau.Solve();
+    EXPECT_NEAR(tableau.GetResult(x), 0, 1e-6);
+    EXPECT_NEAR(tableau.GetResult(y), 7, 1e-6);
+  }
+}
+
+// Mirrors WindowRoot::CompileLayout()
+TEST(TableauTest, ParametricLayout) {
+  Box window, sidebar, content;
+  Variable header("Header");
+  Tableau2 tableau;
+  window.AddDerivedVariables(tableau);
+  sidebar.AddDerivedVariables(tableau);
+  content.AddDerivedVariables(tableau);
+  constexpr int Edit = Tableau2::REQUIRED - 1;
+  tableau.AddConstraint(window.GetLeftVar(), Relation::EqualTo, 0, Edit);
+  tableau.AddConstraint(window.GetTopVar(), Relation::EqualTo, 0, Edit);
+  tableau.AddConstraint(window.GetWidthVar(), Relation::EqualTo, 799, Edit);
+  tableau.AddConstraint(window.GetRightVar(), Relation::EqualTo, 799, Edit);
+  tableau.AddConstraint(window.GetHeightVar(), Relation::EqualTo, 599, Edit);
+  tableau.AddConstraint(window.GetBottomVar(), Relation::EqualTo, 599, Edit);
+  for (const auto& var : { window.GetWidthVar(), window.GetRightVar(),
+                           window.GetHeightVar(), window.GetBottomVar() }) {
+    tableau.AddInputVariable(var);
+  }
+
+  // Sidebar takes a quarter of the window, clamped to [80, 300].
+  tableau.AddConstraint(sidebar.GetLeftVar(), Relation::EqualTo, window.GetLeftVar());
+  tableau.AddConstraint(sidebar.GetTopVar(), Relation::EqualTo, window.GetTopVar());
+  tableau.AddConstraint(sidebar.GetHeightVar(), Relation::EqualTo, window.GetHeightVar());
+  tableau.AddConstraint(sidebar.GetWidthVar(), Relation::EqualTo, 0.25 * window.GetWidthVar(), 3);
+  tableau.AddConstraint(sidebar.GetWidthVar(), Relation::GreaterThanOrEqualTo, 80);
+  tableau.AddConstraint(sidebar.GetWidthVar(), Relation::LessThanOrEqualTo, 300);
+
+  // Content fills the rest, below a header of at least 40.
+  tableau.AddConstraint(header, Relation::EqualTo, 0.1 * window.GetHeightVar(), 3);
+  tableau.AddConstraint(header, Relation::GreaterThanOrEqualTo, 40);
+  tableau.AddConstraint(content.GetLeftVar(), Relation::EqualTo, sidebar.GetRightVar());
+  tableau.AddConstraint(content.GetRightVar(), Relation::EqualTo, window.GetRightVar());
+  tableau.AddConstraint(content.GetTopVar(), Relation::EqualTo, window.GetTopVar() + header);
+  tableau.AddConstraint(content.GetBottomVar(), Relation::EqualTo, window.GetBottomVar());
+
+  auto setSize = [&](int width, int height) {
+    tableau.UpdateConstraint(window.GetWidthVar(), width - 1);
+    tableau.UpdateConstraint(window.GetRightVar(), width - 1);
+    tableau.UpdateConstraint(window.GetHeightVar(), height - 1);
+    tableau.UpdateConstraint(window.GetBottomVar(), height - 1);
+    tableau.FinishUpdates();
+  };
+  auto liveRect = [&](const Box& box) {
+    LayoutRect rect;
+    rect.left = ToPixel(tableau.GetResult(box.GetLeftVar()));
+    rect.top = ToPixel(tableau.GetResult(box.GetTopVar()));
+    rect.width = ToPixel(tableau.GetResult(box.GetWidthVar()));
+    rect.height = ToPixel(tableau.GetResult(box.GetHeightVar()));
+    return rect;
+  };
+
+  ParametricLayout layout;
+  const Box* boxes[] = { &sidebar, &content };
+  for (const Box* box : boxes) {
+    layout.AddRect(box->GetLeftVar(), box->GetTopVar(), box->GetWidthVar(), box->GetHeightVar());
+  }
+  tableau.Solve();
+  layout.Compile(tableau, { window.GetWidthVar(), window.GetRightVar() },
+                 { window.GetHeightVar(), window.GetBottomVar() },
+                 setSize, 200, 2000, 200, 1200, 64);
+  ASSERT_TRUE(layout.IsValid(tableau));
+  // One region per clamp combination of sidebar and header.
+  EXPECT_LE(layout.GetRegionCount(), 6u);
+
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> widths(200, 2000), heights(200, 1200);
+  for (int i=0; i<200; i++) {
+    const int width = widths(rng), height = heights(rng);
+    const size_t region = layout.FindRegion(width, height);
+    ASSERT_NE(region, ParametricLayout::npos);
+    setSize(width, height);
+    for (size_t b=0; b<2; b++) {
+      const LayoutRect compiled = layout.GetRect(region, b, width, height);
+      const LayoutRect live = liveRect(*boxes[b]);
+      EXPECT_EQ(compiled.left, live.left);
+      EXPECT_EQ(compiled.top, live.top);
+      EXPECT_EQ(compiled.width, live.width);
+      EXPECT_EQ(compiled.height, live.height);
+    }
+  }
+  // Window size edits keep the layout, anything else invalidates it.
+  EXPECT_TRUE(layout.IsValid(tableau));
+  tableau.AddConstraint(header, Relation::LessThanOrEqualTo, 100);
+  EXPECT_FALSE(layout.IsValid(tableau));
+}
+
+// Toolbar: 32x32 icon at (8, 8), then a label filling up to x=200
+// with a 4px gap, vertically centered on the icon.
+constexpr auto kToolbarRects = StaticLayout<2, 8>()
+    .Add(0, BoxAttribute::Left, 8)
+    .Add(0, BoxAttribute::Top, 8)
+    .Add(0, BoxAttribute::Width, 32)
+    .Add(0, BoxAttribute::Height, 32)
+    .Add(1, BoxAttribute::Left, 0, BoxAttribute::Right, 1.0, 4)
+    .Add(1, BoxAttribute::Right, 200)
+    .Add(1, BoxAttribute::Height, 0, BoxAttribute::Height, 0.5)
+    .Add(1, BoxAttribute::CenterY, 0, BoxAttribute::CenterY)
+    .Solve();
+static_assert(kToolbarRects[0].left == 8 && kToolbarRects[0].width == 32, "Pinned icon");
+static_assert(kToolbarRects[1].left == 44 && kToolbarRects[1].width == 156, "Label follows icon");
+static_assert(kToolbarRects[1].top == 16 && kToolbarRects[1].height == 16, "Label centered on icon");
+
+// Label 10.5px left of and a quarter pixel above its icon, which sits at (4, 4).
+constexpr auto kOffsetRects = StaticLayout<2, 8>()
+    .Add(0, BoxAttribute::Left, 4)
+    .Add(0, BoxAttribute::Top, 4)
+    .Add(0, BoxAttribute::Width, 16)
+    .Add(0, BoxAttribute::Height, 16)
+    .Add(1, BoxAttribute::Left, 0, BoxAttribute::Left, 1.0, -10.5)
+    .Add(1, BoxAttribute::Top, 0, BoxAttribute::Top, 1.0, -0.25)
+    .Add(1, BoxAttribute::Width, 8)
+    .Add(1, BoxAttribute::Height, 8)
+    .Solve();
+static_assert(kOffsetRects[1].left == -7 && kOffsetRects[1].top == 3, "Offsets round down");
+
+TEST(StaticLayoutTest, NegativeOffsetsRoundDown) {
+  EXPECT_EQ(ToPixel(2.5), 2);
+  EXPECT_EQ(ToPixel(2.9999999), 3); // Float noise.
+  EXPECT_EQ(ToPixel(-0.5), -1);
+  EXPECT_EQ(ToPixel(-2.5), -3);
+  EXPECT_EQ(ToPixel(-2.0000001), -2);
+  EXPECT_EQ(kOffsetRects[1].left, ToPixel(4 - 10.5));
+  EXPECT_EQ(kOffsetRects[1].top, ToPixel(4 - 0.25));
+}
+
+TEST(StaticLayoutTest, MatchesTableau) {
+  Box icon, label;
+  Tableau2 tableau;
+  icon.AddDerivedVariables(tableau);
+  label.AddDerivedVariables(tableau);
+  tableau.AddConstraint(icon.GetLeftVar(), Relation::EqualTo, 8);
+  tableau.AddConstraint(icon.GetTopVar(), Relation::EqualTo, 8);
+  tableau.AddConstraint(icon.GetWidthVar(), Relation::EqualTo, 32);
+  tableau.AddConstraint(icon.GetHeightVar(), Relation::EqualTo, 32);
+  tableau.AddConstraint(label.GetLeftVar(), Relation::EqualTo, icon.GetRightVar() + 4.0);
+  tableau.AddConstraint(label.GetRightVar(), Relation::EqualTo, 200);
+  tableau.AddConstraint(label.GetHeightVar(), Relation::EqualTo, 0.5 * icon.GetHeightVar());
+  tableau.AddConstraint(label.GetCenterYVar(), Relation::EqualTo, icon.GetCenterYVar());
+  tableau.Solve();
+
+  const Box* boxes[] = { &icon, &label };
+  for (size_t b=0; b<2; b++) {
+    EXPECT_EQ(kToolbarRects[b].left, ToPixel(tableau.GetResult(boxes[b]->GetLeftVar())));
+    EXPECT_EQ(kToolbarRects[b].top, ToPixel(tableau.GetResult(boxes[b]->GetTopVar())));
+    EXPECT_EQ(kToolbarRects[b].width, ToPixel(tableau.GetResult(boxes[b]->GetWidthVar())));
+    EXPECT_EQ(kToolbarRects[b].height, ToPixel(tableau.GetResult(boxes[b]->GetHeightVar())));
+  }
+
+  // Missing the height: no unique solution.
+  auto layout = StaticLayout<1, 5>()
+      .Add(0, BoxAttribute::Left, 0)
+      .Add(0, BoxAttribute::Top, 0)
+      .Add(0, BoxAttribute::Width, 10);
+  EXPECT_THROW(layout.Solve(), std::runtime_error);
+  layout.Add(0, BoxAttribute::Height, 10);
+  EXPECT_EQ(layout.Solve()[0].height, 10);
+  layout.Add(0, BoxAttribute::Right, 20); // Contradicts Width.
+  EXPECT_THROW(layout.Solve(), std::runtime_error);
+}
+
+// Mirrors the list rows in app.cpp
+TEST(ConstraintTemplateTest, MatchesAddConstraint) {
+  constexpr size_t RowCount = 50;
+  Box list;
+  std::vector<std::unique_ptr<Box>> rows;
+  for (size_t i=0; i<RowCount; i++) {
+    rows.push_back(std::make_unique<Box>());
+  }
+
+  ConstraintTemplate rowTemplate(3); // 0: Row, 1: Row above, 2: List
+  const Box& row = rowTemplate.GetBox(0);
+  const Box& rowAbove = rowTemplate.GetBox(1);
+  const Box& tList = rowTemplate.GetBox(2);
+  rowTemplate.AddConstraint(row.GetLeftVar(), Relation::EqualTo, tList.GetLeftVar());
+  rowTemplate.AddConstraint(row.GetRightVar(), Relation::EqualTo, tList.GetRightVar());
+  rowTemplate.AddConstraint(row.GetTopVar(), Relation::EqualTo, rowAbove.GetBottomVar());
+  rowTemplate.AddConstraint(row.GetHeightVar(), Relation::GreaterThanOrEqualTo, 20);
+  rowTemplate.AddConstraint(row.GetHeightVar(), Relation::EqualTo, 0.5 * tList.GetWidthVar(), Tableau2::WEAK);
+  EXPECT_THROW(rowTemplate.AddConstraint(row.GetWidthVar(), Relation::EqualTo, 10, Tableau2::WEAK), std::runtime_error);
+
+  Tableau2 templated, plain;
+  for (Tableau2* tableau : { &templated, &plain }) {
+    list.AddDerivedVariables(*tableau);
+    for (auto& r : rows) {
+      r->AddDerivedVariables(*tableau);
+    }
+    tableau->AddConstraint(list.GetLeftVar(), Relation::EqualTo, 10);
+    tableau->AddConstraint(list.GetTopVar(), Relation::EqualTo, 5);
+    tableau->AddConstraint(list.GetWidthVar(), Relation::EqualTo, 30);
+    tableau->AddConstraint(rows[0]->GetTopVar(), Relation::EqualTo, list.GetTopVar());
+  }
+  for (size_t i=1; i<RowCount; i++) {
+    const Box& r = *rows[i];
+    const Box& above = *rows[i - 1];
+    rowTemplate.Instantiate(templated, { &r, &above, &list });
+    plain.AddConstraint(r.GetLeftVar(), Relation::EqualTo, list.GetLeftVar());
+    plain.AddConstraint(r.GetRightVar(), Relation::EqualTo, list.GetRightVar());
+    plain.AddConstraint(r.GetTopVar(), Relation::EqualTo, above.GetBottomVar());
+    plain.AddConstraint(r.GetHeightVar(), Relation::GreaterThanOrEqualTo, 20);
+    plain.AddConstraint(r.GetHeightVar(), Relation::EqualTo, 0.5 * list.GetWidthVar(), Tableau2::WEAK);
+  }
+  templated.Solve();
+  plain.Solve();
+
+  EXPECT_EQ(templated.GetStats().addedConstraints, plain.GetStats().addedConstraints);
+  for (size_t i=1; i<RowCount; i++) {
+    const Box& r = *rows[i];
+    for (const auto& var : { r.GetLeftVar(), r.GetTopVar(), r.GetWidthVar(), r.GetHeightVar() }) {
+      EXPECT_NEAR(templated.GetResult(var), plain.GetResult(var), 1e-6);
+    }
+    EXPECT_NEAR(templated.GetResult(r.GetTopVar()), 5 + 20 * (i - 1), 1e-6); // rows[0] has no height.
+  }
+}
+
+TEST(LayoutCacheTest, LeastRecentlyUsedEviction) {
+  LayoutCache cache;
+  EXPECT_EQ(cache.Insert(800, 600, 1, { LayoutRect() }), nullptr); // Disabled by default.
+  EXPECT_EQ(cache.Find(800, 600, 1), nullptr);
+
+  cache.SetCapacity(2);
+  LayoutRect rect;
+  rect.width = 800;
+  cache.Insert(800, 600, 1, { rect });
+  rect.width = 1024;
+  cache.Insert(1024, 768, 1, { rect });
+  ASSERT_NE(cache.Find(800, 600, 1), nullptr);
+  EXPECT_EQ((*cache.Find(800, 600, 1))[0].width, 800);
+
+  // 1024x768 is now the least recently used.
+  cache.Insert(640, 480, 1, { rect });
+  EXPECT_EQ(cache.GetSize(), 2u);
+  EXPECT_EQ(cache.Find(1024, 768, 1), nullptr);
+  EXPECT_NE(cache.Find(800, 600, 1), nullptr);
+  EXPECT_NE(cache.Find(640, 480, 1), nullptr);
+
+  // Same size, newer constraints.
+  EXPECT_EQ(cache.Find(800, 600, 2), nullptr);
+  EXPECT_EQ(cache.GetHitCount(), 4u);
+  EXPECT_EQ(cache.GetMissCount(), 2u);
+
+  cache.SetCapacity(1);
+  EXPECT_EQ(cache.GetSize(), 1u);
+  EXPECT_NE(cache.Find(640, 480, 1), nullptr);
+}
+
+namespace {
+
+// A list of 'rowCount' rows, each 20 high, under a 300 wide header.
+// Returns every row's top, plus the codes of the first row's variables.
+std::pair<std::vector<double>, std::vector<int>> BuildList(size_t rowCount, WorkerPool* pool) {
+  Box header;
+  std::vector<std::unique_ptr<Box>> rows;
+  for (size_t i=0; i<rowCount; i++) {
+    rows.push_back(std::make_unique<Box>());
+  }
+  Tableau2 tableau;
+  tableau.SetBackend(TableauBackend::Sparse);
+  tableau.SetParallelPivot(pool, 1);
+  header.AddDerivedVariables(tableau);
+  tableau.AddConstraint(header.GetLeftVar(), Relation::EqualTo, 0);
+  tableau.AddConstraint(header.GetTopVar(), Relation::EqualTo, 0);
+  tableau.AddConstraint(header.GetHeightVar(), Relation::EqualTo, 40, Tableau2::STRONG);
+  tableau.AddConstraint(header.GetWidthVar(), Relation::EqualTo, 300, Tableau2::STRONG);
+  const Box* above = &header;
+  for (auto& row : rows) {
+    row->AddDerivedVariables(tableau);
+    tableau.AddConstraint(row->GetLeftVar(), Relation::EqualTo, header.GetLeftVar());
+    tableau.AddConstraint(row->GetWidthVar(), Relation::EqualTo, header.GetWidthVar());
+    tableau.AddConstraint(row->GetTopVar(), Relation::EqualTo, above->GetBottomVar());
+    tableau.AddConstraint(row->GetHeightVar(), Relation::GreaterThanOrEqualTo, 20);
+    tableau.AddConstraint(row->GetHeightVar(), Relation::EqualTo, 0, Tableau2::WEAK);
+    above = row.get();
+  }
+  tableau.Solve();
+
+  std::pair<std::vector<double>, std::vector<int>> result;
+  for (auto& row : rows) {
+    result.first.push_back(tableau.GetResult(row->GetTopVar()));
+  }
+  for (const auto& var : { header.GetLeftVar(), rows[0]->GetLeftVar(), rows[0]->GetBottomVar() }) {
+    result.second.push_back(var.GetCode());
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(ConcurrencyTest, ConcurrentTableauConstruction) {
+  constexpr size_t ThreadCount = 4;
+  constexpr size_t RowCount = 30;
+  WorkerPool pool(2);
+
+  std::vector<std::pair<std::vector<double>, std::vector<int>>> results(ThreadCount);
+  std::vector<std::thread> threads;
+  for (size_t t=0; t<ThreadCount; t++) {
+    threads.emplace_back([&, t] {
+      VariableCodeScope scope;
+      results[t] = BuildList(RowCount, &pool);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::pair<std::vector<double>, std::vector<int>> expected;
+  {
+    VariableCodeScope scope;
+    expected = BuildList(RowCount, nullptr);
+  }
+  EXPECT_EQ(expected.second[0], VariableCodeScope::kFirstCode);
+  for (const auto& result : results) {
+    EXPECT_EQ(result.second, expected.second); // Same codes on every thread.
+    ASSERT_EQ(result.first.size(), RowCount);
+    for (size_t i=0; i<RowCount; i++) {
+      EXPECT_NEAR(result.first[i], 40 + 20.0 * i, 1e-6);
+    }
+  }
+}
+
+TEST(ConcurrencyTest, UniqueGlobalCodes) {
+  constexpr size_t ThreadCount = 4;
+  constexpr size_t CodeCount = 10000;
+  std::vector<std::vector<int>> codes(ThreadCount);
+  std::vector<std::thread> threads;
+  for (size_t t=0; t<ThreadCount; t++) {
+    threads.emplace_back([&codes, t] {
+      for (size_t i=0; i<CodeCount; i++) {
+        codes[t].push_back(Variable("V").GetCode());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::unordered_set<int> unique;
+  for (const auto& threadCodes : codes) {
+    unique.insert(threadCodes.begin(), threadCodes.end());
+  }
+  EXPECT_EQ(unique.size(), ThreadCount * CodeCount);
+}
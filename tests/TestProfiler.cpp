@@ -0,0 +1,116 @@
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../Profiler.h"
+
+// Zones are recorded through Profiler::Zone, which works with or
+// without ENABLE_PROFILER. Only the macros compile away.
+
+static size_t CountOf(const std::string& str, const std::string& what) {
+  size_t count = 0;
+  for (size_t pos = str.find(what); pos != std::string::npos; pos = str.find(what, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+// Of the first zone named 'name'. -1 if there's none.
+static int TidOf(const std::string& trace, const std::string& name) {
+  const std::string prefix = "\"name\":\"" + name + "\",\"pid\":0,\"tid\":";
+  const size_t pos = trace.find(prefix);
+  return pos == std::string::npos ? -1 : atoi(trace.c_str() + pos + prefix.size());
+}
+
+static std::string Trace() {
+  std::ostringstream out;
+  Profiler::WriteChromeTrace(out);
+  return out.str();
+}
+
+TEST(ProfilerTest, WritesNestedZonesAsCompleteEvents) {
+  Profiler::Clear();
+  {
+    Profiler::Zone outer("Outer");
+    Profiler::Zone inner("Inner", 42);
+  }
+  const std::string trace = Trace();
+  EXPECT_EQ(trace.find("{\"traceEvents\":["), 0u);
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"X\""), 2u);
+  EXPECT_NE(trace.find("\"name\":\"Outer\""), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"Inner\""), std::string::npos);
+  EXPECT_NE(trace.find("\"args\":{\"arg\":42}"), std::string::npos);
+  EXPECT_EQ(CountOf(trace, "\"args\":{\"arg\""), 1u); // Outer has none.
+}
+
+TEST(ProfilerTest, EachThreadGetsItsTrack) {
+  Profiler::Clear();
+  Profiler::Record("Main Zone", 1000, 2000);
+  std::thread thread([]() {
+    Profiler::SetThreadName("Other \"Thread\"");
+    Profiler::Record("Other Zone", 1500, 1800);
+  });
+  thread.join();
+
+  const std::string trace = Trace();
+  EXPECT_NE(trace.find("\"ts\":1.0,\"dur\":1.0"), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"thread_name\""), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"Other \\\"Thread\\\"\""), std::string::npos);
+
+  // Different tids.
+  EXPECT_NE(TidOf(trace, "Main Zone"), -1);
+  EXPECT_NE(TidOf(trace, "Other Zone"), -1);
+  EXPECT_NE(TidOf(trace, "Main Zone"), TidOf(trace, "Other Zone"));
+}
+
+TEST(ProfilerTest, TracksAreNamedAndApartFromThreads) {
+  Profiler::Clear();
+  Profiler::Track* gpu = Profiler::AddTrack("GPU");
+  Profiler::Record(gpu, "GPU Frame", 3000, 5000, 7);
+  Profiler::Record("CPU Frame", 1000, 4000);
+
+  const std::string trace = Trace();
+  EXPECT_NE(trace.find("\"args\":{\"name\":\"GPU\"}"), std::string::npos);
+  EXPECT_NE(trace.find("\"ts\":3.0,\"dur\":2.0,\"args\":{\"arg\":7}"), std::string::npos);
+  EXPECT_NE(TidOf(trace, "GPU Frame"), -1);
+  EXPECT_NE(TidOf(trace, "GPU Frame"), TidOf(trace, "CPU Frame"));
+}
+
+TEST(ProfilerTest, RingKeepsMostRecentZones) {
+  Profiler::Clear();
+  for (uint32_t i = 0; i < Profiler::kZonesPerThread + 10; i++) {
+    Profiler::Record(i < 10 ? "Dropped" : "Kept", i, i + 1);
+  }
+  const std::string trace = Trace();
+  EXPECT_EQ(CountOf(trace, "\"name\":\"Dropped\""), 0u);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"Kept\""), Profiler::kZonesPerThread);
+}
+
+TEST(ProfilerTest, ClearDropsRecordedZones) {
+  Profiler::Record("Before", 0, 1);
+  Profiler::Clear();
+  Profiler::Record("After", 2, 3);
+  const std::string trace = Trace();
+  EXPECT_EQ(trace.find("\"name\":\"Before\""), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"After\""), std::string::npos);
+}
+
+TEST(ProfilerTest, DumpsWhileOtherThreadsRecord) {
+  Profiler::Clear();
+  std::atomic<bool> stop{false};
+  std::thread writer([&]() {
+    uint64_t t = 0;
+    while (!stop.load()) {
+      Profiler::Record("Busy", t, t + 1);
+      t++;
+    }
+  });
+  for (int i = 0; i < 20; i++) {
+    const std::string trace = Trace();
+    EXPECT_EQ(trace.compare(trace.size() - 3, 3, "\"}\n"), 0);
+  }
+  stop.store(true);
+  writer.join();
+}
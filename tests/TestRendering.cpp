@@ -0,0 +1,608 @@
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../CommandState.h"
+#include "../DamageTracker.h"
+#include "../DisplayList.h"
+#include "../DrawBatcher.h"
+#include "../SkylinePacker.h"
+#include "../SoftwareRenderer.h"
+#include "../WorkerPool.h"
+
+// Rendering pieces that don't need a GPU.
+
+static const float kRed[4] = {1.f, 0.f, 0.f, 1.f};
+static const float kBlue[4] = {0.f, 0.f, 1.f, 1.f};
+static const float kWhite[4] = {1.f, 1.f, 1.f, 1.f};
+static const ClipRect kWindow = {0, 0, 1000, 1000};
+
+static std::vector<uint32_t> OrderedOps(const DisplayList& list,
+                                        const ClipRect& root = kWindow) {
+  std::vector<DisplayList::Item> items;
+  list.Order(root, items);
+  std::vector<uint32_t> ops;
+  for (const auto& item : items) {
+    ops.push_back(item.opIdx);
+  }
+  return ops;
+}
+
+TEST(ArenaTest, ReusesBlocksAfterReset) {
+  Arena arena(256);
+  void* first = arena.Allocate(100);
+  arena.Allocate(100);
+  arena.Allocate(100); // Second block.
+  EXPECT_EQ(arena.GetBytesUsed(), 300);
+
+  arena.Reset();
+  EXPECT_EQ(arena.GetBytesUsed(), 0);
+  EXPECT_EQ(arena.Allocate(100), first);
+
+  // Larger than a block.
+  void* large = arena.Allocate(1000, 64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % 64, 0);
+  memset(large, 0, 1000);
+}
+
+TEST(DisplayListTest, MergesNonOverlappingRuns) {
+  // Boxes: fill then outline, side by side. Each box's outline overlaps
+  // its own fill, but not the other boxes.
+  DisplayList list;
+  for (int i=0; i<100; i++) {
+    ClipRect box = {i * 10, 0, i * 10 + 5, 5};
+    list.AddRect(box, kRed);
+    list.AddOutline(box, kBlue, 1.0f);
+  }
+
+  std::vector<uint32_t> ops = OrderedOps(list);
+  ASSERT_EQ(ops.size(), 200);
+  // All fills first, then all outlines, each in issue order.
+  for (int i=0; i<100; i++) {
+    EXPECT_EQ(ops[i], 2 * i);
+    EXPECT_EQ(ops[100 + i], 2 * i + 1);
+  }
+}
+
+TEST(DisplayListTest, KeepsOverlapOrder) {
+  DisplayList list;
+  list.AddRect({0, 0, 100, 100}, kRed);             // 0
+  list.AddOutline({0, 0, 100, 100}, kBlue, 1);      // 1
+  list.AddRect({0, 0, 10, 10}, kRed);               // 2: Over the outline, stays after it.
+  list.AddOutline({200, 200, 210, 210}, kBlue, 1);  // 3: Joins 1, ahead of 2.
+  list.AddRect({300, 300, 310, 310}, kRed);         // 4: Joins 2.
+
+  EXPECT_EQ(OrderedOps(list), (std::vector<uint32_t>{0, 1, 3, 2, 4}));
+}
+
+TEST(DisplayListTest, BatchesAcrossResources) {
+  const float coords[8] = {0, 0, 1, 0, 1, 1, 0, 1};
+  DisplayList list;
+  list.AddTexturedRect(1, {0, 0, 10, 10}, kRed, coords);   // 0
+  list.AddText(7, "ab", 2, 0, 30, {0, 20, 20, 30}, kRed);  // 1
+  list.AddTexturedRect(2, {20, 0, 30, 10}, kRed, coords);  // 2
+  list.AddText(8, "cd", 2, 30, 30, {30, 20, 50, 30}, kRed);// 3
+  list.AddTexturedRect(1, {40, 0, 50, 10}, kRed, coords);  // 4
+  list.AddText(7, "ef", 2, 60, 30, {60, 20, 80, 30}, kRed);// 5
+
+  // Batched by type, whatever their image or font.
+  EXPECT_EQ(OrderedOps(list), (std::vector<uint32_t>{0, 2, 4, 1, 3, 5}));
+  EXPECT_EQ(std::string(static_cast<const char*>(list.GetOps()[5].payload), 2), "ef");
+}
+
+TEST(DisplayListTest, ResolvesAndCullsScissors) {
+  DisplayList list;
+  list.PushScissor({0, 0, 100, 100});
+  list.AddRect({10, 10, 20, 20}, kRed);   // 1
+  list.PushScissor({50, 50, 200, 200});   //   Intersected with the enclosing one.
+  list.AddRect({10, 10, 20, 20}, kRed);   // 3: Outside, culled.
+  list.AddRect({40, 40, 60, 60}, kRed);   // 4
+  list.PopScissor();
+  list.PopScissor();
+  list.PopScissor();                      //   Unbalanced pops stop at the root.
+  list.AddRect({-50, 10, 20, 20}, kRed);  // 8
+
+  std::vector<DisplayList::Item> items;
+  list.Order({0, 0, 500, 500}, items);
+  ASSERT_EQ(items.size(), 3);
+  EXPECT_EQ(items[0].opIdx, 1);
+  EXPECT_EQ(items[0].scissor, (ClipRect{0, 0, 100, 100}));
+  EXPECT_EQ(items[1].opIdx, 4);
+  EXPECT_EQ(items[1].scissor, (ClipRect{50, 50, 100, 100}));
+  EXPECT_EQ(items[2].opIdx, 8);
+  EXPECT_EQ(items[2].scissor, (ClipRect{0, 0, 500, 500}));
+}
+
+TEST(DisplayListTest, DifferentScissorsDontBatch) {
+  DisplayList list;
+  list.PushScissor({0, 0, 50, 50});
+  list.AddRect({0, 0, 10, 10}, kRed);   // 1
+  list.PopScissor();
+  list.AddRect({60, 60, 70, 70}, kRed); // 3
+  list.PushScissor({0, 0, 50, 50});
+  list.AddRect({20, 20, 30, 30}, kRed); // 5
+  list.PopScissor();
+
+  EXPECT_EQ(OrderedOps(list), (std::vector<uint32_t>{1, 5, 3}));
+}
+
+TEST(DisplayListTest, AppendCopiesPayloads) {
+  DisplayList list;
+  {
+    DisplayList other;
+    const std::string text = "hello";
+    other.AddText(1, text.data(), text.size(), 0, 10, {0, 0, 50, 10}, kRed);
+    list.AddRect({0, 0, 1, 1}, kRed);
+    list.Append(other);
+  }
+  ASSERT_EQ(list.GetSize(), 2);
+  const DrawOp& op = list.GetOps()[1];
+  EXPECT_EQ(op.type, DrawOpType::Text);
+  EXPECT_EQ(std::string(static_cast<const char*>(op.payload), op.payloadSize), "hello");
+}
+
+TEST(DisplayListTest, AppendSharedReferencesPayloads) {
+  DisplayList cached;
+  cached.AddText(1, "hi", 2, 0, 10, {0, 0, 20, 10}, kRed);
+
+  DisplayList frame;
+  frame.AppendShared(cached);
+  frame.AppendShared(cached);
+  ASSERT_EQ(frame.GetSize(), 2);
+  EXPECT_EQ(frame.GetOps()[0].payload, cached.GetOps()[0].payload);
+  EXPECT_EQ(frame.GetOps()[1].payload, cached.GetOps()[0].payload);
+}
+
+TEST(DamageTrackerTest, FirstFrameDamagesWindow) {
+  DisplayList list;
+  list.AddRect({10, 10, 20, 20}, kRed);
+
+  DamageTracker tracker;
+  tracker.Track(&list, list.GetOps().data(), list.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), kWindow);
+
+  // Nothing changed.
+  tracker.Track(&list, list.GetOps().data(), list.GetSize());
+  EXPECT_TRUE(tracker.EndFrame(kWindow).IsEmpty());
+
+  tracker.Invalidate();
+  tracker.Track(&list, list.GetOps().data(), list.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), kWindow);
+}
+
+TEST(DamageTrackerTest, CaretOnlyDamagesCaret) {
+  // A text field: background, text before and after a blinking caret.
+  auto field = [](bool caretIsOn) {
+    DisplayList list;
+    list.AddRect({0, 0, 200, 20}, kBlue);
+    list.AddText(1, "ab", 2, 0, 15, {0, 2, 20, 18}, kRed);
+    if (caretIsOn) list.AddRect({20, 2, 22, 18}, kRed);
+    list.AddText(1, "cd", 2, 27, 15, {27, 2, 47, 18}, kRed);
+    return list;
+  };
+  DisplayList on = field(true), off = field(false);
+
+  DamageTracker tracker;
+  tracker.Track(&tracker, off.GetOps().data(), off.GetSize());
+  tracker.EndFrame(kWindow);
+
+  tracker.Track(&tracker, on.GetOps().data(), on.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), (ClipRect{20, 2, 22, 18}));
+  tracker.Track(&tracker, off.GetOps().data(), off.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), (ClipRect{20, 2, 22, 18}));
+}
+
+TEST(DamageTrackerTest, ChangedOpDamagesOldAndNewBounds) {
+  DisplayList before, after;
+  before.AddText(1, "old", 3, 0, 15, {0, 0, 30, 20}, kRed);
+  before.AddRect({100, 100, 110, 110}, kRed);
+  after.AddText(1, "new line", 8, 0, 45, {0, 30, 80, 50}, kRed);
+  after.AddRect({100, 100, 110, 110}, kRed);
+
+  DamageTracker tracker;
+  tracker.Track(&tracker, before.GetOps().data(), before.GetSize());
+  tracker.EndFrame(kWindow);
+  tracker.Track(&tracker, after.GetOps().data(), after.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), (ClipRect{0, 0, 80, 50}));
+}
+
+TEST(DamageTrackerTest, ScissorsClipDamage) {
+  // Scrolled content: same ops, moved scissor.
+  auto scrolled = [](int32_t top) {
+    DisplayList list;
+    list.PushScissor({0, 0, 100, 100});
+    list.AddRect({0, top, 100, top + 300}, kRed);
+    list.PopScissor();
+    return list;
+  };
+  DisplayList first = scrolled(0), second = scrolled(-50);
+
+  DamageTracker tracker;
+  tracker.Track(&tracker, first.GetOps().data(), first.GetSize());
+  tracker.EndFrame(kWindow);
+  tracker.Track(&tracker, second.GetOps().data(), second.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), (ClipRect{0, 0, 100, 100}));
+}
+
+TEST(DamageTrackerTest, UntrackedKeysDamageWhatTheyDrew) {
+  DisplayList a, b;
+  a.AddRect({0, 0, 10, 10}, kRed);
+  b.AddRect({50, 50, 60, 60}, kRed);
+
+  DamageTracker tracker;
+  tracker.Track(&a, a.GetOps().data(), a.GetSize());
+  tracker.Track(&b, b.GetOps().data(), b.GetSize());
+  tracker.EndFrame(kWindow);
+
+  tracker.Track(&a, a.GetOps().data(), a.GetSize());
+  EXPECT_EQ(tracker.EndFrame(kWindow), (ClipRect{50, 50, 60, 60}));
+  tracker.Track(&a, a.GetOps().data(), a.GetSize());
+  EXPECT_TRUE(tracker.EndFrame(kWindow).IsEmpty());
+}
+
+TEST(SkylinePackerTest, PacksWithoutOverlap) {
+  SkylinePacker packer(256, 256);
+  std::vector<ClipRect> placed;
+  srand(7);
+  for (int i=0; i<200; i++) {
+    const int w = 4 + rand() % 28, h = 4 + rand() % 28;
+    int x, y;
+    if (!packer.Pack(w, h, x, y)) continue;
+    const ClipRect rect{x, y, x + w, y + h};
+    EXPECT_GE(x, 0);
+    EXPECT_GE(y, 0);
+    EXPECT_LE(rect.right, 256);
+    EXPECT_LE(rect.bottom, 256);
+    for (const ClipRect& other : placed) {
+      ASSERT_FALSE(rect.Overlaps(other));
+    }
+    placed.push_back(rect);
+  }
+  // Icon-sized rects should fill most of the page.
+  int area = 0;
+  for (const ClipRect& rect : placed) {
+    area += (rect.right - rect.left) * (rect.bottom - rect.top);
+  }
+  EXPECT_GT(area, 256 * 256 * 6 / 10);
+}
+
+TEST(SkylinePackerTest, FillsGapsBeforeGrowing) {
+  SkylinePacker packer(100, 100);
+  int x, y;
+  ASSERT_TRUE(packer.Pack(60, 50, x, y));
+  EXPECT_EQ(x, 0); EXPECT_EQ(y, 0);
+  ASSERT_TRUE(packer.Pack(40, 20, x, y)); // Right of the first.
+  EXPECT_EQ(x, 60); EXPECT_EQ(y, 0);
+  ASSERT_TRUE(packer.Pack(40, 20, x, y)); // Stacked under it, still above row 50.
+  EXPECT_EQ(x, 60); EXPECT_EQ(y, 20);
+  ASSERT_TRUE(packer.Pack(100, 50, x, y));
+  EXPECT_EQ(x, 0); EXPECT_EQ(y, 50);
+
+  EXPECT_FALSE(packer.Pack(1, 1, x, y)); // Full.
+  EXPECT_FALSE(SkylinePacker(10, 10).Pack(11, 1, x, y));
+}
+
+static std::array<uint8_t, 4> PixelAt(const SoftwareRenderer& renderer, int x, int y) {
+  std::array<uint8_t, 4> rgba;
+  memcpy(rgba.data(), renderer.GetPixels() + (y * renderer.GetWidth() + x) * 4, 4);
+  return rgba;
+}
+
+static const std::array<uint8_t, 4> kRedPixel = {255, 0, 0, 255};
+static const std::array<uint8_t, 4> kBluePixel = {0, 0, 255, 255};
+
+TEST(SoftwareRendererTest, FillsRectsInsideScissors) {
+  SoftwareRenderer renderer(200, 150);
+  WorkerPool pool(2);
+  DisplayList list;
+  list.AddRect({0, 0, 200, 150}, kBlue);
+  list.PushScissor({50, 50, 100, 100});
+  list.AddRect({0, 0, 200, 150}, kRed);
+  list.PopScissor();
+  renderer.Draw(list, {0, 0, 200, 150}, &pool);
+
+  EXPECT_EQ(PixelAt(renderer, 50, 50), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 99, 99), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 100, 99), kBluePixel);
+  EXPECT_EQ(PixelAt(renderer, 49, 60), kBluePixel);
+  EXPECT_EQ(PixelAt(renderer, 199, 149), kBluePixel);
+}
+
+TEST(SoftwareRendererTest, EncodesSRGB) {
+  SoftwareRenderer renderer(4, 4);
+  WorkerPool pool(0);
+  DisplayList list;
+  const float gray[4] = {0.5f, 0.5f, 0.5f, 1.f};
+  list.AddRect({0, 0, 4, 4}, gray);
+  renderer.Draw(list, {0, 0, 4, 4}, &pool);
+  // Linear 0.5, as an _SRGB attachment stores it.
+  const std::array<uint8_t, 4> expected = {188, 188, 188, 255};
+  EXPECT_EQ(PixelAt(renderer, 2, 2), expected);
+}
+
+TEST(SoftwareRendererTest, OutlinesIncludeRightAndBottomEdges) {
+  SoftwareRenderer renderer(40, 40);
+  WorkerPool pool(0);
+  DisplayList list;
+  list.AddRect({0, 0, 40, 40}, kBlue);
+  list.AddOutline({10, 10, 30, 30}, kRed, 1.f);
+  renderer.Draw(list, {0, 0, 40, 40}, &pool);
+
+  EXPECT_EQ(PixelAt(renderer, 10, 20), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 30, 20), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 20, 10), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 20, 30), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 30, 30), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 20, 20), kBluePixel);
+  EXPECT_EQ(PixelAt(renderer, 31, 20), kBluePixel);
+}
+
+TEST(SoftwareRendererTest, SamplesAndBlendsImages) {
+  SoftwareRenderer renderer(4, 2);
+  WorkerPool pool(0);
+  // Opaque red, opaque blue / half transparent white, transparent.
+  const uint8_t image[] = {255, 0, 0, 255,    0, 0, 255, 255,
+                           255, 255, 255, 128, 0, 0, 0, 0};
+  renderer.SetImage(7, image, 2, 2);
+
+  DisplayList list;
+  const float black[4] = {0.f, 0.f, 0.f, 1.f};
+  const float uv[8] = {0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 1.f};
+  list.AddRect({0, 0, 4, 2}, black);
+  list.AddTexturedRect(7, {0, 0, 2, 2}, kWhite, uv);
+  renderer.Draw(list, {0, 0, 4, 2}, &pool);
+
+  // Pixel centers land on texel centers.
+  EXPECT_EQ(PixelAt(renderer, 0, 0), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 1, 0), kBluePixel);
+  const std::array<uint8_t, 4> halfWhite = {188, 188, 188, 128};
+  const std::array<uint8_t, 4> transparent = {0, 0, 0, 0};
+  for (int c = 0; c < 4; c++) {
+    EXPECT_NEAR(PixelAt(renderer, 0, 1)[c], halfWhite[c], 1);
+  }
+  EXPECT_EQ(PixelAt(renderer, 1, 1), transparent);
+  const std::array<uint8_t, 4> blackPixel = {0, 0, 0, 255};
+  EXPECT_EQ(PixelAt(renderer, 2, 0), blackPixel);
+
+  // Halfway between texels: an even mix, in linear space.
+  list.Clear();
+  const float halfUV[8] = {0.5f, 0.25f, 0.5f, 0.25f, 0.5f, 0.25f, 0.5f, 0.25f};
+  list.AddTexturedRect(7, {0, 0, 1, 1}, kWhite, halfUV);
+  renderer.Draw(list, {0, 0, 1, 1}, &pool);
+  const std::array<uint8_t, 4> mixed = {188, 0, 188, 255};
+  for (int c = 0; c < 4; c++) {
+    EXPECT_NEAR(PixelAt(renderer, 0, 0)[c], mixed[c], 1);
+  }
+}
+
+TEST(SoftwareRendererTest, BlendsGlyphCoverage) {
+  SoftwareRenderer renderer(8, 2);
+  WorkerPool pool(0);
+  // 'A' is 2x1: covered, half covered.
+  const uint8_t atlas[] = {255, 128};
+  GlyphTable glyphs{};
+  GlyphQuad& a = glyphs['A'];
+  a.present = true;
+  a.width = 2;
+  a.height = 1;
+  a.baselineYOffset = 1;
+  a.horizontalAdvance = 3;
+  a.atlasRect[0] = 0; a.atlasRect[1] = 0;
+  a.atlasRect[2] = 0xFFFF; a.atlasRect[3] = 0xFFFF;
+  renderer.SetFont(3, glyphs, atlas, 2, 1);
+
+  DisplayList list;
+  list.AddRect({0, 0, 8, 2}, kBlue);
+  list.AddText(3, "AA", 2, 0, 1, {0, 0, 5, 1}, kRed);
+  renderer.Draw(list, {0, 0, 8, 2}, &pool);
+
+  EXPECT_EQ(PixelAt(renderer, 0, 0), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 3, 0), kRedPixel);
+  const std::array<uint8_t, 4> half = PixelAt(renderer, 1, 0);
+  EXPECT_NEAR(half[0], 188, 1);
+  EXPECT_EQ(half[1], 0);
+  EXPECT_NEAR(half[2], 188, 1);
+  EXPECT_EQ(PixelAt(renderer, 2, 0), kBluePixel); // Between the glyphs.
+  EXPECT_EQ(PixelAt(renderer, 0, 1), kBluePixel); // Under the baseline.
+}
+
+TEST(SoftwareRendererTest, TilesMatchSingleThreaded) {
+  constexpr int kWidth = 300, kHeight = 200;
+  SoftwareRenderer parallel(kWidth, kHeight);
+  SoftwareRenderer serial(kWidth, kHeight);
+  WorkerPool workers(3);
+  WorkerPool caller(0);
+
+  DisplayList list;
+  srand(11);
+  for (int i = 0; i < 300; i++) {
+    const int l = rand() % kWidth, t = rand() % kHeight;
+    const float rgba[4] = {(rand() % 256) / 255.f, (rand() % 256) / 255.f,
+                           (rand() % 256) / 255.f, 1.f};
+    if (i % 7 == 0) list.PushScissor({l, t, l + 80, t + 80});
+    if (i % 3 == 0) {
+      list.AddOutline({l, t, l + rand() % 100, t + rand() % 100}, rgba, 1.f + i % 3);
+    } else {
+      list.AddRect({l, t, l + rand() % 100, t + rand() % 100}, rgba);
+    }
+    if (i % 7 == 6) list.PopScissor();
+  }
+  parallel.Draw(list, {0, 0, kWidth, kHeight}, &workers);
+  serial.Draw(list, {0, 0, kWidth, kHeight}, &caller);
+  EXPECT_EQ(memcmp(parallel.GetPixels(), serial.GetPixels(), kWidth * kHeight * 4), 0);
+}
+
+TEST(SoftwareRendererTest, RootLimitsWhatIsRedrawn) {
+  SoftwareRenderer renderer(100, 100);
+  WorkerPool pool(1);
+  DisplayList list;
+  list.AddRect({0, 0, 100, 100}, kRed);
+  renderer.Draw(list, {0, 0, 100, 100}, &pool);
+
+  list.Clear();
+  list.AddRect({0, 0, 100, 100}, kBlue);
+  renderer.Draw(list, {70, 70, 200, 200}, &pool);
+  EXPECT_EQ(PixelAt(renderer, 69, 69), kRedPixel);
+  EXPECT_EQ(PixelAt(renderer, 70, 70), kBluePixel);
+  EXPECT_EQ(PixelAt(renderer, 99, 99), kBluePixel);
+}
+
+// Stand-in for a Vulkan handle. Handles are never dereferenced by 
+// CommandState, only compared.
+template <typename Handle>
+static Handle FakeHandle(uintptr_t value) {
+  return (Handle)value;
+}
+
+TEST(CommandStateTest, ElidesRepeatedState) {
+  CommandState state;
+  const VkPipeline pipeline = FakeHandle<VkPipeline>(1);
+  const VkDescriptorSet set = FakeHandle<VkDescriptorSet>(2);
+  const VkRect2D scissor = {{0, 0}, {100, 100}};
+  EXPECT_TRUE(state.BindPipeline(pipeline, false));
+  EXPECT_TRUE(state.BindDescriptorSet(set));
+  EXPECT_TRUE(state.SetScissor(scissor));
+  EXPECT_TRUE(state.BindVertexBuffer(FakeHandle<VkBuffer>(3)));
+
+  EXPECT_FALSE(state.BindPipeline(pipeline, false));
+  EXPECT_FALSE(state.BindDescriptorSet(set));
+  EXPECT_FALSE(state.SetScissor(scissor));
+  EXPECT_FALSE(state.BindVertexBuffer(FakeHandle<VkBuffer>(3)));
+  EXPECT_TRUE(state.SetScissor({{0, 0}, {100, 50}}));
+  EXPECT_EQ(state.stats.issued, 5);
+  EXPECT_EQ(state.stats.elided, 4);
+
+  // Recording a new Command Buffer forgets its state, not the stats.
+  state.Reset();
+  EXPECT_TRUE(state.BindPipeline(pipeline, false));
+  EXPECT_EQ(state.stats.issued, 6);
+  EXPECT_EQ(state.stats.elided, 4);
+}
+
+TEST(CommandStateTest, PipelineBindResetsDescriptorSetAndLineWidth) {
+  CommandState state;
+  const VkPipeline dynamicLines = FakeHandle<VkPipeline>(1);
+  const VkPipeline staticLines = FakeHandle<VkPipeline>(2);
+  const VkDescriptorSet set = FakeHandle<VkDescriptorSet>(3);
+  state.BindPipeline(dynamicLines, true);
+  state.BindDescriptorSet(set);
+  state.SetLineWidth(2.f);
+
+  // Another pipeline's layout invalidates the bound set, even the same one.
+  EXPECT_TRUE(state.BindPipeline(staticLines, false));
+  EXPECT_TRUE(state.BindDescriptorSet(set));
+  // Its static line width overwrote the dynamic one.
+  EXPECT_TRUE(state.SetLineWidth(2.f));
+  EXPECT_EQ(state.stats.issued, 6);
+  EXPECT_EQ(state.stats.elided, 0);
+
+  // A dynamic line width pipeline keeps it.
+  EXPECT_TRUE(state.BindPipeline(dynamicLines, true));
+  EXPECT_FALSE(state.SetLineWidth(2.f));
+  EXPECT_TRUE(state.BindDescriptorSet(set));
+  EXPECT_EQ(state.stats.issued, 8);
+  EXPECT_EQ(state.stats.elided, 1);
+}
+
+TEST(CommandStateTest, PushConstantsPersistAcrossLayouts) {
+  CommandState state;
+  state.BindPipeline(FakeHandle<VkPipeline>(1), false);
+  EXPECT_TRUE(state.PushFrameInfo());
+  // All pipeline layouts share the push constant range.
+  state.BindPipeline(FakeHandle<VkPipeline>(2), false);
+  EXPECT_FALSE(state.PushFrameInfo());
+  state.BindPipeline(FakeHandle<VkPipeline>(3), true);
+  EXPECT_FALSE(state.PushFrameInfo());
+  EXPECT_EQ(state.stats.issued, 4);
+  EXPECT_EQ(state.stats.elided, 2);
+
+  state.Reset();
+  EXPECT_TRUE(state.PushFrameInfo());
+}
+
+static const VkRect2D kFullScissor = {{0, 0}, {1000, 1000}};
+
+TEST(DrawBatcherTest, MergesOnlyMatchingState) {
+  DrawBatcher batcher;
+  const VkDescriptorSet set = FakeHandle<VkDescriptorSet>(1);
+  EXPECT_EQ(batcher.Add(0, VK_NULL_HANDLE, kFullScissor, 1.f, false, 32, 2), 0);
+  EXPECT_EQ(batcher.Add(0, VK_NULL_HANDLE, kFullScissor, 3.f, false, 32, 1), 64);
+  // Other instance size, starts at a multiple of it.
+  EXPECT_EQ(batcher.Add(1, set, kFullScissor, 1.f, false, 48, 1), 96);
+  EXPECT_EQ(batcher.Add(1, set, {{0, 0}, {10, 10}}, 1.f, false, 48, 1), 144);
+  EXPECT_EQ(batcher.Add(2, VK_NULL_HANDLE, kFullScissor, 1.f, true, 32, 1), 192);
+  EXPECT_EQ(batcher.Add(2, VK_NULL_HANDLE, kFullScissor, 2.f, true, 32, 1), 224);
+  EXPECT_EQ(batcher.GetSize(), 256);
+
+  const std::vector<DrawBatch>& batches = batcher.GetBatches();
+  ASSERT_EQ(batches.size(), 5);
+  // Static line widths don't split batches, dynamic ones do.
+  EXPECT_EQ(batches[0].instanceCount, 3);
+  EXPECT_EQ(batches[1].firstInstance, 2);
+  EXPECT_EQ(batches[2].firstInstance, 3);
+  EXPECT_EQ(batches[2].scissor.extent.width, 10);
+  EXPECT_EQ(batches[3].lineWidth, 1.f);
+  EXPECT_EQ(batches[4].lineWidth, 2.f);
+
+  batcher.Clear();
+  EXPECT_EQ(batcher.GetSize(), 0);
+  EXPECT_TRUE(batcher.GetBatches().empty());
+}
+
+TEST(DrawBatcherTest, ChunksKeepDrawOrder) {
+  EXPECT_EQ(GetRecordingChunkCount(kMinOpsPerRecordingChunk - 1, 8), 1);
+  EXPECT_EQ(GetRecordingChunkCount(kMinOpsPerRecordingChunk * 100, 1), 1);
+  EXPECT_EQ(GetRecordingChunkCount(kMinOpsPerRecordingChunk * 100, 100), 
+            kMaxRecordingContexts);
+
+  // Runs of 1000 ops alternate between two pipelines. Chunk boundaries 
+  // fall inside runs.
+  const size_t opCount = kMinOpsPerRecordingChunk * 3;
+  const size_t chunkCount = GetRecordingChunkCount(opCount, 4);
+  ASSERT_EQ(chunkCount, 3);
+  auto pipelineOf = [](size_t op) { return (op / 1000) % 2; };
+
+  DrawBatcher whole;
+  for (size_t op = 0; op < opCount; op++) {
+    whole.Add(pipelineOf(op), VK_NULL_HANDLE, kFullScissor, 1.f, false, 32, 1);
+  }
+
+  std::vector<DrawBatcher> chunks(chunkCount);
+  std::vector<DrawBatch> executed; // In the order the chunks are executed.
+  size_t op = 0;
+  for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+    const size_t first = GetRecordingChunkBegin(opCount, chunk, chunkCount);
+    const size_t last = GetRecordingChunkBegin(opCount, chunk + 1, chunkCount);
+    EXPECT_EQ(first, op); // Chunks are contiguous.
+    for (; op < last; op++) {
+      chunks[chunk].Add(pipelineOf(op), VK_NULL_HANDLE, kFullScissor, 1.f, false, 32, 1);
+    }
+    // Each chunk's instances are its ops, in order.
+    uint32_t instance = 0;
+    for (const DrawBatch& batch : chunks[chunk].GetBatches()) {
+      EXPECT_EQ(batch.firstInstance, instance);
+      instance += batch.instanceCount;
+      executed.push_back(batch);
+    }
+    EXPECT_EQ(instance, last - first);
+  }
+  EXPECT_EQ(op, opCount);
+
+  // Each boundary splits one batch in two, nothing else changes.
+  ASSERT_EQ(executed.size(), whole.GetBatches().size() + chunkCount - 1);
+  std::vector<DrawBatch> merged;
+  for (const DrawBatch& batch : executed) {
+    if (!merged.empty() && merged.back().pipelineIdx == batch.pipelineIdx) {
+      merged.back().instanceCount += batch.instanceCount;
+    } else {
+      merged.push_back(batch);
+    }
+  }
+  ASSERT_EQ(merged.size(), whole.GetBatches().size());
+  for (size_t i = 0; i < merged.size(); i++) {
+    EXPECT_EQ(merged[i].pipelineIdx, whole.GetBatches()[i].pipelineIdx);
+    EXPECT_EQ(merged[i].instanceCount, whole.GetBatches()[i].instanceCount);
+  }
+}